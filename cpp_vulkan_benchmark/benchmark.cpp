@@ -0,0 +1,219 @@
+// headless throughput benchmark: renders the triangle scene offscreen for a fixed number of frames and reports the timings as JSON
+
+#include "hello_triangle_application.h"
+#include "statistics.h"
+
+#include <sstream>
+
+struct BenchmarkConfig {
+	AppConfig app; // always headless, see parseArguments
+	uint32_t frames = 1000; // measured frames
+	uint32_t warmupFrames = 50; // rendered before the measurement starts (pipeline creation, first submits, clocks ramping up)
+	uint32_t recreateCount = 100; // render target recreations timed after the frames (what a resize costs besides the swap chain), 0 skips it
+	std::string outputPath; // empty: print the JSON to stdout; the app's log goes to stderr either way
+};
+
+BenchmarkConfig parseArguments(int argc, char** argv) {
+	BenchmarkConfig config;
+	config.app.headless = true;
+	config.app.gpuProfiling = true; // GPU ms/frame comes from the profiler's "frame" scope
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+
+		if (arg == "--frames" && i + 1 < argc) { // measured frames
+			config.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--warmup" && i + 1 < argc) { // frames rendered before measuring
+			config.warmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--resolution" && i + 2 < argc) { // --resolution <width> <height>
+			config.app.width = static_cast<uint32_t>(std::stoul(argv[++i]));
+			config.app.height = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--draws" && i + 1 < argc) { // scene size: draw calls per frame
+			config.app.sceneDrawCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--frames-in-flight" && i + 1 < argc) {
+			config.app.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--record-threads" && i + 1 < argc) {
+			config.app.recordThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--render-pass") { // the render pass path even if dynamic rendering is supported
+			config.app.dynamicRendering = false;
+		}
+		else if (arg == "--static-state") { // no extended dynamic state, every material permutation is its own pipeline
+			config.app.extendedDynamicState = false;
+		}
+		else if (arg == "--materials" && i + 1 < argc) {
+			config.app.materialCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--no-transfer-queue") { // uploads on the graphics queue
+			config.app.transferQueue = false;
+		}
+		else if (arg == "--upload-kib" && i + 1 < argc) { // upload throughput: KiB streamed through the staging ring every frame
+			config.app.streamingUploadKiB = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--recreate" && i + 1 < argc) {
+			config.recreateCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--static-command-buffers") {
+			config.app.staticCommandBuffers = true;
+		}
+		else if (arg == "--pipeline-cache" && i + 1 < argc) { // "" disables it
+			config.app.pipelineCachePath = argv[++i];
+		}
+		else if (arg == "--pipeline-threads" && i + 1 < argc) {
+			config.app.pipelineCompileThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--shader-opt" && i + 1 < argc) { // none, performance or size
+			if (!parseShaderOptimization(argv[++i], config.app.shaderOptimization)) {
+				throw std::runtime_error("Unknown shader optimization: " + std::string(argv[i]));
+			}
+		}
+		else if (arg == "--output" && i + 1 < argc) { // JSON output file
+			config.outputPath = argv[++i];
+		}
+		else {
+			throw std::runtime_error("Unknown argument: " + arg);
+		}
+	}
+
+	if (config.frames == 0) {
+		throw std::runtime_error("--frames has to be at least 1.");
+	}
+
+	return config;
+}
+
+std::string escapeJson(const std::string& text) { // only needed for the device name
+	std::string escaped;
+
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+		}
+		escaped += c;
+	}
+
+	return escaped;
+}
+
+int main(int argc, char** argv) {
+	std::streambuf* jsonOutput = std::cout.rdbuf(std::cerr.rdbuf()); // the app logs to std::cout (shaders, materials, memory...), stdout only gets the JSON so it can be piped into a parser
+
+	try {
+		BenchmarkConfig config = parseArguments(argc, argv);
+
+		HelloTriangleApplication app(config.app);
+		app.initialize();
+		app.finishPipelineCompilation();
+
+		app.renderFrames(config.warmupFrames);
+		app.waitIdle();
+		app.resetTimings();
+
+		// frame time: wall clock between the start of two consecutive frames, so it includes any time the CPU spends blocked on the frame ring
+
+		std::vector<double> frameTimesMs;
+		frameTimesMs.reserve(config.frames);
+
+		auto start = std::chrono::steady_clock::now();
+		auto frameStart = start;
+
+		for (uint32_t i = 0; i < config.frames; i++) {
+			app.renderFrames(1);
+
+			auto frameEnd = std::chrono::steady_clock::now();
+			frameTimesMs.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+			frameStart = frameEnd;
+		}
+
+		app.waitIdle(); // the last frames only count once the GPU is done with them
+		double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		const FrameTimings& timings = app.timings();
+		double frameCount = (std::max)(timings.frameCount, 1u);
+
+		double gpuMs = 0.0;
+		uint64_t gpuSamples = 0;
+		for (const auto& stats : app.gpuStatistics()) {
+			if (stats.name == "frame") { // only covers the last GPU_PROFILER_HISTORY frames
+				gpuMs = stats.averageMs;
+				gpuSamples = stats.sampleCount;
+			}
+		}
+
+		double recreateMs = app.measureRenderTargetRecreation(config.recreateCount);
+
+		std::string deviceName = app.deviceName();
+		bool dynamicRendering = app.usesDynamicRendering();
+		uint32_t pipelineCount = app.pipelineCount();
+		std::string dynamicState = dynamicStateNames(app.dynamicStateFields());
+		GpuMemoryStats memory = app.gpuMemoryStatistics();
+		bool transferQueue = app.usesTransferQueue();
+		UploadStats uploads = app.uploadStatistics();
+		app.shutdown();
+
+		std::ostringstream json;
+		json << "{\n"
+			<< "\t\"device\": \"" << escapeJson(deviceName) << "\",\n"
+			<< "\t\"width\": " << config.app.width << ",\n"
+			<< "\t\"height\": " << config.app.height << ",\n"
+			<< "\t\"draws\": " << config.app.sceneDrawCount << ",\n"
+			<< "\t\"framesInFlight\": " << config.app.framesInFlight << ",\n"
+			<< "\t\"recordThreads\": " << config.app.recordThreads << ",\n"
+			<< "\t\"staticCommandBuffers\": " << (config.app.staticCommandBuffers ? "true" : "false") << ",\n"
+			<< "\t\"dynamicRendering\": " << (dynamicRendering ? "true" : "false") << ",\n"
+			<< "\t\"materials\": " << (std::max)(config.app.materialCount, 1u) << ",\n"
+			<< "\t\"pipelines\": " << pipelineCount << ",\n"
+			<< "\t\"dynamicState\": \"" << dynamicState << "\",\n"
+			<< "\t\"warmupFrames\": " << config.warmupFrames << ",\n"
+			<< "\t\"frames\": " << config.frames << ",\n"
+			<< "\t\"totalMs\": " << totalMs << ",\n"
+			<< "\t\"fps\": " << config.frames * 1000.0 / totalMs << ",\n"
+			<< "\t\"cpuMsPerFrame\": " << (timings.cpuFrameMs - timings.gpuWaitMs) / frameCount << ",\n" // time the CPU actually worked, not blocked on the GPU
+			<< "\t\"gpuWaitMsPerFrame\": " << timings.gpuWaitMs / frameCount << ",\n"
+			<< "\t\"recordMsPerFrame\": " << timings.recordMs / frameCount << ",\n" // includes the pipeline binds and dynamic state calls below, compare with --static-state for what a bind costs
+			<< "\t\"pipelineBindsPerFrame\": " << timings.pipelineBinds / frameCount << ",\n"
+			<< "\t\"dynamicStateCallsPerFrame\": " << timings.dynamicStateCalls / frameCount << ",\n"
+			<< "\t\"gpuMsPerFrame\": " << gpuMs << ",\n"
+			<< "\t\"gpuSamples\": " << gpuSamples << ",\n"
+			<< "\t\"recreateMs\": " << recreateMs << ",\n" // image views (+ framebuffers on the render pass path), created and destroyed
+			<< "\t\"transferQueue\": " << (transferQueue ? "true" : "false") << ",\n"
+			<< "\t\"uploadKiBPerFrame\": " << timings.uploadBytes / 1024.0 / frameCount << ",\n"
+			<< "\t\"uploadMsPerFrame\": " << timings.uploadMs / frameCount << ",\n" // CPU side: staging and the transfer submit
+			<< "\t\"uploadMiBPerSecond\": " << timings.uploadBytes / (1024.0 * 1024.0) / (totalMs / 1000.0) << ",\n"
+			<< "\t\"uploadsDeferred\": " << uploads.deferredCount << ",\n" // staging ring full, the upload was skipped that frame
+			<< "\t\"gpuMemory\": { \"allocations\": " << memory.allocationCount
+			<< ", \"deviceAllocations\": " << memory.deviceAllocationCount
+			<< ", \"usedBytes\": " << memory.usedBytes
+			<< ", \"reservedBytes\": " << memory.reservedBytes << " },\n"
+			<< "\t\"frameTimeMs\": { \"avg\": " << average(frameTimesMs)
+			<< ", \"p50\": " << percentile(frameTimesMs, 0.50)
+			<< ", \"p95\": " << percentile(frameTimesMs, 0.95)
+			<< ", \"p99\": " << percentile(frameTimesMs, 0.99) << " }\n"
+			<< "}\n";
+
+		if (config.outputPath.empty()) {
+			std::cout.rdbuf(jsonOutput);
+			std::cout << json.str();
+		}
+		else {
+			std::ofstream file(config.outputPath);
+
+			if (!file.is_open()) {
+				throw std::runtime_error("Failed to open benchmark output file.");
+			}
+
+			file << json.str();
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
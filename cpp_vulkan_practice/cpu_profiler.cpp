@@ -0,0 +1,105 @@
+#include "cpu_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+struct CpuProfileEvent {
+	const char* name;
+	int64_t startNs;
+	int64_t endNs;
+};
+
+struct CpuProfileThreadBuffer { // single writer (the owning thread), read by the exporter
+	std::vector<CpuProfileEvent> events = std::vector<CpuProfileEvent>(CPU_PROFILER_EVENTS_PER_THREAD);
+	std::atomic<uint64_t> writeCount{ 0 }; // total events written, the ring index is writeCount % capacity
+	uint32_t threadId = 0;
+	std::string threadName;
+};
+
+std::atomic<bool> CpuProfiler::enabledFlag{ false };
+
+static std::mutex registryMutex; // only taken when a thread records its first event and when exporting
+static std::vector<std::unique_ptr<CpuProfileThreadBuffer>> registry; // buffers live until exit, so events of finished threads can still be exported
+
+static CpuProfileThreadBuffer& threadBuffer() {
+	thread_local CpuProfileThreadBuffer* buffer = nullptr;
+
+	if (buffer == nullptr) {
+		std::lock_guard<std::mutex> lock(registryMutex);
+		registry.push_back(std::make_unique<CpuProfileThreadBuffer>());
+		buffer = registry.back().get();
+		buffer->threadId = static_cast<uint32_t>(registry.size());
+	}
+
+	return *buffer;
+}
+
+void CpuProfiler::setThreadName(const char* name) {
+	CpuProfileThreadBuffer& buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(registryMutex);
+	buffer.threadName = name;
+}
+
+int64_t CpuProfiler::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CpuProfiler::record(const char* name, int64_t startNs, int64_t endNs) {
+	CpuProfileThreadBuffer& buffer = threadBuffer();
+
+	uint64_t index = buffer.writeCount.load(std::memory_order_relaxed);
+	buffer.events[index & (CPU_PROFILER_EVENTS_PER_THREAD - 1)] = { name, startNs, endNs };
+	buffer.writeCount.store(index + 1, std::memory_order_release); // publishes the event to the exporter
+}
+
+void CpuProfiler::writeChromeTrace(const std::string& path) {
+	std::ofstream file(path);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open CPU trace output file.");
+	}
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	int64_t baseNs = INT64_MAX; // timestamps relative to the first event keep the numbers short
+	for (const auto& buffer : registry) {
+		uint64_t count = buffer->writeCount.load(std::memory_order_acquire);
+		uint64_t first = count > CPU_PROFILER_EVENTS_PER_THREAD ? count - CPU_PROFILER_EVENTS_PER_THREAD : 0;
+
+		for (uint64_t i = first; i < count; i++) {
+			baseNs = (std::min)(baseNs, buffer->events[i & (CPU_PROFILER_EVENTS_PER_THREAD - 1)].startNs);
+		}
+	}
+
+	file << std::fixed << std::setprecision(3); // microseconds with nanosecond resolution
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool firstEvent = true;
+	for (const auto& buffer : registry) {
+		std::string threadName = buffer->threadName.empty() ? "thread " + std::to_string(buffer->threadId) : buffer->threadName;
+
+		file << (firstEvent ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+			<< ",\"args\":{\"name\":\"" << threadName << "\"}}";
+		firstEvent = false;
+
+		uint64_t count = buffer->writeCount.load(std::memory_order_acquire);
+		uint64_t first = count > CPU_PROFILER_EVENTS_PER_THREAD ? count - CPU_PROFILER_EVENTS_PER_THREAD : 0;
+
+		for (uint64_t i = first; i < count; i++) {
+			const CpuProfileEvent& event = buffer->events[i & (CPU_PROFILER_EVENTS_PER_THREAD - 1)];
+
+			// "X": complete event with a start and a duration, both in microseconds
+
+			file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+				<< ",\"ts\":" << (event.startNs - baseNs) / 1000.0 << ",\"dur\":" << (event.endNs - event.startNs) / 1000.0 << "}";
+		}
+	}
+
+	file << "\n]}\n";
+}
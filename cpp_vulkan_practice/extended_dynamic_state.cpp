@@ -0,0 +1,330 @@
+#include "extended_dynamic_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+bool FixedFunctionState::operator==(const FixedFunctionState& other) const {
+	return std::memcmp(this, &other, sizeof(FixedFunctionState)) == 0; // no padding, every member is 32 bits
+}
+
+struct DynamicStateInfo {
+	DynamicStateFlagBits flag;
+	VkDynamicState state;
+	const char* name;
+};
+
+static const std::vector<DynamicStateInfo>& dynamicStateInfos() {
+	static const std::vector<DynamicStateInfo> infos = {
+		{ DYNAMIC_STATE_CULL_MODE_BIT, VK_DYNAMIC_STATE_CULL_MODE, "cull mode" },
+		{ DYNAMIC_STATE_FRONT_FACE_BIT, VK_DYNAMIC_STATE_FRONT_FACE, "front face" },
+		{ DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_BIT, VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY, "topology" },
+		{ DYNAMIC_STATE_DEPTH_TEST_ENABLE_BIT, VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE, "depth test" },
+		{ DYNAMIC_STATE_DEPTH_WRITE_ENABLE_BIT, VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE, "depth write" },
+		{ DYNAMIC_STATE_DEPTH_COMPARE_OP_BIT, VK_DYNAMIC_STATE_DEPTH_COMPARE_OP, "depth compare op" },
+		{ DYNAMIC_STATE_DEPTH_BIAS_ENABLE_BIT, VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE, "depth bias" },
+		{ DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_BIT, VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE, "primitive restart" },
+#ifdef VK_EXT_extended_dynamic_state3
+		{ DYNAMIC_STATE_POLYGON_MODE_BIT, VK_DYNAMIC_STATE_POLYGON_MODE_EXT, "polygon mode" },
+		{ DYNAMIC_STATE_COLOR_BLEND_ENABLE_BIT, VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT, "blend enable" },
+		{ DYNAMIC_STATE_COLOR_WRITE_MASK_BIT, VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT, "color write mask" },
+#endif
+	};
+
+	return infos;
+}
+
+std::string dynamicStateNames(DynamicStateFlags flags) {
+	std::string names;
+
+	for (const auto& info : dynamicStateInfos()) {
+		if (flags & info.flag) {
+			names += (names.empty() ? "" : ", ") + std::string(info.name);
+		}
+	}
+
+	return names.empty() ? "none" : names;
+}
+
+std::vector<VkDynamicState> dynamicStateList(DynamicStateFlags flags) {
+	std::vector<VkDynamicState> states = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	for (const auto& info : dynamicStateInfos()) {
+		if (flags & info.flag) {
+			states.push_back(info.state);
+		}
+	}
+
+	return states;
+}
+
+FixedFunctionState bakedState(const FixedFunctionState& state, DynamicStateFlags dynamicFields) {
+	FixedFunctionState baked = state;
+	FixedFunctionState defaults;
+
+	if (dynamicFields & DYNAMIC_STATE_CULL_MODE_BIT) baked.cullMode = defaults.cullMode;
+	if (dynamicFields & DYNAMIC_STATE_FRONT_FACE_BIT) baked.frontFace = defaults.frontFace;
+	if (dynamicFields & DYNAMIC_STATE_DEPTH_TEST_ENABLE_BIT) baked.depthTestEnable = defaults.depthTestEnable;
+	if (dynamicFields & DYNAMIC_STATE_DEPTH_WRITE_ENABLE_BIT) baked.depthWriteEnable = defaults.depthWriteEnable;
+	if (dynamicFields & DYNAMIC_STATE_DEPTH_COMPARE_OP_BIT) baked.depthCompareOp = defaults.depthCompareOp;
+	if (dynamicFields & DYNAMIC_STATE_DEPTH_BIAS_ENABLE_BIT) baked.depthBiasEnable = defaults.depthBiasEnable;
+	if (dynamicFields & DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_BIT) baked.primitiveRestartEnable = defaults.primitiveRestartEnable;
+	if (dynamicFields & DYNAMIC_STATE_POLYGON_MODE_BIT) baked.polygonMode = defaults.polygonMode;
+	if (dynamicFields & DYNAMIC_STATE_COLOR_BLEND_ENABLE_BIT) baked.blendEnable = defaults.blendEnable;
+	if (dynamicFields & DYNAMIC_STATE_COLOR_WRITE_MASK_BIT) baked.colorWriteMask = defaults.colorWriteMask;
+
+	// a dynamic topology still has to be of the class the pipeline was created with, the pipeline keeps the first topology of the class
+
+	if (dynamicFields & DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_BIT) {
+		switch (state.topology) {
+		case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+			break;
+		case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+		case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+		case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+		case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+			baked.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+			break;
+		case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+			break;
+		default:
+			baked.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+			break;
+		}
+	}
+
+	return baked;
+}
+
+static bool hasExtension(const std::vector<VkExtensionProperties>& extensions, const char* name) {
+	return std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties& extension) {
+		return std::strcmp(extension.extensionName, name) == 0;
+	});
+}
+
+void ExtendedDynamicState::query(VkPhysicalDevice physicalDevice) {
+	supportedFlags = 0;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+	// extended dynamic state 1 and 2 are core in 1.3 without a feature bit (only the logic op and patch control point parts, not used here, are optional)
+
+	core = deviceProperties.apiVersion >= VK_API_VERSION_1_3;
+
+	extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+	extendedDynamicState2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+
+	VkPhysicalDeviceFeatures2 deviceFeatures = {};
+	deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	void* chain = nullptr;
+
+	extension1 = !core && hasExtension(availableExtensions, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+	extension2 = !core && hasExtension(availableExtensions, VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+
+	if (extension1) {
+		extendedDynamicStateFeatures.pNext = chain;
+		chain = &extendedDynamicStateFeatures;
+	}
+
+	if (extension2) {
+		extendedDynamicState2Features.pNext = chain;
+		chain = &extendedDynamicState2Features;
+	}
+
+#ifdef VK_EXT_extended_dynamic_state3
+	extendedDynamicState3Features = {};
+	extendedDynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+	extension3 = hasExtension(availableExtensions, VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+
+	if (extension3) {
+		extendedDynamicState3Features.pNext = chain;
+		chain = &extendedDynamicState3Features;
+	}
+#endif
+
+	deviceFeatures.pNext = chain;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &deviceFeatures);
+
+	extension1 = extension1 && extendedDynamicStateFeatures.extendedDynamicState == VK_TRUE;
+	extension2 = extension2 && extendedDynamicState2Features.extendedDynamicState2 == VK_TRUE;
+
+	if (core || extension1) {
+		supportedFlags |= EXTENDED_DYNAMIC_STATE_1_FLAGS;
+	}
+
+	if (core || extension2) {
+		supportedFlags |= EXTENDED_DYNAMIC_STATE_2_FLAGS;
+	}
+
+#ifdef VK_EXT_extended_dynamic_state3
+	if (extension3) { // every state has its own feature bit
+		supportedFlags |= extendedDynamicState3Features.extendedDynamicState3PolygonMode == VK_TRUE ? DYNAMIC_STATE_POLYGON_MODE_BIT : 0;
+		supportedFlags |= extendedDynamicState3Features.extendedDynamicState3ColorBlendEnable == VK_TRUE ? DYNAMIC_STATE_COLOR_BLEND_ENABLE_BIT : 0;
+		supportedFlags |= extendedDynamicState3Features.extendedDynamicState3ColorWriteMask == VK_TRUE ? DYNAMIC_STATE_COLOR_WRITE_MASK_BIT : 0;
+		extension3 = (supportedFlags & (DYNAMIC_STATE_POLYGON_MODE_BIT | DYNAMIC_STATE_COLOR_BLEND_ENABLE_BIT | DYNAMIC_STATE_COLOR_WRITE_MASK_BIT)) != 0;
+	}
+#endif
+}
+
+void* ExtendedDynamicState::enable(void* pNext, std::vector<const char*>& deviceExtensions) {
+	if (extension1) {
+		deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+		extendedDynamicStateFeatures.pNext = pNext;
+		pNext = &extendedDynamicStateFeatures;
+	}
+
+	if (extension2) {
+		deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+		extendedDynamicState2Features.extendedDynamicState2LogicOp = VK_FALSE;
+		extendedDynamicState2Features.extendedDynamicState2PatchControlPoints = VK_FALSE;
+		extendedDynamicState2Features.pNext = pNext;
+		pNext = &extendedDynamicState2Features;
+	}
+
+#ifdef VK_EXT_extended_dynamic_state3
+	if (extension3) { // only the three states used here, not everything the extension offers
+		VkPhysicalDeviceExtendedDynamicState3FeaturesEXT supportedFeatures = extendedDynamicState3Features;
+		extendedDynamicState3Features = {};
+		extendedDynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+		extendedDynamicState3Features.extendedDynamicState3PolygonMode = supportedFeatures.extendedDynamicState3PolygonMode;
+		extendedDynamicState3Features.extendedDynamicState3ColorBlendEnable = supportedFeatures.extendedDynamicState3ColorBlendEnable;
+		extendedDynamicState3Features.extendedDynamicState3ColorWriteMask = supportedFeatures.extendedDynamicState3ColorWriteMask;
+
+		deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+		extendedDynamicState3Features.pNext = pNext;
+		pNext = &extendedDynamicState3Features;
+	}
+#endif
+
+	return pNext;
+}
+
+void ExtendedDynamicState::loadFunctions(VkDevice device) {
+	// device level entry points, the loader may not export the EXT ones
+
+	if (supportedFlags & EXTENDED_DYNAMIC_STATE_1_FLAGS) {
+		cmdSetCullMode = reinterpret_cast<PFN_vkCmdSetCullMode>(vkGetDeviceProcAddr(device, core ? "vkCmdSetCullMode" : "vkCmdSetCullModeEXT"));
+		cmdSetFrontFace = reinterpret_cast<PFN_vkCmdSetFrontFace>(vkGetDeviceProcAddr(device, core ? "vkCmdSetFrontFace" : "vkCmdSetFrontFaceEXT"));
+		cmdSetPrimitiveTopology = reinterpret_cast<PFN_vkCmdSetPrimitiveTopology>(vkGetDeviceProcAddr(device, core ? "vkCmdSetPrimitiveTopology" : "vkCmdSetPrimitiveTopologyEXT"));
+		cmdSetDepthTestEnable = reinterpret_cast<PFN_vkCmdSetDepthTestEnable>(vkGetDeviceProcAddr(device, core ? "vkCmdSetDepthTestEnable" : "vkCmdSetDepthTestEnableEXT"));
+		cmdSetDepthWriteEnable = reinterpret_cast<PFN_vkCmdSetDepthWriteEnable>(vkGetDeviceProcAddr(device, core ? "vkCmdSetDepthWriteEnable" : "vkCmdSetDepthWriteEnableEXT"));
+		cmdSetDepthCompareOp = reinterpret_cast<PFN_vkCmdSetDepthCompareOp>(vkGetDeviceProcAddr(device, core ? "vkCmdSetDepthCompareOp" : "vkCmdSetDepthCompareOpEXT"));
+
+		if (!cmdSetCullMode || !cmdSetFrontFace || !cmdSetPrimitiveTopology || !cmdSetDepthTestEnable || !cmdSetDepthWriteEnable || !cmdSetDepthCompareOp) {
+			throw std::runtime_error("Failed to load the extended dynamic state functions.");
+		}
+	}
+
+	if (supportedFlags & EXTENDED_DYNAMIC_STATE_2_FLAGS) {
+		cmdSetDepthBiasEnable = reinterpret_cast<PFN_vkCmdSetDepthBiasEnable>(vkGetDeviceProcAddr(device, core ? "vkCmdSetDepthBiasEnable" : "vkCmdSetDepthBiasEnableEXT"));
+		cmdSetPrimitiveRestartEnable = reinterpret_cast<PFN_vkCmdSetPrimitiveRestartEnable>(vkGetDeviceProcAddr(device, core ? "vkCmdSetPrimitiveRestartEnable" : "vkCmdSetPrimitiveRestartEnableEXT"));
+
+		if (!cmdSetDepthBiasEnable || !cmdSetPrimitiveRestartEnable) {
+			throw std::runtime_error("Failed to load the extended dynamic state 2 functions.");
+		}
+	}
+
+#ifdef VK_EXT_extended_dynamic_state3
+	if (extension3) {
+		cmdSetPolygonMode = reinterpret_cast<PFN_vkCmdSetPolygonModeEXT>(vkGetDeviceProcAddr(device, "vkCmdSetPolygonModeEXT"));
+		cmdSetColorBlendEnable = reinterpret_cast<PFN_vkCmdSetColorBlendEnableEXT>(vkGetDeviceProcAddr(device, "vkCmdSetColorBlendEnableEXT"));
+		cmdSetColorWriteMask = reinterpret_cast<PFN_vkCmdSetColorWriteMaskEXT>(vkGetDeviceProcAddr(device, "vkCmdSetColorWriteMaskEXT"));
+
+		if (((supportedFlags & DYNAMIC_STATE_POLYGON_MODE_BIT) && !cmdSetPolygonMode) ||
+			((supportedFlags & DYNAMIC_STATE_COLOR_BLEND_ENABLE_BIT) && !cmdSetColorBlendEnable) ||
+			((supportedFlags & DYNAMIC_STATE_COLOR_WRITE_MASK_BIT) && !cmdSetColorWriteMask)) {
+			throw std::runtime_error("Failed to load the extended dynamic state 3 functions.");
+		}
+	}
+#endif
+}
+
+std::string ExtendedDynamicState::description() const {
+	std::string sources;
+
+	if (core) {
+		sources = "Vulkan 1.3";
+	}
+	else {
+		sources += extension1 ? "VK_EXT_extended_dynamic_state" : "";
+		sources += extension2 ? (sources.empty() ? "" : ", ") + std::string("VK_EXT_extended_dynamic_state2") : "";
+	}
+
+	sources += extension3 ? (sources.empty() ? "" : ", ") + std::string("VK_EXT_extended_dynamic_state3") : "";
+
+	return sources.empty() ? "not supported" : sources;
+}
+
+uint32_t ExtendedDynamicState::apply(VkCommandBuffer commandBuffer, DynamicStateFlags fields, const FixedFunctionState& state, const FixedFunctionState* previous) const {
+	uint32_t callCount = 0;
+
+	auto changed = [fields, previous](DynamicStateFlagBits flag, auto member, const FixedFunctionState& state) { // member: pointer to the field
+		return (fields & flag) && (previous == nullptr || previous->*member != state.*member);
+	};
+
+	if (changed(DYNAMIC_STATE_CULL_MODE_BIT, &FixedFunctionState::cullMode, state)) {
+		cmdSetCullMode(commandBuffer, state.cullMode);
+		callCount++;
+	}
+
+	if (changed(DYNAMIC_STATE_FRONT_FACE_BIT, &FixedFunctionState::frontFace, state)) {
+		cmdSetFrontFace(commandBuffer, state.frontFace);
+		callCount++;
+	}
+
+	if (changed(DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_BIT, &FixedFunctionState::topology, state)) {
+		cmdSetPrimitiveTopology(commandBuffer, state.topology);
+		callCount++;
+	}
+
+	if (changed(DYNAMIC_STATE_DEPTH_TEST_ENABLE_BIT, &FixedFunctionState::depthTestEnable, state)) {
+		cmdSetDepthTestEnable(commandBuffer, state.depthTestEnable);
+		callCount++;
+	}
+
+	if (changed(DYNAMIC_STATE_DEPTH_WRITE_ENABLE_BIT, &FixedFunctionState::depthWriteEnable, state)) {
+		cmdSetDepthWriteEnable(commandBuffer, state.depthWriteEnable);
+		callCount++;
+	}
+
+	if (changed(DYNAMIC_STATE_DEPTH_COMPARE_OP_BIT, &FixedFunctionState::depthCompareOp, state)) {
+		cmdSetDepthCompareOp(commandBuffer, state.depthCompareOp);
+		callCount++;
+	}
+
+	if (changed(DYNAMIC_STATE_DEPTH_BIAS_ENABLE_BIT, &FixedFunctionState::depthBiasEnable, state)) {
+		cmdSetDepthBiasEnable(commandBuffer, state.depthBiasEnable);
+		callCount++;
+	}
+
+	if (changed(DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_BIT, &FixedFunctionState::primitiveRestartEnable, state)) {
+		cmdSetPrimitiveRestartEnable(commandBuffer, state.primitiveRestartEnable);
+		callCount++;
+	}
+
+#ifdef VK_EXT_extended_dynamic_state3
+	if (changed(DYNAMIC_STATE_POLYGON_MODE_BIT, &FixedFunctionState::polygonMode, state)) {
+		cmdSetPolygonMode(commandBuffer, state.polygonMode);
+		callCount++;
+	}
+
+	if (changed(DYNAMIC_STATE_COLOR_BLEND_ENABLE_BIT, &FixedFunctionState::blendEnable, state)) {
+		cmdSetColorBlendEnable(commandBuffer, 0, 1, &state.blendEnable); // one color attachment
+		callCount++;
+	}
+
+	if (changed(DYNAMIC_STATE_COLOR_WRITE_MASK_BIT, &FixedFunctionState::colorWriteMask, state)) {
+		cmdSetColorWriteMask(commandBuffer, 0, 1, &state.colorWriteMask);
+		callCount++;
+	}
+#endif
+
+	return callCount;
+}
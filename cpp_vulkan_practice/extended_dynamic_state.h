@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// extended dynamic state: fixed function state that is set while recording (vkCmdSetCullMode, ...) instead of being baked into the pipeline
+// materials usually differ in a few of these fields only; with the fields dynamic they all share one pipeline and switching between them is a vkCmdSet* call instead of a pipeline bind
+//
+// extended dynamic state 1 and 2 are core in Vulkan 1.3, Vulkan 1.2 devices may have them as VK_EXT_extended_dynamic_state(2)
+// extended dynamic state 3 (polygon mode, blending) is an extension only, and needs a Vulkan header that knows it
+
+struct FixedFunctionState { // the per-material part of a graphics pipeline; only 32 bit members, so it can be hashed as raw bytes
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkBool32 primitiveRestartEnable = VK_FALSE;
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+	VkBool32 depthBiasEnable = VK_FALSE;
+	VkBool32 depthTestEnable = VK_FALSE;
+	VkBool32 depthWriteEnable = VK_FALSE;
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+	VkBool32 blendEnable = VK_FALSE; // the blend factors are the same for every material (alpha blending), only whether blending happens differs
+	VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	bool operator==(const FixedFunctionState& other) const;
+};
+
+// which fields of FixedFunctionState are dynamic
+
+enum DynamicStateFlagBits : uint32_t {
+	DYNAMIC_STATE_CULL_MODE_BIT = 1 << 0, // extended dynamic state
+	DYNAMIC_STATE_FRONT_FACE_BIT = 1 << 1,
+	DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_BIT = 1 << 2, // within the topology class of the pipeline (triangles stay triangles)
+	DYNAMIC_STATE_DEPTH_TEST_ENABLE_BIT = 1 << 3,
+	DYNAMIC_STATE_DEPTH_WRITE_ENABLE_BIT = 1 << 4,
+	DYNAMIC_STATE_DEPTH_COMPARE_OP_BIT = 1 << 5,
+	DYNAMIC_STATE_DEPTH_BIAS_ENABLE_BIT = 1 << 6, // extended dynamic state 2
+	DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_BIT = 1 << 7,
+	DYNAMIC_STATE_POLYGON_MODE_BIT = 1 << 8, // extended dynamic state 3
+	DYNAMIC_STATE_COLOR_BLEND_ENABLE_BIT = 1 << 9,
+	DYNAMIC_STATE_COLOR_WRITE_MASK_BIT = 1 << 10
+};
+using DynamicStateFlags = uint32_t;
+
+const DynamicStateFlags EXTENDED_DYNAMIC_STATE_1_FLAGS = DYNAMIC_STATE_CULL_MODE_BIT | DYNAMIC_STATE_FRONT_FACE_BIT | DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_BIT |
+	DYNAMIC_STATE_DEPTH_TEST_ENABLE_BIT | DYNAMIC_STATE_DEPTH_WRITE_ENABLE_BIT | DYNAMIC_STATE_DEPTH_COMPARE_OP_BIT;
+const DynamicStateFlags EXTENDED_DYNAMIC_STATE_2_FLAGS = DYNAMIC_STATE_DEPTH_BIAS_ENABLE_BIT | DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_BIT;
+
+std::string dynamicStateNames(DynamicStateFlags flags); // e.g. "cull mode, front face", "none" for 0
+std::vector<VkDynamicState> dynamicStateList(DynamicStateFlags flags); // the VkDynamicState values for the pipeline, viewport and scissor included (they are always dynamic)
+
+// the state as the pipeline sees it: dynamic fields are reset to their defaults, so two states that only differ in dynamic fields compare (and hash) equal
+FixedFunctionState bakedState(const FixedFunctionState& state, DynamicStateFlags dynamicFields);
+
+class ExtendedDynamicState {
+public:
+	// before vkCreateDevice: what the device supports, and the features and extensions enable() asks for
+	void query(VkPhysicalDevice physicalDevice);
+	void* enable(void* pNext, std::vector<const char*>& deviceExtensions); // adds the feature structs to a device create pNext chain and returns the new head; they have to stay alive until vkCreateDevice
+	void loadFunctions(VkDevice device); // after vkCreateDevice, throws if an entry point is missing
+
+	DynamicStateFlags supported() const { return supportedFlags; }
+	std::string description() const; // which versions / extensions provide it, for the startup log
+
+	// records the vkCmdSet* calls for the dynamic fields of state; previous: the state the command buffer already has (nullptr after a bind in a new command buffer), equal fields are skipped
+	// returns how many calls were recorded
+	uint32_t apply(VkCommandBuffer commandBuffer, DynamicStateFlags fields, const FixedFunctionState& state, const FixedFunctionState* previous) const;
+
+private:
+	DynamicStateFlags supportedFlags = 0;
+	bool core = false; // extended dynamic state 1 and 2 from Vulkan 1.3, the entry points have no suffix
+	bool extension1 = false; // VK_EXT_extended_dynamic_state
+	bool extension2 = false; // VK_EXT_extended_dynamic_state2
+	bool extension3 = false; // VK_EXT_extended_dynamic_state3
+
+	VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures = {};
+	VkPhysicalDeviceExtendedDynamicState2FeaturesEXT extendedDynamicState2Features = {};
+#ifdef VK_EXT_extended_dynamic_state3
+	VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features = {};
+#endif
+
+	PFN_vkCmdSetCullMode cmdSetCullMode = nullptr; // core or EXT entry point, whichever the device has
+	PFN_vkCmdSetFrontFace cmdSetFrontFace = nullptr;
+	PFN_vkCmdSetPrimitiveTopology cmdSetPrimitiveTopology = nullptr;
+	PFN_vkCmdSetDepthTestEnable cmdSetDepthTestEnable = nullptr;
+	PFN_vkCmdSetDepthWriteEnable cmdSetDepthWriteEnable = nullptr;
+	PFN_vkCmdSetDepthCompareOp cmdSetDepthCompareOp = nullptr;
+	PFN_vkCmdSetDepthBiasEnable cmdSetDepthBiasEnable = nullptr;
+	PFN_vkCmdSetPrimitiveRestartEnable cmdSetPrimitiveRestartEnable = nullptr;
+#ifdef VK_EXT_extended_dynamic_state3
+	PFN_vkCmdSetPolygonModeEXT cmdSetPolygonMode = nullptr;
+	PFN_vkCmdSetColorBlendEnableEXT cmdSetColorBlendEnable = nullptr;
+	PFN_vkCmdSetColorWriteMaskEXT cmdSetColorWriteMask = nullptr;
+#endif
+};
@@ -0,0 +1,134 @@
+#include "file_watcher.h"
+
+#include <filesystem>
+#include <iostream>
+#include <map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "cpu_profiler.h"
+
+const std::chrono::milliseconds FILE_WATCHER_POLL_INTERVAL(250); // how often the thread checks whether it should stop (and, without inotify, the files)
+
+FileWatcher::~FileWatcher() {
+	stop();
+}
+
+void FileWatcher::start(const std::string& directory) {
+	stop();
+
+	this->directory = directory;
+	stopping = false;
+	thread = std::thread(&FileWatcher::watchLoop, this);
+}
+
+void FileWatcher::stop() {
+	if (!thread.joinable()) {
+		return;
+	}
+
+	stopping = true;
+	thread.join();
+}
+
+std::vector<std::string> FileWatcher::takeChanges(std::chrono::milliseconds settleTime) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (changes.empty() || std::chrono::steady_clock::now() - lastChangeTime < settleTime) {
+		return {};
+	}
+
+	std::vector<std::string> result(changes.begin(), changes.end());
+	changes.clear();
+	return result;
+}
+
+void FileWatcher::addChange(const std::string& name) {
+	std::string path = (std::filesystem::path(directory) / name).lexically_normal().generic_string();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	changes.insert(path);
+	lastChangeTime = std::chrono::steady_clock::now();
+}
+
+#ifdef __linux__
+
+void FileWatcher::watchLoop() {
+	CpuProfiler::setThreadName("file watcher");
+
+	int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFd < 0 || inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) { // written and closed, or renamed into the directory (editors that save atomically)
+		std::cerr << "file watcher: can't watch " << directory << std::endl;
+		if (inotifyFd >= 0) {
+			close(inotifyFd);
+		}
+		return;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+
+	while (!stopping) {
+		pollfd poll_fd = {};
+		poll_fd.fd = inotifyFd;
+		poll_fd.events = POLLIN;
+
+		if (poll(&poll_fd, 1, static_cast<int>(FILE_WATCHER_POLL_INTERVAL.count())) <= 0) { // timeout: check stopping again
+			continue;
+		}
+
+		ssize_t length;
+		while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+			for (char* position = buffer; position < buffer + length; ) {
+				auto event = reinterpret_cast<const inotify_event*>(position);
+
+				if (event->len > 0 && (event->mask & IN_ISDIR) == 0) {
+					addChange(event->name);
+				}
+
+				position += sizeof(inotify_event) + event->len;
+			}
+		}
+	}
+
+	close(inotifyFd);
+}
+
+#else
+
+void FileWatcher::watchLoop() { // polling: compares the modification time of every file with the one seen last time
+	CpuProfiler::setThreadName("file watcher");
+
+	std::map<std::string, std::filesystem::file_time_type> writeTimes;
+	bool firstScan = true;
+
+	while (!stopping) {
+		std::error_code error;
+
+		for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+			if (!entry.is_regular_file(error)) {
+				continue;
+			}
+
+			std::string name = entry.path().filename().string();
+			auto writeTime = entry.last_write_time(error);
+			auto known = writeTimes.find(name);
+
+			if (known == writeTimes.end() || known->second != writeTime) {
+				writeTimes[name] = writeTime;
+
+				if (!firstScan) { // the first scan only records what is already there
+					addChange(name);
+				}
+			}
+		}
+
+		firstScan = false;
+		std::this_thread::sleep_for(FILE_WATCHER_POLL_INTERVAL);
+	}
+}
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// watches the files of one directory (not its subdirectories) on a background thread
+// linux: inotify, other platforms: polls the modification times a few times per second
+// changes are collected until the main thread takes them, a burst of events (an editor writing a file in several steps) comes out as one change
+
+class FileWatcher {
+public:
+	~FileWatcher();
+
+	void start(const std::string& directory);
+	void stop();
+
+	bool running() const { return thread.joinable(); }
+
+	// the changed files (normalized "directory/name" paths) once no new change came in for settleTime, otherwise nothing
+	std::vector<std::string> takeChanges(std::chrono::milliseconds settleTime);
+
+private:
+	void watchLoop();
+	void addChange(const std::string& name);
+
+	std::string directory;
+	std::thread thread;
+	std::atomic<bool> stopping = false;
+
+	std::mutex mutex;
+	std::set<std::string> changes;
+	std::chrono::steady_clock::time_point lastChangeTime;
+};
@@ -0,0 +1,80 @@
+#include "frame_scheduler.h"
+
+#include <stdexcept>
+
+void FrameScheduler::create(VkDevice device) {
+	this->device = device;
+	lastSubmittedValue = 0;
+	lastCompletedValue = 0;
+
+	VkSemaphoreTypeCreateInfo semaphore_type_info = {};
+	semaphore_type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	semaphore_type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE; // a 64 bit counter instead of a signaled / unsignaled flag
+	semaphore_type_info.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphore_info = {};
+	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphore_info.pNext = &semaphore_type_info;
+
+	if (vkCreateSemaphore(device, &semaphore_info, nullptr, &timelineSemaphore) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create timeline semaphore.");
+	}
+}
+
+void FrameScheduler::destroy() {
+	if (timelineSemaphore != VK_NULL_HANDLE) {
+		vkDestroySemaphore(device, timelineSemaphore, nullptr);
+		timelineSemaphore = VK_NULL_HANDLE;
+	}
+}
+
+uint64_t FrameScheduler::completedValue() {
+	if (lastCompletedValue < lastSubmittedValue) { // nothing to ask the driver if everything is known to be done
+		if (vkGetSemaphoreCounterValue(device, timelineSemaphore, &lastCompletedValue) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to query timeline semaphore value.");
+		}
+	}
+
+	return lastCompletedValue;
+}
+
+bool FrameScheduler::isComplete(uint64_t value) {
+	return value <= lastCompletedValue || value <= completedValue();
+}
+
+void FrameScheduler::wait(uint64_t value) {
+	if (value <= lastCompletedValue) { // already known to be reached, no host round trip
+		return;
+	}
+
+	VkSemaphoreWaitInfo wait_info = {};
+	wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	wait_info.semaphoreCount = 1;
+	wait_info.pSemaphores = &timelineSemaphore;
+	wait_info.pValues = &value;
+
+	if (vkWaitSemaphores(device, &wait_info, UINT64_MAX) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to wait for timeline semaphore.");
+	}
+
+	lastCompletedValue = value > lastCompletedValue ? value : lastCompletedValue;
+}
+
+void DeferredDeletionQueue::push(uint64_t timelineValue, std::function<void()> deletion) {
+	deletions.emplace_back(timelineValue, std::move(deletion));
+}
+
+void DeferredDeletionQueue::collect(uint64_t completedValue) {
+	while (!deletions.empty() && deletions.front().first <= completedValue) { // sorted by value, stop at the first one still in use
+		deletions.front().second();
+		deletions.pop_front();
+	}
+}
+
+void DeferredDeletionQueue::flush() {
+	for (auto& deletion : deletions) {
+		deletion.second();
+	}
+
+	deletions.clear();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+// frame scheduler: one timeline semaphore (Vulkan 1.2) for all GPU work
+// every submission signals the next value of the counter, so "value N is reached" means "submission N and everything before it has finished"
+// other work (uploads, compute, readback) can wait on a frame by adding semaphore() with that frame's value to its own submit, no extra fences needed
+
+class FrameScheduler {
+public:
+	void create(VkDevice device);
+	void destroy();
+
+	VkSemaphore semaphore() const { return timelineSemaphore; }
+
+	uint64_t nextSubmitValue() { return ++lastSubmittedValue; } // reserves the value the next submission will signal
+	uint64_t lastSubmitted() const { return lastSubmittedValue; }
+
+	uint64_t completedValue(); // highest value the GPU has signaled so far (cached, only queries the device when needed)
+	bool isComplete(uint64_t value);
+	void wait(uint64_t value); // blocks the host until the GPU reaches exactly this value (or a later one)
+	void waitIdle() { wait(lastSubmittedValue); }
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
+	uint64_t lastSubmittedValue = 0;
+	uint64_t lastCompletedValue = 0;
+};
+
+// deferred deletion: objects that may still be used by submitted frames are queued with the timeline value of the last submission using them
+// and destroyed once the GPU has reached that value, instead of stalling with vkDeviceWaitIdle
+
+class DeferredDeletionQueue {
+public:
+	void push(uint64_t timelineValue, std::function<void()> deletion); // values have to be pushed in non-decreasing order
+	void collect(uint64_t completedValue); // runs every deletion whose value has been reached
+	void flush(); // runs all remaining deletions, the device has to be idle
+
+private:
+	std::deque<std::pair<uint64_t, std::function<void()>>> deletions;
+};
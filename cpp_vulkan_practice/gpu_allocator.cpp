@@ -0,0 +1,551 @@
+#include "gpu_allocator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+
+#include "cpu_profiler.h"
+
+const VkDeviceSize GPU_LINEAR_ALLOCATOR_REGION_ALIGNMENT = 256; // the largest minUniformBufferOffsetAlignment the spec allows, every region starts suitably aligned for any use
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) { // alignment is a power of two
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void GpuAllocator::create(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize) {
+	this->device = device;
+	this->preferredBlockSize = preferredBlockSize;
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &properties);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	bufferImageGranularity = (std::max)(deviceProperties.limits.bufferImageGranularity, VkDeviceSize(1));
+	nonCoherentAtomSize = (std::max)(deviceProperties.limits.nonCoherentAtomSize, VkDeviceSize(1));
+	maxAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+
+	pools.resize(properties.memoryTypeCount * 2);
+	dedicatedCounts.assign(properties.memoryTypeCount, 0);
+	dedicatedBytes.assign(properties.memoryTypeCount, 0);
+	usedBytes.assign(properties.memoryTypeCount, 0);
+	allocationCounts.assign(properties.memoryTypeCount, 0);
+	deviceAllocationCount = 0;
+}
+
+void GpuAllocator::destroy() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	uint32_t leaked = 0;
+
+	for (auto& pool : pools) {
+		for (auto& block : pool.blocks) {
+			if (block.memory == VK_NULL_HANDLE) {
+				continue;
+			}
+
+			leaked += block.ranges->allocationCount();
+			freeDeviceMemory(block.memory, block.mapped != nullptr);
+		}
+	}
+
+	for (uint32_t count : dedicatedCounts) {
+		leaked += count; // their memory can't be found anymore, the driver releases it with the device
+	}
+
+	if (leaked > 0) {
+		std::cerr << "gpu allocator: " << leaked << " allocations were not freed" << std::endl;
+	}
+
+	pools.clear();
+	dedicatedCounts.clear();
+	dedicatedBytes.clear();
+	usedBytes.clear();
+	allocationCounts.clear();
+	device = VK_NULL_HANDLE;
+}
+
+uint32_t GpuAllocator::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const {
+	for (VkMemoryPropertyFlags flags : { required | preferred, required }) { // the types are ordered by the driver, the first match is the best one
+		for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+			if ((typeBits & (1u << i)) && (properties.memoryTypes[i].propertyFlags & flags) == flags) {
+				return i;
+			}
+		}
+	}
+
+	return UINT32_MAX;
+}
+
+GpuAllocation GpuAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, GpuResourceKind kind) {
+	CPU_PROFILE_SCOPE("gpu allocate");
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	GpuAllocation allocation;
+
+	// preferred properties first; if a heap is full the next type with the same properties is tried before giving up on them
+
+	for (VkMemoryPropertyFlags flags : { required | preferred, required }) {
+		for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+			if ((requirements.memoryTypeBits & (1u << i)) && (properties.memoryTypes[i].propertyFlags & flags) == flags && allocateFromType(i, requirements, kind, allocation)) {
+				return allocation;
+			}
+		}
+	}
+
+	throw std::runtime_error("Failed to allocate GPU memory.");
+}
+
+GpuAllocation GpuAllocator::allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) {
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(device, buffer, &requirements);
+
+	GpuAllocation allocation = allocate(requirements, required, preferred, GpuResourceKind::Linear);
+
+	if (vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+		free(allocation);
+		throw std::runtime_error("Failed to bind buffer memory.");
+	}
+
+	return allocation;
+}
+
+GpuAllocation GpuAllocator::allocateImage(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) {
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, image, &requirements);
+
+	GpuAllocation allocation = allocate(requirements, required, preferred, tiling == VK_IMAGE_TILING_OPTIMAL ? GpuResourceKind::Optimal : GpuResourceKind::Linear);
+
+	if (vkBindImageMemory(device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+		free(allocation);
+		throw std::runtime_error("Failed to bind image memory.");
+	}
+
+	return allocation;
+}
+
+bool GpuAllocator::allocateFromType(uint32_t memoryType, const VkMemoryRequirements& requirements, GpuResourceKind kind, GpuAllocation& allocation) {
+	VkMemoryPropertyFlags flags = properties.memoryTypes[memoryType].propertyFlags;
+	bool nonCoherent = (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	// flushes work in whole atoms, so a non-coherent allocation owns every atom it touches
+
+	VkDeviceSize alignment = nonCoherent ? (std::max)(requirements.alignment, nonCoherentAtomSize) : requirements.alignment;
+	VkDeviceSize size = nonCoherent ? alignUp(requirements.size, nonCoherentAtomSize) : requirements.size;
+
+	allocation = {};
+	allocation.memoryType = memoryType;
+	allocation.size = size;
+
+	// large resources: a dedicated allocation, nothing else would fit next to them anyway
+
+	VkDeviceSize typeBlockSize = blockSize(memoryType);
+
+	if (size > typeBlockSize / 2) {
+		uint8_t* mapped = nullptr;
+		if (!allocateDeviceMemory(memoryType, size, allocation.memory, mapped)) {
+			return false;
+		}
+
+		allocation.mapped = mapped;
+		dedicatedCounts[memoryType]++;
+		dedicatedBytes[memoryType] += size;
+		usedBytes[memoryType] += size;
+		allocationCounts[memoryType]++;
+		return true;
+	}
+
+	uint32_t index = poolIndex(memoryType, kind);
+	Pool& pool = pools[index];
+
+	auto place = [&](uint32_t blockIndex, const TlsfAllocator::Allocation& range) {
+		Block& block = pool.blocks[blockIndex];
+		allocation.memory = block.memory;
+		allocation.offset = range.offset;
+		allocation.mapped = block.mapped != nullptr ? block.mapped + range.offset : nullptr;
+		allocation.pool = index;
+		allocation.block = blockIndex;
+		allocation.node = range.node;
+		usedBytes[memoryType] += size;
+		allocationCounts[memoryType]++;
+	};
+
+	TlsfAllocator::Allocation range;
+
+	for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+		Block& block = pool.blocks[i];
+
+		if (block.memory != VK_NULL_HANDLE && block.ranges->allocate(size, alignment, range)) {
+			place(i, range);
+			return true;
+		}
+	}
+
+	// every block is full: a new one, in the slot of a released block if there is one
+
+	Block block;
+	if (!allocateDeviceMemory(memoryType, typeBlockSize, block.memory, block.mapped)) {
+		return false;
+	}
+	block.ranges = std::make_unique<TlsfAllocator>(typeBlockSize);
+
+	auto unused = std::find_if(pool.blocks.begin(), pool.blocks.end(), [](const Block& candidate) {
+		return candidate.memory == VK_NULL_HANDLE;
+	});
+
+	uint32_t blockIndex = static_cast<uint32_t>(unused - pool.blocks.begin());
+	if (unused == pool.blocks.end()) {
+		pool.blocks.push_back(std::move(block));
+	}
+	else {
+		*unused = std::move(block);
+	}
+
+	pool.blocks[blockIndex].ranges->allocate(size, alignment, range); // an empty block of at least twice the size, can't fail
+	place(blockIndex, range);
+	return true;
+}
+
+void GpuAllocator::free(GpuAllocation& allocation) {
+	if (!allocation.valid()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	usedBytes[allocation.memoryType] -= allocation.size;
+	allocationCounts[allocation.memoryType]--;
+
+	if (allocation.pool == UINT32_MAX) {
+		freeDeviceMemory(allocation.memory, allocation.mapped != nullptr);
+		dedicatedCounts[allocation.memoryType]--;
+		dedicatedBytes[allocation.memoryType] -= allocation.size;
+		allocation = {};
+		return;
+	}
+
+	Pool& pool = pools[allocation.pool];
+	Block& block = pool.blocks[allocation.block];
+	block.ranges->free(allocation.node);
+
+	// an empty block is kept if it is the last one of the pool, so a resource that is freed and created again every frame doesn't cost an allocation each time
+
+	if (block.ranges->empty()) {
+		size_t liveBlocks = std::count_if(pool.blocks.begin(), pool.blocks.end(), [](const Block& candidate) {
+			return candidate.memory != VK_NULL_HANDLE;
+		});
+
+		if (liveBlocks > 1) {
+			freeDeviceMemory(block.memory, block.mapped != nullptr);
+			block = Block();
+		}
+	}
+
+	allocation = {};
+}
+
+void GpuAllocator::flush(const GpuAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+	if (properties.memoryTypes[allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+		return;
+	}
+
+	if (size == VK_WHOLE_SIZE) {
+		size = allocation.size - offset;
+	}
+
+	// whole atoms; the allocation was aligned and sized in atoms, so this never reaches into a neighbour
+
+	VkDeviceSize start = (allocation.offset + offset) & ~(nonCoherentAtomSize - 1);
+	VkDeviceSize end = alignUp(allocation.offset + offset + size, nonCoherentAtomSize);
+
+	VkMappedMemoryRange range = {};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = allocation.memory;
+	range.offset = start;
+	range.size = allocation.pool == UINT32_MAX ? VK_WHOLE_SIZE : end - start; // a dedicated allocation may end in the middle of an atom
+
+	vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+GpuMemoryStats GpuAllocator::statistics() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	GpuMemoryStats stats;
+	stats.deviceAllocationCount = deviceAllocationCount;
+	stats.maxDeviceAllocationCount = maxAllocationCount;
+
+	for (uint32_t type = 0; type < properties.memoryTypeCount; type++) {
+		GpuMemoryTypeStats typeStats;
+		typeStats.memoryType = type;
+		typeStats.heap = properties.memoryTypes[type].heapIndex;
+		typeStats.propertyFlags = properties.memoryTypes[type].propertyFlags;
+		typeStats.dedicatedCount = dedicatedCounts[type];
+		typeStats.allocationCount = allocationCounts[type];
+		typeStats.reservedBytes = dedicatedBytes[type];
+		typeStats.usedBytes = usedBytes[type];
+
+		for (uint32_t kind = 0; kind < 2; kind++) {
+			for (const auto& block : pools[type * 2 + kind].blocks) {
+				if (block.memory == VK_NULL_HANDLE) {
+					continue;
+				}
+
+				typeStats.blockCount++;
+				typeStats.reservedBytes += block.ranges->size();
+				typeStats.freeRangeCount += block.ranges->freeRangeCount();
+				typeStats.largestFreeRange = (std::max)(typeStats.largestFreeRange, block.ranges->largestFreeRange());
+			}
+		}
+
+		if (typeStats.blockCount == 0 && typeStats.dedicatedCount == 0) {
+			continue;
+		}
+
+		stats.allocationCount += typeStats.allocationCount;
+		stats.reservedBytes += typeStats.reservedBytes;
+		stats.usedBytes += typeStats.usedBytes;
+		stats.memoryTypes.push_back(typeStats);
+	}
+
+	return stats;
+}
+
+bool GpuAllocator::allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, uint8_t*& mapped) {
+	if (deviceAllocationCount >= maxAllocationCount) {
+		return false;
+	}
+
+	VkMemoryAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.allocationSize = size;
+	allocate_info.memoryTypeIndex = memoryType;
+
+	if (vkAllocateMemory(device, &allocate_info, nullptr, &memory) != VK_SUCCESS) { // out of memory in this heap, the caller tries the next type
+		return false;
+	}
+
+	mapped = nullptr;
+
+	if (properties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) { // mapped for as long as it lives, mapping is not free
+		void* data = nullptr;
+		if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+			vkFreeMemory(device, memory, nullptr);
+			memory = VK_NULL_HANDLE;
+			return false;
+		}
+
+		mapped = static_cast<uint8_t*>(data);
+	}
+
+	deviceAllocationCount++;
+	return true;
+}
+
+void GpuAllocator::freeDeviceMemory(VkDeviceMemory memory, bool mapped) {
+	if (mapped) {
+		vkUnmapMemory(device, memory);
+	}
+
+	vkFreeMemory(device, memory, nullptr);
+	deviceAllocationCount--;
+}
+
+VkDeviceSize GpuAllocator::blockSize(uint32_t memoryType) const {
+	VkDeviceSize heapSize = properties.memoryHeaps[properties.memoryTypes[memoryType].heapIndex].size;
+	return heapSize <= GPU_MEMORY_SMALL_HEAP_SIZE ? (std::min)(preferredBlockSize, heapSize / 8) : preferredBlockSize;
+}
+
+uint32_t GpuAllocator::poolIndex(uint32_t memoryType, GpuResourceKind kind) const {
+	// with a granularity of 1 the kinds can share blocks, otherwise optimal images get blocks of their own
+
+	bool separate = bufferImageGranularity > 1 && kind == GpuResourceKind::Optimal;
+	return memoryType * 2 + (separate ? 1 : 0);
+}
+
+void GpuLinearAllocator::create(GpuAllocator& allocator, VkDevice device, VkBufferUsageFlags usage, VkDeviceSize sizePerFrame, uint32_t frameCount) {
+	this->allocator = &allocator;
+	this->device = device;
+	regionSize = alignUp(sizePerFrame, GPU_LINEAR_ALLOCATOR_REGION_ALIGNMENT);
+
+	VkBufferCreateInfo buffer_info = {};
+	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_info.size = regionSize * frameCount;
+	buffer_info.usage = usage;
+	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &buffer_info, nullptr, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create transient buffer.");
+	}
+
+	// written by the CPU every frame and read once by the GPU: host visible is required, device local (resizable BAR, integrated GPUs) is a bonus
+
+	memory = allocator.allocateBuffer(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	regionStart = 0;
+	head = 0;
+	peakUsage = 0;
+}
+
+void GpuLinearAllocator::destroy() {
+	if (buffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkDestroyBuffer(device, buffer, nullptr);
+	allocator->free(memory);
+	buffer = VK_NULL_HANDLE;
+}
+
+void GpuLinearAllocator::beginFrame(uint32_t frameIndex) {
+	regionStart = frameIndex * regionSize;
+	head = regionStart;
+}
+
+bool GpuLinearAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment, GpuTransientAllocation& allocation) {
+	VkDeviceSize offset = alignUp(head, (std::max)(alignment, VkDeviceSize(1)));
+
+	if (offset + size > regionStart + regionSize) {
+		return false;
+	}
+
+	head = offset + size;
+	peakUsage = (std::max)(peakUsage, head - regionStart);
+
+	allocation.buffer = buffer;
+	allocation.offset = offset;
+	allocation.mapped = static_cast<uint8_t*>(memory.mapped) + offset;
+	return true;
+}
+
+std::string gpuAllocatorSelfTest(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t operationCount, uint32_t seed) {
+	const VkDeviceSize blockSize = 4ull << 20; // buffers above 2 MiB are dedicated
+	const VkDeviceSize liveLimit = 64ull << 20; // frees instead of allocating above this, a software device allocates from system memory
+
+	struct LiveBuffer {
+		VkBuffer buffer;
+		GpuAllocation allocation;
+		VkDeviceSize size; // of the buffer, what is filled when mapped
+		uint8_t pattern;
+	};
+
+	GpuAllocator allocator;
+	allocator.create(physicalDevice, device, blockSize);
+
+	std::vector<LiveBuffer> live;
+	std::map<VkDeviceMemory, std::map<VkDeviceSize, VkDeviceSize>> ranges; // offset, size per device memory
+	std::mt19937 random(seed);
+	VkDeviceSize liveBytes = 0;
+	std::string error;
+
+	auto release = [&](size_t index) {
+		LiveBuffer& entry = live[index];
+
+		if (entry.allocation.mapped != nullptr && error.empty()) {
+			const uint8_t* bytes = static_cast<const uint8_t*>(entry.allocation.mapped);
+			if (std::any_of(bytes, bytes + entry.size, [&](uint8_t byte) { return byte != entry.pattern; })) {
+				error = "the mapped bytes of the buffer at " + std::to_string(entry.allocation.offset) + " were overwritten";
+			}
+		}
+
+		ranges[entry.allocation.memory].erase(entry.allocation.offset);
+		liveBytes -= entry.allocation.size;
+		vkDestroyBuffer(device, entry.buffer, nullptr);
+		allocator.free(entry.allocation);
+
+		live[index] = live.back();
+		live.pop_back();
+	};
+
+	for (uint32_t operation = 0; operation < operationCount && error.empty(); operation++) {
+		bool allocating = live.empty() || (liveBytes < liveLimit && random() % 100 < 55);
+
+		if (!allocating) {
+			release(random() % live.size());
+		}
+		else {
+			VkBufferCreateInfo buffer_info = {};
+			buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			buffer_info.size = random() % 16 == 0 ? 1 + random() % (6u << 20) : 1 + random() % 65536; // mostly small, some dedicated
+			buffer_info.usage = random() % 2 == 0 ? VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+			buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			LiveBuffer entry = {};
+			entry.size = buffer_info.size;
+			entry.pattern = static_cast<uint8_t>(operation);
+
+			if (vkCreateBuffer(device, &buffer_info, nullptr, &entry.buffer) != VK_SUCCESS) {
+				error = "failed to create a buffer of " + std::to_string(buffer_info.size) + " bytes";
+				break;
+			}
+
+			VkMemoryRequirements requirements;
+			vkGetBufferMemoryRequirements(device, entry.buffer, &requirements);
+
+			bool hostVisible = random() % 2 == 0;
+			try {
+				entry.allocation = hostVisible
+					? allocator.allocateBuffer(entry.buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+					: allocator.allocateBuffer(entry.buffer, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			}
+			catch (const std::runtime_error& e) {
+				vkDestroyBuffer(device, entry.buffer, nullptr);
+				error = e.what();
+				break;
+			}
+
+			const GpuAllocation& allocation = entry.allocation;
+
+			if (allocation.offset % requirements.alignment != 0) {
+				error = "offset " + std::to_string(allocation.offset) + " is not aligned to " + std::to_string(requirements.alignment);
+			}
+			else if (allocation.size < requirements.size || !(requirements.memoryTypeBits & (1u << allocation.memoryType))) {
+				error = "the allocation at " + std::to_string(allocation.offset) + " doesn't meet the buffer's requirements";
+			}
+			else if (hostVisible && allocation.mapped == nullptr) {
+				error = "host visible allocation at " + std::to_string(allocation.offset) + " is not mapped";
+			}
+
+			auto& memoryRanges = ranges[allocation.memory];
+			auto next = memoryRanges.lower_bound(allocation.offset);
+			if (next != memoryRanges.end() && next->first < allocation.offset + allocation.size) {
+				error = "range at " + std::to_string(allocation.offset) + " overlaps the one at " + std::to_string(next->first);
+			}
+			if (next != memoryRanges.begin() && std::prev(next)->first + std::prev(next)->second > allocation.offset) {
+				error = "range at " + std::to_string(allocation.offset) + " overlaps the one at " + std::to_string(std::prev(next)->first);
+			}
+
+			if (allocation.mapped != nullptr) {
+				std::fill_n(static_cast<uint8_t*>(allocation.mapped), entry.size, entry.pattern);
+			}
+
+			memoryRanges[allocation.offset] = allocation.size;
+			liveBytes += allocation.size;
+			live.push_back(entry);
+		}
+
+		GpuMemoryStats stats = allocator.statistics();
+		if (error.empty() && (stats.allocationCount != live.size() || stats.usedBytes != liveBytes)) {
+			error = "byte or allocation count doesn't match after operation " + std::to_string(operation);
+		}
+	}
+
+	while (!live.empty()) {
+		release(live.size() - 1);
+	}
+
+	if (error.empty()) {
+		GpuMemoryStats stats = allocator.statistics();
+		bool oneBlockPerPool = std::all_of(stats.memoryTypes.begin(), stats.memoryTypes.end(), [](const GpuMemoryTypeStats& type) {
+			return type.dedicatedCount == 0 && type.blockCount <= 2 && type.freeRangeCount == type.blockCount; // two pools per type, each keeps its last block
+		});
+
+		if (stats.allocationCount != 0 || stats.usedBytes != 0 || !oneBlockPerPool) {
+			error = "blocks or dedicated allocations are left after freeing everything";
+		}
+	}
+
+	allocator.destroy();
+	return error;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tlsf_allocator.h"
+
+// GPU memory sub-allocation: resources are placed inside a few large VkDeviceMemory blocks per memory type instead of getting an allocation each
+// vkAllocateMemory is slow and the number of live allocations is limited (maxMemoryAllocationCount, 4096 on many drivers), a block holds hundreds of resources
+//
+// - the blocks of a memory type are split with TLSF (tlsf_allocator.h), freeing a resource returns its range right away
+// - block size depends on the heap: DEFAULT_GPU_MEMORY_BLOCK_SIZE, or an eighth of a small heap so one block doesn't take it all
+// - resources larger than half a block get a dedicated allocation, they would only fragment the blocks
+// - bufferImageGranularity: buffers (and linear images) and optimal images must not share a page of that size, on devices where it is > 1 they get separate blocks
+// - host visible blocks are mapped once when created and stay mapped
+//
+// GpuLinearAllocator on top of it: per-frame transient data, a bump pointer in a host visible buffer that is reset when the frame slot comes around again
+
+const VkDeviceSize DEFAULT_GPU_MEMORY_BLOCK_SIZE = 64ull * 1024 * 1024;
+const VkDeviceSize GPU_MEMORY_SMALL_HEAP_SIZE = 1024ull * 1024 * 1024; // heaps up to this size get blocks of heapSize / 8
+
+enum class GpuResourceKind : uint32_t {
+	Linear, // buffers and VK_IMAGE_TILING_LINEAR images
+	Optimal // VK_IMAGE_TILING_OPTIMAL images
+};
+
+struct GpuAllocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0; // where the resource is bound inside memory
+	VkDeviceSize size = 0;
+	void* mapped = nullptr; // host visible memory only: the mapping at offset
+	uint32_t memoryType = UINT32_MAX;
+
+	uint32_t pool = UINT32_MAX; // where GpuAllocator::free puts it back; UINT32_MAX for a dedicated allocation
+	uint32_t block = 0;
+	uint32_t node = TlsfAllocator::INVALID_NODE;
+
+	bool valid() const { return memory != VK_NULL_HANDLE; }
+};
+
+struct GpuMemoryTypeStats {
+	uint32_t memoryType = 0;
+	uint32_t heap = 0;
+	VkMemoryPropertyFlags propertyFlags = 0;
+	uint32_t blockCount = 0;
+	uint32_t dedicatedCount = 0; // allocations that got their own VkDeviceMemory
+	uint32_t allocationCount = 0; // resources, dedicated ones included
+	VkDeviceSize reservedBytes = 0; // blocks and dedicated allocations, what the driver sees
+	VkDeviceSize usedBytes = 0; // what the resources asked for
+	uint32_t freeRangeCount = 0; // over all blocks, fragmentation
+	VkDeviceSize largestFreeRange = 0;
+};
+
+struct GpuMemoryStats {
+	std::vector<GpuMemoryTypeStats> memoryTypes; // only the types with at least one block or allocation
+	uint32_t deviceAllocationCount = 0; // live vkAllocateMemory allocations, compare with maxMemoryAllocationCount
+	uint32_t maxDeviceAllocationCount = 0;
+	uint32_t allocationCount = 0;
+	VkDeviceSize reservedBytes = 0;
+	VkDeviceSize usedBytes = 0;
+};
+
+class GpuAllocator {
+public:
+	void create(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize = DEFAULT_GPU_MEMORY_BLOCK_SIZE);
+	void destroy(); // every allocation has to be freed, blocks still in use are reported and released anyway
+
+	// required: properties the memory type must have, preferred: tried first (e.g. DEVICE_LOCAL for something the CPU writes rarely); throws if nothing fits
+	GpuAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, GpuResourceKind kind);
+	GpuAllocation allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0); // allocates and binds
+	GpuAllocation allocateImage(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+	void free(GpuAllocation& allocation); // resets it; the resource bound to it has to be destroyed (or no longer in use by the GPU) first
+
+	void flush(const GpuAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE); // makes host writes visible, nothing to do for coherent memory
+
+	uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) const; // UINT32_MAX if no type has the required properties
+	const VkPhysicalDeviceMemoryProperties& memoryProperties() const { return properties; }
+	GpuMemoryStats statistics();
+
+private:
+	struct Block {
+		VkDeviceMemory memory = VK_NULL_HANDLE; // VK_NULL_HANDLE: released, the slot is reused by the next block of the pool
+		uint8_t* mapped = nullptr;
+		std::unique_ptr<TlsfAllocator> ranges;
+	};
+
+	struct Pool { // one per memory type and resource kind
+		std::vector<Block> blocks;
+	};
+
+	bool allocateFromType(uint32_t memoryType, const VkMemoryRequirements& requirements, GpuResourceKind kind, GpuAllocation& allocation); // callers hold the mutex
+	bool allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, uint8_t*& mapped);
+	void freeDeviceMemory(VkDeviceMemory memory, bool mapped);
+	VkDeviceSize blockSize(uint32_t memoryType) const;
+	uint32_t poolIndex(uint32_t memoryType, GpuResourceKind kind) const;
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties properties = {};
+	VkDeviceSize bufferImageGranularity = 1;
+	VkDeviceSize nonCoherentAtomSize = 1;
+	uint32_t maxAllocationCount = 0;
+	VkDeviceSize preferredBlockSize = DEFAULT_GPU_MEMORY_BLOCK_SIZE;
+
+	std::mutex mutex;
+	std::vector<Pool> pools; // memoryTypeCount * 2, see poolIndex
+	std::vector<uint32_t> dedicatedCounts; // per memory type
+	std::vector<VkDeviceSize> dedicatedBytes;
+	std::vector<VkDeviceSize> usedBytes; // per memory type, blocks and dedicated
+	std::vector<uint32_t> allocationCounts;
+	uint32_t deviceAllocationCount = 0;
+};
+
+struct GpuTransientAllocation {
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0; // inside buffer, e.g. for vkCmdBindVertexBuffers or a dynamic uniform buffer offset
+	void* mapped = nullptr; // write the data here, the memory is host coherent
+};
+
+class GpuLinearAllocator {
+public:
+	// one buffer of frameCount regions of sizePerFrame bytes each, host visible and coherent (device local too if there is such a type)
+	void create(GpuAllocator& allocator, VkDevice device, VkBufferUsageFlags usage, VkDeviceSize sizePerFrame, uint32_t frameCount);
+	void destroy();
+
+	void beginFrame(uint32_t frameIndex); // the GPU is done with the frame that last used this region, its data is overwritten from now on
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, GpuTransientAllocation& allocation); // false if the region of the frame is full
+
+	VkDeviceSize frameUsage() const { return head - regionStart; } // bytes handed out in the current frame
+	VkDeviceSize peakFrameUsage() const { return peakUsage; }
+	VkDeviceSize capacityPerFrame() const { return regionSize; }
+
+private:
+	GpuAllocator* allocator = nullptr;
+	VkDevice device = VK_NULL_HANDLE;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	GpuAllocation memory;
+	VkDeviceSize regionSize = 0; // a multiple of the largest alignment a use of the buffer may need
+	VkDeviceSize regionStart = 0;
+	VkDeviceSize head = 0;
+	VkDeviceSize peakUsage = 0;
+};
+
+// randomized buffers allocated, bound and freed on a real device (a software ICD such as lavapipe is enough), with small blocks so several blocks and dedicated allocations come up
+// checked: alignment, overlap inside each VkDeviceMemory, the mapped bytes of every host visible buffer still intact when it is freed, the statistics, and one block per pool left once everything is freed
+// empty on success, otherwise what went wrong (--gpu-self-test)
+std::string gpuAllocatorSelfTest(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t operationCount, uint32_t seed);
@@ -0,0 +1,281 @@
+#include "gpu_profiler.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#include "statistics.h"
+
+const uint32_t PIPELINE_STATISTICS_COUNT = 3; // results come in flag bit order
+const VkQueryPipelineStatisticFlags PIPELINE_STATISTICS_FLAGS =
+	VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+const uint32_t NO_SCOPE = UINT32_MAX; // marks a scope that didn't fit into the query pool, so endScope still pairs up
+
+void GpuProfiler::create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameSlotCount, bool pipelineStatistics) {
+	this->device = device;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits; // 0: the queue can't write timestamps
+	timestampsSupported = validBits > 0;
+	pipelineStatisticsSupported = timestampsSupported && pipelineStatistics;
+	timestampPeriodNs = deviceProperties.limits.timestampPeriod;
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	if (!timestampsSupported) {
+		return;
+	}
+
+	frames.resize(frameSlotCount);
+
+	for (auto& frameQueries : frames) {
+		VkQueryPoolCreateInfo timestamp_pool_info = {};
+		timestamp_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		timestamp_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		timestamp_pool_info.queryCount = GPU_PROFILER_MAX_SCOPES * 2; // begin and end of every scope
+
+		if (vkCreateQueryPool(device, &timestamp_pool_info, nullptr, &frameQueries.timestampPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create timestamp query pool.");
+		}
+
+		if (pipelineStatisticsSupported) {
+			VkQueryPoolCreateInfo statistics_pool_info = {};
+			statistics_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			statistics_pool_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+			statistics_pool_info.queryCount = GPU_PROFILER_MAX_SCOPES;
+			statistics_pool_info.pipelineStatistics = PIPELINE_STATISTICS_FLAGS;
+
+			if (vkCreateQueryPool(device, &statistics_pool_info, nullptr, &frameQueries.statisticsPool) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create pipeline statistics query pool.");
+			}
+		}
+	}
+}
+
+void GpuProfiler::destroy() {
+	for (auto& frameQueries : frames) {
+		vkDestroyQueryPool(device, frameQueries.timestampPool, nullptr);
+
+		if (frameQueries.statisticsPool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(device, frameQueries.statisticsPool, nullptr);
+		}
+	}
+
+	frames.clear();
+	currentFrame = nullptr;
+}
+
+VkQueryPipelineStatisticFlags GpuProfiler::pipelineStatisticsFlags() const {
+	return pipelineStatisticsSupported ? PIPELINE_STATISTICS_FLAGS : 0;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot, bool pipelineStatistics) {
+	if (!timestampsSupported) {
+		return;
+	}
+
+	currentFrame = &frames[frameSlot];
+	framePipelineStatistics = pipelineStatistics;
+	openScopes.clear();
+
+	collectResults(*currentFrame); // the slot's previous frame has finished, its results are ready
+
+	vkCmdResetQueryPool(commandBuffer, currentFrame->timestampPool, 0, GPU_PROFILER_MAX_SCOPES * 2); // queries have to be reset before they are written again
+	if (currentFrame->statisticsPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, currentFrame->statisticsPool, 0, GPU_PROFILER_MAX_SCOPES);
+	}
+
+	currentFrame->scopes.clear();
+	currentFrame->timestampCount = 0;
+	currentFrame->statisticsCount = 0;
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string& name) {
+	if (currentFrame == nullptr || currentFrame->scopes.size() == GPU_PROFILER_MAX_SCOPES) {
+		openScopes.push_back(NO_SCOPE);
+		return;
+	}
+
+	ScopeQuery scope = {};
+	scope.name = openScopes.empty() || openScopes.back() == NO_SCOPE ? name : currentFrame->scopes[openScopes.back()].name + "/" + name;
+	scope.depth = static_cast<uint32_t>(openScopes.size());
+	scope.beginQuery = currentFrame->timestampCount++;
+	scope.endQuery = currentFrame->timestampCount++;
+	scope.statisticsQuery = -1;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, currentFrame->timestampPool, scope.beginQuery); // written once all previous commands reached the top of the pipe
+
+	if (currentFrame->statisticsPool != VK_NULL_HANDLE && framePipelineStatistics && openScopes.empty()) { // pipeline statistics queries of one pool can't be nested, so only outermost scopes get them
+		scope.statisticsQuery = static_cast<int32_t>(currentFrame->statisticsCount++);
+		vkCmdBeginQuery(commandBuffer, currentFrame->statisticsPool, scope.statisticsQuery, 0);
+	}
+
+	openScopes.push_back(static_cast<uint32_t>(currentFrame->scopes.size()));
+	currentFrame->scopes.push_back(scope);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer) {
+	if (openScopes.empty()) {
+		throw std::runtime_error("GPU profiler: endScope without beginScope.");
+	}
+
+	uint32_t scopeIndex = openScopes.back();
+	openScopes.pop_back();
+
+	if (scopeIndex == NO_SCOPE) {
+		return;
+	}
+
+	const ScopeQuery& scope = currentFrame->scopes[scopeIndex];
+
+	if (scope.statisticsQuery >= 0) {
+		vkCmdEndQuery(commandBuffer, currentFrame->statisticsPool, scope.statisticsQuery);
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, currentFrame->timestampPool, scope.endQuery); // written once all previous commands are completely done
+}
+
+void GpuProfiler::resetStatistics() {
+	history.clear();
+
+	for (auto& frameQueries : frames) { // beginFrame() still resets the queries themselves, there is just nothing left to collect
+		frameQueries.scopes.clear();
+	}
+}
+
+void GpuProfiler::collectResults(FrameQueries& frameQueries) {
+	if (frameQueries.scopes.empty()) {
+		return;
+	}
+
+	// VK_QUERY_RESULT_WITH_AVAILABILITY_BIT: every result is followed by a flag, no VK_QUERY_RESULT_WAIT_BIT, so this never blocks
+
+	std::vector<uint64_t> timestamps(frameQueries.timestampCount * 2);
+	vkGetQueryPoolResults(device, frameQueries.timestampPool, 0, frameQueries.timestampCount, timestamps.size() * sizeof(uint64_t), timestamps.data(),
+		sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+	const uint32_t statisticsStride = PIPELINE_STATISTICS_COUNT + 1;
+	std::vector<uint64_t> statistics(frameQueries.statisticsCount * statisticsStride);
+	if (frameQueries.statisticsCount > 0) {
+		vkGetQueryPoolResults(device, frameQueries.statisticsPool, 0, frameQueries.statisticsCount, statistics.size() * sizeof(uint64_t), statistics.data(),
+			sizeof(uint64_t) * statisticsStride, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	}
+
+	for (const auto& scope : frameQueries.scopes) {
+		bool available = timestamps[scope.beginQuery * 2 + 1] != 0 && timestamps[scope.endQuery * 2 + 1] != 0;
+		if (!available) { // skipped, e.g. the frame was never submitted
+			continue;
+		}
+
+		uint64_t ticks = (timestamps[scope.endQuery * 2] - timestamps[scope.beginQuery * 2]) & timestampMask;
+
+		ScopeHistory& scopeHistory = history[scope.name];
+		scopeHistory.depth = scope.depth;
+		addSample(scopeHistory.durationsMs, scopeHistory.sampleCount, ticks * timestampPeriodNs / 1000000.0);
+
+		if (scope.statisticsQuery >= 0) {
+			const uint64_t* values = &statistics[scope.statisticsQuery * statisticsStride];
+
+			if (values[PIPELINE_STATISTICS_COUNT] != 0) {
+				addSample(scopeHistory.vertexInvocations, scopeHistory.sampleCount, static_cast<double>(values[0]));
+				addSample(scopeHistory.clippingPrimitives, scopeHistory.sampleCount, static_cast<double>(values[1]));
+				addSample(scopeHistory.fragmentInvocations, scopeHistory.sampleCount, static_cast<double>(values[2]));
+			}
+		}
+
+		scopeHistory.sampleCount++;
+	}
+
+	frameQueries.scopes.clear();
+}
+
+void GpuProfiler::addSample(std::vector<double>& history, uint64_t sampleIndex, double value) { // rolling window: append until full, then overwrite the oldest sample
+	if (history.size() < GPU_PROFILER_HISTORY) {
+		history.push_back(value);
+	}
+	else {
+		history[sampleIndex % GPU_PROFILER_HISTORY] = value;
+	}
+}
+
+std::vector<GpuScopeStats> GpuProfiler::statistics() const {
+	std::vector<GpuScopeStats> result;
+
+	for (const auto& [name, scopeHistory] : history) {
+		GpuScopeStats stats;
+		stats.name = name;
+		stats.depth = scopeHistory.depth;
+		stats.sampleCount = scopeHistory.sampleCount;
+		stats.averageMs = average(scopeHistory.durationsMs);
+		stats.p50Ms = percentile(scopeHistory.durationsMs, 0.50);
+		stats.p95Ms = percentile(scopeHistory.durationsMs, 0.95);
+		stats.p99Ms = percentile(scopeHistory.durationsMs, 0.99);
+		stats.hasPipelineStatistics = !scopeHistory.vertexInvocations.empty();
+		stats.averageVertexInvocations = average(scopeHistory.vertexInvocations);
+		stats.averageClippingPrimitives = average(scopeHistory.clippingPrimitives);
+		stats.averageFragmentInvocations = average(scopeHistory.fragmentInvocations);
+		result.push_back(stats);
+	}
+
+	return result;
+}
+
+void GpuProfiler::writeCsv(const std::string& path) const {
+	std::ofstream file(path);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open GPU profile output file.");
+	}
+
+	file << "scope,depth,samples,avg_ms,p50_ms,p95_ms,p99_ms,vertex_invocations,clipping_primitives,fragment_invocations\n";
+
+	for (const auto& stats : statistics()) {
+		file << stats.name << ',' << stats.depth << ',' << stats.sampleCount << ','
+			<< stats.averageMs << ',' << stats.p50Ms << ',' << stats.p95Ms << ',' << stats.p99Ms << ',';
+
+		if (stats.hasPipelineStatistics) {
+			file << stats.averageVertexInvocations << ',' << stats.averageClippingPrimitives << ',' << stats.averageFragmentInvocations;
+		}
+		else {
+			file << ",,";
+		}
+
+		file << '\n';
+	}
+}
+
+void GpuProfiler::writeJson(const std::string& path) const {
+	std::ofstream file(path);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open GPU profile output file.");
+	}
+
+	file << "{\n\t\"timestampPeriodNs\": " << timestampPeriodNs << ",\n\t\"scopes\": [";
+
+	bool first = true;
+	for (const auto& stats : statistics()) { // scope names are our own string literals, nothing to escape
+		file << (first ? "\n" : ",\n") << "\t\t{ \"name\": \"" << stats.name << "\", \"depth\": " << stats.depth
+			<< ", \"samples\": " << stats.sampleCount << ", \"avgMs\": " << stats.averageMs
+			<< ", \"p50Ms\": " << stats.p50Ms << ", \"p95Ms\": " << stats.p95Ms << ", \"p99Ms\": " << stats.p99Ms;
+
+		if (stats.hasPipelineStatistics) {
+			file << ", \"vertexInvocations\": " << stats.averageVertexInvocations
+				<< ", \"clippingPrimitives\": " << stats.averageClippingPrimitives
+				<< ", \"fragmentInvocations\": " << stats.averageFragmentInvocations;
+		}
+
+		file << " }";
+		first = false;
+	}
+
+	file << "\n\t]\n}\n";
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// GPU profiler: timestamp queries around named (nestable) scopes, plus pipeline statistics for outermost scopes if the device supports them
+// every frame slot has its own query pools; results are read when the slot comes around again, i.e. after the frame scheduler has waited for it,
+// so reading never stalls on the GPU (results are as many frames late as there are frames in flight)
+
+const uint32_t GPU_PROFILER_MAX_SCOPES = 64; // per frame
+const uint32_t GPU_PROFILER_HISTORY = 256; // samples per scope used for averages and percentiles
+
+struct GpuScopeStats {
+	std::string name; // nested scopes are named "outer/inner"
+	uint32_t depth = 0;
+	uint64_t sampleCount = 0; // total, the statistics below only cover the last GPU_PROFILER_HISTORY samples
+	double averageMs = 0.0;
+	double p50Ms = 0.0;
+	double p95Ms = 0.0;
+	double p99Ms = 0.0;
+	bool hasPipelineStatistics = false;
+	double averageVertexInvocations = 0.0;
+	double averageClippingPrimitives = 0.0;
+	double averageFragmentInvocations = 0.0;
+};
+
+class GpuProfiler {
+public:
+	// pipelineStatistics: the pipelineStatisticsQuery feature is enabled on the device
+	void create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameSlotCount, bool pipelineStatistics);
+	void destroy();
+
+	bool enabled() const { return timestampsSupported; }
+	VkQueryPipelineStatisticFlags pipelineStatisticsFlags() const; // secondary command buffers executed inside a profiled scope have to inherit these
+
+	// collects the slot's previous results and resets its queries; outside of a render pass
+	// pipelineStatistics false: no statistics query this frame, e.g. it executes secondary command buffers and the device can't inherit queries
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot, bool pipelineStatistics = true);
+	void beginScope(VkCommandBuffer commandBuffer, const std::string& name);
+	void endScope(VkCommandBuffer commandBuffer);
+
+	void resetStatistics(); // drops the collected samples and the results of frames still in flight (e.g. after a warm-up); between frames only
+	std::vector<GpuScopeStats> statistics() const;
+	void writeCsv(const std::string& path) const;
+	void writeJson(const std::string& path) const;
+
+private:
+	struct ScopeQuery {
+		std::string name;
+		uint32_t depth;
+		uint32_t beginQuery;
+		uint32_t endQuery;
+		int32_t statisticsQuery; // -1: no pipeline statistics for this scope
+	};
+
+	struct FrameQueries {
+		VkQueryPool timestampPool = VK_NULL_HANDLE;
+		VkQueryPool statisticsPool = VK_NULL_HANDLE;
+		std::vector<ScopeQuery> scopes; // recorded into this slot's command buffer, waiting for their results
+		uint32_t timestampCount = 0;
+		uint32_t statisticsCount = 0;
+	};
+
+	struct ScopeHistory {
+		uint32_t depth = 0;
+		uint64_t sampleCount = 0;
+		std::vector<double> durationsMs; // ring buffer of the last GPU_PROFILER_HISTORY samples
+		std::vector<double> vertexInvocations;
+		std::vector<double> clippingPrimitives;
+		std::vector<double> fragmentInvocations;
+	};
+
+	void collectResults(FrameQueries& frameQueries);
+	static void addSample(std::vector<double>& history, uint64_t sampleIndex, double value);
+
+	VkDevice device = VK_NULL_HANDLE;
+	bool timestampsSupported = false;
+	bool pipelineStatisticsSupported = false;
+	double timestampPeriodNs = 1.0; // nanoseconds per timestamp tick
+	uint64_t timestampMask = ~0ull; // only timestampValidBits of a timestamp are meaningful
+
+	std::vector<FrameQueries> frames;
+	FrameQueries* currentFrame = nullptr;
+	bool framePipelineStatistics = true; // set by beginFrame
+	std::vector<uint32_t> openScopes; // indices into currentFrame->scopes
+	std::map<std::string, ScopeHistory> history;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a, 64 bit: fast and good enough to tell files and pipeline descriptions apart, not for anything security related
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+inline uint64_t fnv1a(const void* data, size_t size, uint64_t value = FNV_OFFSET_BASIS) { // pass the previous result as value to hash several pieces in a row
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	for (size_t i = 0; i < size; i++) {
+		value ^= bytes[i];
+		value *= 1099511628211ull;
+	}
+
+	return value;
+}
@@ -0,0 +1,2763 @@
+// credits to https://vulkan-tutorial.com/ :)
+
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#ifdef _WIN32
+#define VK_USE_PLATFORM_WIN32_KHR
+#define GLFW_EXPOSE_NATIVE_WIN32
+#endif
+
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <vector>
+#include <optional>
+#ifdef _WIN32
+#include <GLFW/glfw3native.h>
+#endif
+#include <set>
+#include <fstream>
+#include <functional>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <random>
+
+#include <cstdint> // Necessary for uint32_t
+#include <limits> // Necessary for std::numeric_limits
+#include <algorithm> // Necessary for std::clamp
+
+#include "extended_dynamic_state.h"
+#include "frame_scheduler.h"
+#include "gpu_allocator.h"
+#include "upload_queue.h"
+#include "mesh.h"
+#include "mesh_importer.h"
+#include "mesh_optimizer.h"
+#include "vertex_quantization.h"
+#include "pipeline_cache.h"
+#include "pipeline_compiler.h"
+#include "pipeline_layout_cache.h"
+#include "shader_bundle.h"
+#include "shader_compiler.h"
+#include "file_watcher.h"
+#include "parallel_command_recorder.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+
+const uint32_t WIDTH = 800;
+const uint32_t HEIGHT = 600;
+
+// frames in flight: how many frames the CPU is allowed to record ahead of the GPU (1 = lockstep, every frame waits for the previous one)
+
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+const uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+
+// headless mode: no window and no surface, frames are rendered into a ring of offscreen images instead of swap chain images
+
+const uint32_t OFFSCREEN_IMAGE_COUNT = MAX_FRAMES_IN_FLIGHT;
+const VkFormat OFFSCREEN_IMAGE_FORMAT = VK_FORMAT_R8G8B8A8_UNORM; // color attachment support is mandatory for this format, also on lavapipe / SwiftShader
+const uint32_t DEFAULT_HEADLESS_FRAMES = 100;
+
+// per-frame transient data (GpuLinearAllocator): bytes each frame in flight can hand out
+
+const VkDeviceSize TRANSIENT_BUFFER_SIZE_PER_FRAME = 1024 * 1024;
+
+// uploads (UploadQueue): size of the staging ring the copies to device local memory go through
+
+const VkDeviceSize STAGING_RING_SIZE = DEFAULT_STAGING_RING_SIZE;
+
+const char* const DEFAULT_PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+// background pipeline compilation: worker threads that build the optimized pipelines while frames are drawn with an unoptimized fallback
+
+const uint32_t DEFAULT_PIPELINE_COMPILE_THREADS = 2;
+
+// runtime shader compilation: GLSL sources and the directory of the content addressed SPIR-V cache
+
+const char* const VERTEX_SHADER_SOURCE = "shaders/shader.vert";
+const char* const FRAGMENT_SHADER_SOURCE = "shaders/shader.frag";
+const char* const DEFAULT_SHADER_CACHE_DIRECTORY = "shader_cache";
+
+// prebuilt shaders: every module in one memory mapped file, written by --write-shader-bundle (the loose .spv files are the fallback)
+
+const char* const DEFAULT_SHADER_BUNDLE_PATH = "shaders/shaders.bundle";
+
+// shader hot reload: the watched directory, and how long it has to be quiet before a change is picked up (editors save in several steps)
+
+const char* const SHADER_DIRECTORY = "shaders";
+const std::chrono::milliseconds HOT_RELOAD_SETTLE_TIME(100);
+
+// specialization constants of the shaders, the IDs have to match the constant_id declarations
+
+using BrightnessConstant = SpecializationConstant<0, float>; // shader.frag: BRIGHTNESS
+using FragmentConstants = SpecializationConstants<BrightnessConstant>;
+
+// scene materials: the fixed function settings that are combined into the material permutations (see materialState)
+
+const VkCompareOp MATERIAL_DEPTH_COMPARE_OPS[] = { VK_COMPARE_OP_LESS, VK_COMPARE_OP_LESS_OR_EQUAL, VK_COMPARE_OP_GREATER, VK_COMPARE_OP_ALWAYS };
+
+// a drag-resize sends a resize event every few milliseconds, the swap chain is only recreated once the size has stopped changing for this long
+// (or right away if presenting is no longer possible)
+
+const std::chrono::milliseconds RESIZE_SETTLE_TIME(50);
+
+// validate wheter the program is being compiled in debug mode or not
+
+const std::vector<const char*> validationLayers = {
+	"VK_LAYER_KHRONOS_validation"
+};
+
+#ifdef NDEBUG // or CHECK_VULKAN_RESULT
+const bool enableValidationLayers = false;
+#else 
+const bool enableValidationLayers = true;
+#endif
+
+// debug
+
+inline VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
+	auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
+	if (func != nullptr) {
+		return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
+	}
+	else {
+		return VK_ERROR_EXTENSION_NOT_PRESENT;
+	}
+}
+
+inline void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator) {
+	auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
+	if (func != nullptr) {
+		func(instance, debugMessenger, pAllocator);
+	}
+}
+
+// structs
+
+struct QueueFamilyIndices {
+	std::optional<uint32_t> graphicsFamily; // or without optional, just uint32_t
+	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> transferFamily; // transfer-only (no graphics, no compute), the copy engine; not every device has one
+
+	bool isComplete() {
+		return graphicsFamily.has_value() && presentFamily.has_value();
+	}
+};
+
+struct SwapChainSupportDetails {
+	VkSurfaceCapabilitiesKHR capabilities;
+	std::vector<VkSurfaceFormatKHR> formats;
+	std::vector<VkPresentModeKHR> presentModes;
+};
+
+struct AppConfig { // runtime options, filled from the command line in main()
+	uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT; // size of the per-frame resource ring, clamped to [1, MAX_FRAMES_IN_FLIGHT]
+	uint32_t benchmarkFrames = 0; // 0: normal window loop, otherwise render this many frames in lockstep and with the ring and print the timings
+	bool headless = false; // skip GLFW and the surface, render into offscreen images
+	uint32_t headlessFrames = DEFAULT_HEADLESS_FRAMES; // frames rendered by the headless main loop
+	uint32_t width = WIDTH; // window size, or size of the offscreen images
+	uint32_t height = HEIGHT;
+	std::string pipelineCachePath = DEFAULT_PIPELINE_CACHE_PATH; // empty: don't load or save the pipeline cache
+	uint32_t pipelineCompileThreads = DEFAULT_PIPELINE_COMPILE_THREADS; // 0: compile pipelines synchronously in initVulkan, no fallback pipeline
+	bool runtimeShaderCompile = true; // compile the GLSL sources with shaderc (cached), false: load the .spv files built by shaders/compile.sh (compile.bat on Windows)
+	std::string shaderCacheDirectory = DEFAULT_SHADER_CACHE_DIRECTORY; // empty: compile the shaders on every start
+	std::string shaderBundlePath = DEFAULT_SHADER_BUNDLE_PATH; // read without runtimeShaderCompile
+	bool writeShaderBundle = false; // compile the shaders at startup and pack them into shaderBundlePath
+	bool hotReload = false; // watch the shader sources and rebuild the pipeline in the background when they change
+	ShaderOptimization shaderOptimization = ShaderOptimization::Performance; // spirv-tools passes for the runtime compiled shaders, a preset also freezes the specialization constants into the modules
+	float brightness = 1.0f; // fragment color multiplier, a specialization constant (frozen into the module and folded when the shaders are optimized)
+	bool dynamicRendering = true; // vkCmdBeginRendering instead of a render pass and framebuffers where the device has it (Vulkan 1.3 or VK_KHR_dynamic_rendering)
+	bool transferQueue = true; // uploads on a transfer-only queue where the device has one, otherwise (or false) on the graphics queue
+	uint32_t streamingUploadKiB = 0; // > 0: upload this much into a device local buffer every frame, exercises the staging ring and the transfer queue
+	bool extendedDynamicState = true; // set the material state (cull mode, front face, depth, blending) while recording where the device can, materials that only differ there share a pipeline
+	uint32_t materialCount = 1; // fixed function permutations the scene's draws are spread over, at least 1
+	bool staticCommandBuffers = false; // record one command buffer per framebuffer once and resubmit it, instead of recording every frame
+	uint32_t recordThreads = 0; // 0: record inline on the main thread, otherwise split the draws across this many worker threads (secondary command buffers)
+	uint32_t sceneDrawCount = 1; // number of draw calls per frame (the triangle, drawn again with a different instance index)
+	uint32_t recordingBenchmarkFrames = 0; // > 0: render this many frames for several worker thread counts and print the recording times
+	bool gpuProfiling = false; // time the GPU work with the profiler, implied by gpuProfilePath
+	std::string gpuProfilePath; // non-empty: profile the GPU and write the per-scope statistics to this file at exit (.json, anything else is CSV)
+	std::string cpuTracePath; // non-empty: record CPU scopes and write them as a Chrome trace (chrome://tracing) at exit
+	bool quantizationReport = false; // print the packed vertex error of the scene mesh and a test sphere instead of rendering
+	std::string meshPath; // non-empty: import this OBJ, glTF or GLB file as the scene mesh instead of the triangle
+	bool optimizeMesh = true; // reorder the imported mesh for the vertex cache, overdraw and vertex fetch (mesh_optimizer.h)
+	bool selfTest = false; // run the CPU self tests (the TLSF allocator) instead of rendering, throws on a failure
+	bool gpuSelfTest = false; // run the GpuAllocator self test on the first Vulkan device instead of rendering, no window; skipped when there is no device
+	bool meshOptimizationReport = false; // print the simulated vertex cache, vertex fetch and overdraw statistics before and after the optimization instead of rendering
+};
+
+struct FrameResources { // everything one frame in flight owns; a slot is only reused once the GPU has finished the frame that last used it
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkCommandBuffer uploadCommandBuffer = VK_NULL_HANDLE; // acquire barriers for the uploads the frame waits on, submitted in front of commandBuffer
+	VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE; // binary, swap chain acquire can't signal a timeline semaphore
+	VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE; // binary, presentation can't wait on a timeline semaphore
+	uint64_t timelineValue = 0; // FrameScheduler value signaled when the last frame submitted from this slot is done
+	std::vector<std::function<void()>> transientDeletions; // per-frame allocations, released the next time this slot comes around
+};
+
+struct FrameTimings { // accumulated by drawFrame(), used by the benchmark
+	uint32_t frameCount = 0;
+	double cpuFrameMs = 0.0; // total time spent inside drawFrame
+	double gpuWaitMs = 0.0; // part of it spent blocked on the GPU
+	double recordMs = 0.0; // part of it spent recording command buffers
+	uint32_t recreateCount = 0; // swap chain recreations (resizes)
+	double recreateMs = 0.0; // time spent in them
+	uint64_t pipelineBinds = 0; // vkCmdBindPipeline calls recorded for the draws
+	uint64_t dynamicStateCalls = 0; // vkCmdSet* calls recorded for the material state
+	uint64_t uploadBytes = 0; // copied through the staging ring
+	double uploadMs = 0.0; // time spent staging and submitting the uploads
+};
+
+enum class DynamicRenderingSupport {
+	None, // render pass and framebuffers
+	Extension, // VK_KHR_dynamic_rendering on a Vulkan 1.2 device
+	Core // Vulkan 1.3
+};
+
+class HelloTriangleApplication {
+public:
+	HelloTriangleApplication(const AppConfig& config = {}) : config(config) {
+		this->config.framesInFlight = std::clamp(config.framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+		this->config.gpuProfiling = config.gpuProfiling || !config.gpuProfilePath.empty();
+		this->config.materialCount = (std::max)(config.materialCount, 1u);
+	}
+
+	void run() {
+		if (config.quantizationReport) { // CPU only, no device needed
+			printQuantizationReports();
+			return;
+		}
+
+		if (config.meshOptimizationReport) {
+			printMeshOptimizationReports();
+			return;
+		}
+
+		if (config.selfTest) {
+			runSelfTests();
+			return;
+		}
+
+		if (config.gpuSelfTest) {
+			runGpuSelfTests();
+			return;
+		}
+
+		initialize();
+
+		if (config.recordingBenchmarkFrames > 0) {
+			runRecordingBenchmark();
+		}
+		else if (config.benchmarkFrames > 0) {
+			runBenchmark();
+		}
+		else {
+			mainLoop();
+		}
+
+		cleanup();
+	}
+
+	// driving the renderer from outside (the cpp_vulkan_benchmark executable): initialize(), renderFrames() as often as needed, shutdown()
+
+	void initialize() {
+		if (!config.cpuTracePath.empty()) {
+			CpuProfiler::setEnabled(true);
+			CpuProfiler::setThreadName("main");
+		}
+
+		initWindow();
+		initVulkan();
+	}
+
+	void renderFrames(uint32_t count) {
+		for (uint32_t i = 0; i < count; i++) {
+			drawFrame();
+		}
+	}
+
+	void finishPipelineCompilation() { // blocks until the optimized pipelines are in use, so measurements don't include the fallback
+		updatePendingPipeline(true);
+	}
+
+	void waitIdle() { // waits for every submitted frame, without vkDeviceWaitIdle
+		frameScheduler.waitIdle();
+	}
+
+	void shutdown() {
+		vkDeviceWaitIdle(device);
+		cleanup();
+	}
+
+	void resetTimings() { // CPU frame timings, GPU profiler samples and upload counters
+		frameTimings = {};
+		gpuProfiler.resetStatistics();
+		uploadQueue.resetStatistics();
+	}
+
+	const FrameTimings& timings() const {
+		return frameTimings;
+	}
+
+	std::vector<GpuScopeStats> gpuStatistics() const { // empty unless config.gpuProfiling is set and the queue supports timestamps
+		return gpuProfiler.enabled() ? gpuProfiler.statistics() : std::vector<GpuScopeStats>{};
+	}
+
+	bool usesDynamicRendering() const {
+		return dynamicRenderingSupport != DynamicRenderingSupport::None;
+	}
+
+	uint32_t pipelineCount() const { // graphics pipelines the materials need, one per combination of baked state
+		return static_cast<uint32_t>(graphicsPipelines.size());
+	}
+
+	DynamicStateFlags dynamicStateFields() const { // material state the pipelines leave dynamic
+		return dynamicMaterialState;
+	}
+
+	GpuMemoryStats gpuMemoryStatistics() {
+		return gpuAllocator.statistics();
+	}
+
+	const UploadStats& uploadStatistics() const {
+		return uploadQueue.statistics();
+	}
+
+	bool usesTransferQueue() const { // uploads go to a transfer-only queue family, with ownership transfers
+		return uploadQueue.separateFamily();
+	}
+
+	double measureRenderTargetRecreation(uint32_t count) { // average ms to replace the image views and (render pass path) framebuffers and destroy the old ones, what a resize costs on top of the swap chain itself
+		frameScheduler.waitIdle();
+
+		double totalMs = 0.0;
+
+		for (uint32_t i = 0; i < count; i++) {
+			auto start = std::chrono::steady_clock::now();
+
+			retireRenderTargets();
+			createImageViews();
+			createFramebuffers();
+			deletionQueue.collect(frameScheduler.completedValue()); // nothing is in flight, the retired objects are destroyed right away
+
+			totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		return count > 0 ? totalMs / count : 0.0;
+	}
+
+	std::string deviceName() const {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		return properties.deviceName;
+	}
+
+private:
+	AppConfig config;
+	GLFWwindow* window = nullptr;
+	VkInstance instance;
+	VkDebugUtilsMessengerEXT debugMessenger;
+	VkDevice device;
+	VkQueue graphicsQueue;
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+	VkQueue presentQueue;
+	VkQueue transferQueue = VK_NULL_HANDLE; // the graphics queue if there is no transfer-only family (or config.transferQueue is off)
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkSwapchainKHR swapChain;
+	std::vector<VkImage> swapChainImages; // in headless mode: the offscreen images
+	std::vector<GpuAllocation> offscreenImageMemory; // headless only, swap chain images are owned by the swap chain
+	VkFormat swapChainImageFormat;
+	VkExtent2D swapChainExtent;
+	std::vector<VkImageView> swapChainImageViews;
+	PipelineLayoutCache pipelineLayoutCache; // every pipeline layout and descriptor set layout, made from the shader reflection
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE; // layout of graphicsPipelines, owned by pipelineLayoutCache
+	VkRenderPass renderPass = VK_NULL_HANDLE; // stays null with dynamic rendering
+	DynamicRenderingSupport dynamicRenderingSupport = DynamicRenderingSupport::None; // what the device was created with, None if config.dynamicRendering is off
+	PFN_vkCmdBeginRendering cmdBeginRendering = nullptr; // core or KHR entry point, whichever the device has
+	PFN_vkCmdEndRendering cmdEndRendering = nullptr;
+	ExtendedDynamicState extendedDynamicState; // what the device supports and the vkCmdSet* entry points
+	DynamicStateFlags dynamicMaterialState = 0; // fields of the material state the pipelines leave dynamic, 0 if config.extendedDynamicState is off
+	std::vector<FixedFunctionState> materials; // config.materialCount entries
+	std::vector<uint32_t> materialPipelines; // material -> index into graphicsPipelines
+	std::vector<FixedFunctionState> pipelineStates; // per pipeline: the state of the first material using it (only its baked fields matter)
+	std::vector<VkPipeline> graphicsPipelines; // the fallback pipelines until pendingPipelines is ready
+	PipelineCache pipelineCache;
+	ShaderCompiler shaderCompiler; // only created if config.runtimeShaderCompile is set
+	ShaderBundle shaderBundle; // only opened if it isn't; pipelines may be built from it as long as it is open
+	PipelineCompiler pipelineCompiler; // only created if config.pipelineCompileThreads > 0
+	std::future<std::vector<CompiledPipeline>> pendingPipelines; // optimized pipelines still being compiled by a worker
+	bool pendingIsReload = false; // pendingPipelines comes from a hot reload, a failed build keeps the current pipelines
+	std::vector<std::future<std::vector<CompiledPipeline>>> supersededPipelines; // builds replaced by a newer hot reload, destroyed once they are done
+	FileWatcher shaderWatcher; // only running with config.hotReload
+	std::set<std::string> shaderDependencies; // every file the shaders are compiled from (sources and includes)
+	std::vector<VkFramebuffer> swapChainFramebuffers;
+	VkCommandPool commandPool;
+	std::vector<FrameResources> frames; // ring of config.framesInFlight slots
+	std::vector<VkCommandBuffer> imageCommandBuffers; // static mode: one pre-recorded command buffer per framebuffer
+	bool commandBuffersDirty = true; // static mode: re-record imageCommandBuffers before the next submit
+	ParallelCommandRecorder parallelRecorder; // only created if config.recordThreads > 0
+	GpuProfiler gpuProfiler; // only created if config.gpuProfiling is set
+	bool pipelineStatisticsEnabled = false; // pipelineStatisticsQuery device feature, only requested for the GPU profiler
+	bool inheritedQueriesEnabled = false; // inheritedQueries device feature, without it frames that execute secondary command buffers get no statistics query
+	std::atomic<uint64_t> pipelineBindCount = 0; // counted by recordDraws (also on the recording workers), moved into frameTimings after recording
+	std::atomic<uint64_t> dynamicStateCallCount = 0;
+	std::vector<uint64_t> imagesInFlight; // timeline value of the frame currently using each swap chain image (0 if none)
+	FrameScheduler frameScheduler;
+	GpuAllocator gpuAllocator; // all buffer and image memory, sub-allocated from large blocks
+	GpuLinearAllocator transientBuffers; // one region per frame slot (MAX_FRAMES_IN_FLIGHT, so changing the ring size doesn't recreate it)
+	UploadQueue uploadQueue; // staging ring and the transfer queue submissions, one batch per frame
+	UploadSubmission submittedUploads; // uploads submitted outside drawFrame (loading a mesh that didn't fit the ring at once), the next frame waits for them
+	GpuMesh sceneMesh; // what every draw of the scene renders, PackedVertex vertices
+	MeshDecodeConstants sceneMeshDecode; // its quantization bounds, pushed to the vertex shader
+	VkBuffer streamingBuffer = VK_NULL_HANDLE; // config.streamingUploadKiB only: device local, overwritten every frame
+	GpuAllocation streamingBufferMemory;
+	uint32_t currentFrame = 0;
+	uint32_t nextOffscreenImage = 0; // headless: round robin over the offscreen images instead of vkAcquireNextImageKHR
+	FrameTimings frameTimings;
+	DeferredDeletionQueue deletionQueue; // retired swap chains, image views and framebuffers, destroyed once the frames using them are done
+	std::vector<VkSwapchainKHR> retiredSwapChains; // replaced, but no frame presented on their successor has been queued yet
+	bool resizePending = false; // set by the resize callback and by VK_SUBOPTIMAL_KHR
+	std::chrono::steady_clock::time_point lastResizeTime;
+
+	void initWindow() {
+		if (config.headless) { // no window system needed at all
+			return;
+		}
+
+		glfwInit();
+
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+
+		window = glfwCreateWindow(config.width, config.height, "Vulkan", nullptr, nullptr); // width, height, title, monitor to open the window on (optional), (only relevant to OpenGL)
+		glfwSetWindowUserPointer(window, this); // lets the static callback find the application
+		glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+	}
+
+	static void framebufferResizeCallback(GLFWwindow* window, int width, int height) { // only remembers the event, recreation happens in drawFrame
+		auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+		app->resizePending = true;
+		app->lastResizeTime = std::chrono::steady_clock::now();
+	}
+
+	void initVulkan() {
+		createInstance();
+		setupDebugMessenger();
+
+		if (!config.headless) {
+			createSurface();
+		}
+
+		pickPhysicalDevice();
+		createLogicalDevice();
+		createGpuAllocator();
+		createUploadQueue();
+		createSceneMesh();
+
+		if (config.headless) {
+			createOffscreenImages();
+		}
+		else {
+			createSwapChain();
+		}
+
+		createImageViews();
+		createRenderPass();
+		createMaterials();
+		createPipelineCache();
+		createPipelineCompiler();
+		createShaderCompiler();
+		writeShaderBundle();
+		openShaderBundle();
+		pipelineLayoutCache.create(device);
+		createGraphicsPipeline();
+		createShaderWatcher();
+		createFramebuffers();
+		createCommandPool();
+		createCommandBuffers();
+		createParallelRecorder();
+		createSyncObjects();
+		createGpuProfiler();
+		printGpuMemoryStatistics();
+	}
+
+	void mainLoop() {
+		CPU_PROFILE_SCOPE("mainLoop");
+
+		if (config.headless) { // nothing closes a headless run, it renders a fixed number of frames
+			for (uint32_t i = 0; i < config.headlessFrames; i++) {
+				drawFrame();
+			}
+		}
+		else {
+			while (!shouldClose()) { // to keep the application running until either an error occurs or the window is closed
+				{
+					CPU_PROFILE_SCOPE("glfwPollEvents");
+					glfwPollEvents();
+				}
+
+				drawFrame(); // new for rendering an presentation
+			}
+		}
+
+		vkDeviceWaitIdle(device); // waits for operations in a specific command queue to be finished, to exit the program without errors
+	}
+
+	// benchmark: renders the same number of frames in lockstep (1 frame in flight) and with the configured ring, and compares how long the CPU sat waiting on the GPU
+
+	void runBenchmark() {
+		updatePendingPipeline(true); // measure the optimized pipeline, not the fallback
+
+		std::vector<uint32_t> ringSizes = { 1 };
+		if (config.framesInFlight > 1) {
+			ringSizes.push_back(config.framesInFlight);
+		}
+
+		for (uint32_t ringSize : ringSizes) {
+			vkDeviceWaitIdle(device);
+			destroyFrameResources();
+			config.framesInFlight = ringSize;
+			createCommandBuffers();
+			createSyncObjects();
+
+			frameTimings = {};
+			auto start = std::chrono::steady_clock::now();
+
+			for (uint32_t i = 0; i < config.benchmarkFrames && !shouldClose(); i++) {
+				if (!config.headless) {
+					glfwPollEvents();
+				}
+
+				drawFrame();
+			}
+
+			vkDeviceWaitIdle(device);
+			double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			double frameCount = (std::max)(frameTimings.frameCount, 1u);
+			double overlap = frameTimings.cpuFrameMs > 0.0 ? 1.0 - frameTimings.gpuWaitMs / frameTimings.cpuFrameMs : 0.0;
+
+			std::cout << "frames in flight: " << ringSize
+				<< " | frames: " << frameTimings.frameCount
+				<< " | fps: " << frameTimings.frameCount * 1000.0 / totalMs
+				<< " | cpu ms/frame: " << frameTimings.cpuFrameMs / frameCount
+				<< " | gpu wait ms/frame: " << frameTimings.gpuWaitMs / frameCount
+				<< " | record ms/frame: " << frameTimings.recordMs / frameCount
+				<< " | pipeline binds/frame: " << frameTimings.pipelineBinds / frameCount
+				<< " | cpu/gpu overlap: " << overlap * 100.0 << "%" << std::endl;
+		}
+	}
+
+	// recording benchmark: the same scene recorded inline and with an increasing number of worker threads
+
+	void runRecordingBenchmark() {
+		updatePendingPipeline(true); // measure the optimized pipeline, not the fallback
+
+		std::vector<uint32_t> threadCounts = { 0 };
+		uint32_t maxThreads = (std::max)(std::thread::hardware_concurrency(), 1u);
+
+		for (uint32_t threads = 1; threads <= maxThreads; threads *= 2) {
+			threadCounts.push_back(threads);
+		}
+
+		for (uint32_t threads : threadCounts) {
+			frameScheduler.waitIdle();
+			parallelRecorder.destroy();
+			config.recordThreads = threads;
+			createParallelRecorder();
+
+			frameTimings = {};
+
+			for (uint32_t i = 0; i < config.recordingBenchmarkFrames && !shouldClose(); i++) {
+				if (!config.headless) {
+					glfwPollEvents();
+				}
+
+				drawFrame();
+			}
+
+			double frameCount = (std::max)(frameTimings.frameCount, 1u);
+
+			std::cout << "record threads: " << threads
+				<< " | draws: " << config.sceneDrawCount
+				<< " | record ms/frame: " << frameTimings.recordMs / frameCount
+				<< " | cpu ms/frame: " << frameTimings.cpuFrameMs / frameCount << std::endl;
+		}
+
+		vkDeviceWaitIdle(device);
+	}
+
+	bool shouldClose() {
+		return config.headless || glfwWindowShouldClose(window);
+	}
+
+	void cleanup() { // cleaning up ressources once the window is closed; newer methods are cleaned up first
+		deletionQueue.flush(); // the device is idle at this point
+		for (auto retiredSwapChain : retiredSwapChains) {
+			vkDestroySwapchainKHR(device, retiredSwapChain, nullptr);
+		}
+		shaderWatcher.stop();
+		destroyPipelineCompiler();
+		shaderCompiler.destroy();
+		shaderBundle.close(); // after the pipeline compiler, a worker may still read from it
+		destroyGpuProfiler();
+		destroyFrameResources();
+		parallelRecorder.destroy();
+		frameScheduler.destroy();
+
+		if (!imageCommandBuffers.empty()) {
+			vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(imageCommandBuffers.size()), imageCommandBuffers.data());
+		}
+		vkDestroyCommandPool(device, commandPool, nullptr);
+
+		for (auto framebuffer : swapChainFramebuffers) {
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		}
+
+		for (auto pipeline : graphicsPipelines) {
+			vkDestroyPipeline(device, pipeline, nullptr);
+		}
+
+		if (!config.pipelineCachePath.empty()) {
+			pipelineCache.save(); // everything compiled this run is available to the next one
+		}
+		pipelineCache.destroy();
+
+		pipelineLayoutCache.destroy();
+		vkDestroyRenderPass(device, renderPass, nullptr);
+
+		for (auto imageView : swapChainImageViews) {
+			vkDestroyImageView(device, imageView, nullptr);
+		}
+
+		if (config.headless) {
+			destroyOffscreenImages();
+		}
+		else {
+			vkDestroySwapchainKHR(device, swapChain, nullptr);
+		}
+
+		sceneMesh.destroy();
+		destroyUploadQueue();
+		destroyGpuAllocator();
+		vkDestroyDevice(device, nullptr);
+
+		if (enableValidationLayers) {
+			DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+		}
+
+		if (!config.headless) {
+			vkDestroySurfaceKHR(instance, surface, nullptr);
+		}
+
+		vkDestroyInstance(instance, nullptr); // destroying created instance, should be done right before the program exits
+
+		if (!config.cpuTracePath.empty()) {
+			CpuProfiler::setEnabled(false);
+			CpuProfiler::writeChromeTrace(config.cpuTracePath);
+		}
+
+		if (!config.headless) {
+			glfwDestroyWindow(window);
+
+			glfwTerminate();
+		}
+	}
+
+	void createInstance() {
+		// check for validation layers first
+
+		if (enableValidationLayers && !checkValidationLayerSupport()) {
+			throw std::runtime_error("Validation layers requested, but not available!");
+		}
+
+		// creating an instance
+
+		VkApplicationInfo appInfo = {};
+		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName = "Hello Triangle";
+		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+		appInfo.pEngineName = "No Engine";
+		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+		appInfo.apiVersion = VK_API_VERSION_1_3; // the highest version used: 1.2 for timeline semaphores (required), 1.3 for dynamic rendering (optional, devices below 1.3 still work)
+
+		VkInstanceCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		createInfo.pApplicationInfo = &appInfo;
+
+		auto extensions = getRequiredExtensions();
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+		createInfo.ppEnabledExtensionNames = extensions.data();
+
+		VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
+
+		if (enableValidationLayers) { // validation layers
+			createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+			createInfo.ppEnabledLayerNames = validationLayers.data();
+
+			populateDebugMessengerCreateInfo(debugCreateInfo);
+			createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*) &debugCreateInfo;
+		}
+		else {
+			createInfo.enabledLayerCount = 0;
+			createInfo.pNext = nullptr;
+		}
+
+		//uint32_t glfwExtensionCount = 0;
+		//const char** glfwExtensions;
+
+		//glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+		//createInfo.enabledExtensionCount = glfwExtensionCount;
+		//createInfo.ppEnabledExtensionNames = glfwExtensions;
+
+		VkResult result = vkCreateInstance(&createInfo, nullptr, &instance); // pointer to struct with creation info, pointer to custom allocator callbacks, pointer to the new project variable
+
+		if (result != VK_SUCCESS) { // check if the instance was created succesfully
+			throw std::runtime_error("Failed to create instance!");
+		}
+
+		// chcecking for extension support (if needed, if yes delete the auto extensions = getRequiredExtensions, that's from debug)
+
+		//uint32_t extensionCount = 0;
+		//vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+		//std::vector<VkExtensionProperties> extensions(extensionCount);
+
+		//vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+		//std::cout << "available extensions:\n"; // listing available extensions
+		//for (const auto& extension : extensions) {
+		//	std::cout << '\t' << extension.extensionName << '\n';
+		//}
+
+		// create Vulkan window surface (if needed)
+
+		//kSurfaceKHR surface;
+		//VkResult err = glfwCreateWindowSurface(instance, window, NULL, &surface);
+		//if (err) {
+		//    std::cout << "Error";
+		//}
+	}
+
+	bool checkValidationLayerSupport() {
+		uint32_t layerCount;
+		vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+
+		std::vector<VkLayerProperties> availableLayers(layerCount);
+		vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+
+		for (const char* layerName : validationLayers) {
+			bool layerFound = false;
+
+			for (const auto& layerProperties : availableLayers) {
+				if (strcmp(layerName, layerProperties.layerName) == 0) {
+					layerFound = true;
+					break;
+				}
+			}
+
+			if (!layerFound) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
+		createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+		createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+		createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+		createInfo.pfnUserCallback = debugCallback;
+	}
+
+	void setupDebugMessenger() {
+		if (!enableValidationLayers) return;
+
+		VkDebugUtilsMessengerCreateInfoEXT createInfo;
+		populateDebugMessengerCreateInfo(createInfo);
+
+		if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to set up debug messenger.");
+		}
+	}
+
+	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData) {
+		std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
+
+		return VK_FALSE;
+	}
+
+	std::vector<const char*> getRequiredExtensions() {
+		std::vector<const char*> extensions;
+
+		if (!config.headless) { // surface extensions are only needed to present to a window
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions;
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
+
+		if (enableValidationLayers) {
+			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+		}
+
+		return extensions;
+	}
+
+	void pickPhysicalDevice() {
+		uint32_t deviceCount = 0;
+		vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+
+		if (deviceCount == 0) { // error if there are no supported devices
+			throw std::runtime_error("No GPUs with Vulkan support found.");
+		}
+
+		std::vector<VkPhysicalDevice> devices(deviceCount);
+		vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+		for (const auto& device : devices) { // check if any physical devices meet the requirements
+			if (isDeviceSuitable(device)) {
+				physicalDevice = device;
+				break;
+			}
+		}
+
+		if (physicalDevice == VK_NULL_HANDLE) { // throw error if there's none
+			throw std::runtime_error("No suitable GPU found.");
+		}
+	}
+
+	bool isDeviceSuitable(VkPhysicalDevice device) { // check if device is suitable
+		//VkPhysicalDeviceProperties deviceProperties;
+		//VkPhysicalDeviceFeatures deviceFeatures;
+		//vkGetPhysicalDeviceProperties(device, &deviceProperties);
+		//vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+
+		//return deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU && deviceFeatures.geometryShader;
+
+		// OR(?)
+
+		QueueFamilyIndices indices = findQueueFamilies(device);
+
+		bool extensionsSupported = checkDeviceExtensionSupport(device);
+
+		if (config.headless) { // no presentation: any device with a graphics queue will do
+			return indices.graphicsFamily.has_value() && extensionsSupported && checkTimelineSemaphoreSupport(device) && packedVertexFormatsSupported(device);
+		}
+
+		// swap chain support
+		bool swapChainAdequate = false;
+		if (extensionsSupported) { // if these conditions are met, swap chain support is sufficient
+			SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
+			swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+		}
+
+		return indices.isComplete() && extensionsSupported && swapChainAdequate && checkTimelineSemaphoreSupport(device) && packedVertexFormatsSupported(device);
+	}
+
+	bool checkTimelineSemaphoreSupport(VkPhysicalDevice device) { // the frame scheduler needs Vulkan 1.2 timeline semaphores
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+		if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+			return false;
+		}
+
+		VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		VkPhysicalDeviceFeatures2 deviceFeatures = {};
+		deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		deviceFeatures.pNext = &vulkan12Features;
+		vkGetPhysicalDeviceFeatures2(device, &deviceFeatures);
+
+		return vulkan12Features.timelineSemaphore == VK_TRUE;
+	}
+
+	DynamicRenderingSupport queryDynamicRenderingSupport(VkPhysicalDevice device) { // optional, without it the render pass path is used
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+		VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures = {}; // the same struct for the core feature and the extension
+		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+
+		VkPhysicalDeviceFeatures2 deviceFeatures = {};
+		deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		deviceFeatures.pNext = &dynamicRenderingFeatures;
+
+		if (deviceProperties.apiVersion >= VK_API_VERSION_1_3) {
+			vkGetPhysicalDeviceFeatures2(device, &deviceFeatures);
+			return dynamicRenderingFeatures.dynamicRendering == VK_TRUE ? DynamicRenderingSupport::Core : DynamicRenderingSupport::None;
+		}
+
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+		bool extensionSupported = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties& extension) {
+			return std::strcmp(extension.extensionName, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) == 0;
+		});
+
+		if (!extensionSupported) {
+			return DynamicRenderingSupport::None;
+		}
+
+		vkGetPhysicalDeviceFeatures2(device, &deviceFeatures);
+		return dynamicRenderingFeatures.dynamicRendering == VK_TRUE ? DynamicRenderingSupport::Extension : DynamicRenderingSupport::None;
+	}
+
+	std::vector<const char*> getRequiredDeviceExtensions() {
+		std::vector<const char*> deviceExtensions;
+
+		if (!config.headless) {
+			deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+		}
+
+		return deviceExtensions;
+	}
+
+	bool checkDeviceExtensionSupport(VkPhysicalDevice device) { // check if all of the required extensions are there
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+		std::vector<const char*> deviceExtensions = getRequiredDeviceExtensions();
+		std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+
+		for (const auto& extension : availableExtensions) {
+			requiredExtensions.erase(extension.extensionName);
+		}
+
+		return requiredExtensions.empty(); // should be empty (true)
+	}
+
+	// queue families
+
+	QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) {
+		QueueFamilyIndices indices;
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+		// transfer: a family without graphics and compute is a dedicated copy engine that works alongside rendering (graphics and compute families can copy too, implicitly)
+		for (uint32_t family = 0; family < queueFamilyCount; family++) {
+			VkQueueFlags flags = queueFamilies[family].queueFlags;
+			if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && queueFamilies[family].queueCount > 0) {
+				indices.transferFamily = family;
+				break;
+			}
+		}
+
+		int i = 0;
+		for (const auto& queueFamily : queueFamilies) {
+			if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) { // find at least one queue family that supports graphics
+				indices.graphicsFamily = i;
+			}
+
+			if (config.headless) { // there is no surface to present to, the graphics queue is all we need
+				if (indices.graphicsFamily.has_value()) {
+					break;
+				}
+			}
+			else {
+				VkBool32 presentSupport = false;
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+
+				if (presentSupport) {
+					indices.presentFamily = i;
+				}
+
+				if (indices.isComplete()) { // break if indices has got a value
+					break;
+				}
+			}
+
+			i++;
+		}
+
+		return indices;
+	}
+
+	// logical device
+
+	void createLogicalDevice() { // might be without parameter?
+
+		// specifying the queues to be created
+
+		//VkPhysicalDevice physicalDevice = physicalDevice;
+
+		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+
+		// --- updated version in for loop below (creating the presentation queue) ---
+		//VkDeviceQueueCreateInfo queueCreateInfo = {}; // struct
+		//queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		//queueCreateInfo.queueFamilyIndex = indices.graphicsFamily.value();
+		//queueCreateInfo.queueCount = 1;
+
+		// --- new (creating the presentation queue) ---
+		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+		std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value() };
+		if (indices.presentFamily.has_value()) { // not set in headless mode
+			uniqueQueueFamilies.insert(indices.presentFamily.value());
+		}
+		if (config.transferQueue && indices.transferFamily.has_value()) {
+			uniqueQueueFamilies.insert(indices.transferFamily.value());
+		}
+
+		float queuePriority = 1.0f;
+		// --- old (creating the presentation queue) ---
+		//queueCreateInfo.pQueuePriorities = &queuePriority;
+		// --- new (creating the presentation queue) ---
+		for (uint32_t queueFamily : uniqueQueueFamilies) {
+			VkDeviceQueueCreateInfo queueCreateInfo = {};
+		    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		    queueCreateInfo.queueFamilyIndex = queueFamily;
+		    queueCreateInfo.queueCount = 1;
+		    queueCreateInfo.pQueuePriorities = &queuePriority;
+		    queueCreateInfos.push_back(queueCreateInfo);
+		}
+
+		// specifying used device features
+
+		VkPhysicalDeviceFeatures deviceFeatures = {};
+
+		if (config.gpuProfiling) { // pipeline statistics are optional for the profiler, only enable them if the device has them
+			VkPhysicalDeviceFeatures supportedFeatures;
+			vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+			deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+			deviceFeatures.inheritedQueries = supportedFeatures.inheritedQueries; // a statistics query may only stay active across vkCmdExecuteCommands with this
+			pipelineStatisticsEnabled = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+			inheritedQueriesEnabled = supportedFeatures.inheritedQueries == VK_TRUE;
+		}
+
+		VkPhysicalDeviceVulkan12Features vulkan12Features = {}; // features that are not in VkPhysicalDeviceFeatures are enabled through the pNext chain
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		vulkan12Features.timelineSemaphore = VK_TRUE;
+
+		std::vector<const char*> deviceExtensions = getRequiredDeviceExtensions();
+
+		dynamicRenderingSupport = config.dynamicRendering ? queryDynamicRenderingSupport(physicalDevice) : DynamicRenderingSupport::None;
+
+		VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures = {}; // VkPhysicalDeviceVulkan13Features would do for core, this struct works for both
+		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+		dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+		if (dynamicRenderingSupport != DynamicRenderingSupport::None) {
+			vulkan12Features.pNext = &dynamicRenderingFeatures;
+		}
+
+		if (dynamicRenderingSupport == DynamicRenderingSupport::Extension) {
+			deviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME); // its dependencies (depth stencil resolve, create render pass 2) are core in 1.2
+		}
+
+		if (config.extendedDynamicState) { // optional as well, without it every material permutation is its own pipeline
+			extendedDynamicState.query(physicalDevice);
+			vulkan12Features.pNext = extendedDynamicState.enable(vulkan12Features.pNext, deviceExtensions); // in front of whatever is already chained
+		}
+
+		// creating the logical device
+
+		// --- old, new one is below (creating the presentation queue) ---
+		//VkDeviceCreateInfo createInfo = {};
+		//createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		//createInfo.pQueueCreateInfos = &queueCreateInfo;
+		//createInfo.queueCreateInfoCount = 1;
+		//createInfo.pEnabledFeatures = &deviceFeatures;
+
+		// --- new (creating the presentation queue) ---
+		VkDeviceCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &vulkan12Features;
+		createInfo.pQueueCreateInfos = queueCreateInfos.data();
+		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+		createInfo.pEnabledFeatures = &deviceFeatures;
+
+		//createInfo.enabledExtensionCount = 0;
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+		if (enableValidationLayers) {
+			createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+			createInfo.ppEnabledLayerNames = validationLayers.data();
+		}
+		else {
+			createInfo.enabledLayerCount = 0;
+		}
+
+		if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
+			throw std::runtime_error("Could not create logical device.");
+		}
+
+		if (dynamicRenderingSupport != DynamicRenderingSupport::None) { // device level entry points, the loader may not export the KHR ones
+			bool core = dynamicRenderingSupport == DynamicRenderingSupport::Core;
+			cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRendering>(vkGetDeviceProcAddr(device, core ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR"));
+			cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRendering>(vkGetDeviceProcAddr(device, core ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR"));
+
+			if (cmdBeginRendering == nullptr || cmdEndRendering == nullptr) {
+				throw std::runtime_error("Failed to load the dynamic rendering functions.");
+			}
+		}
+
+		if (config.extendedDynamicState) {
+			extendedDynamicState.loadFunctions(device);
+			dynamicMaterialState = extendedDynamicState.supported();
+			std::cout << "extended dynamic state: " << extendedDynamicState.description() << " (" << dynamicStateNames(dynamicMaterialState) << ")" << std::endl;
+		}
+
+		std::cout << "rendering: " << (dynamicRenderingSupport == DynamicRenderingSupport::Core ? "dynamic rendering (Vulkan 1.3)" : dynamicRenderingSupport == DynamicRenderingSupport::Extension ? "dynamic rendering (VK_KHR_dynamic_rendering)" : "render pass") << std::endl;
+
+		vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
+		// --- new (creating the presentation queue) ---
+		if (indices.presentFamily.has_value()) {
+			vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+		}
+
+		transferQueue = graphicsQueue;
+		if (config.transferQueue && indices.transferFamily.has_value()) {
+			vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
+		}
+	}
+
+	void createSurface() {
+		// window surface creation
+
+#ifdef _WIN32
+		VkWin32SurfaceCreateInfoKHR createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+		createInfo.hwnd = glfwGetWin32Window(window); // used to get the raw hwnd from the GLFW window object
+		createInfo.hinstance = GetModuleHandle(nullptr); // returns the hinstance handle of the current process
+
+		if (vkCreateWin32SurfaceKHR(instance, &createInfo, nullptr, &surface) != VK_SUCCESS) {
+			throw std::runtime_error("Window creation failed.");
+		}
+#else
+		if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) { // GLFW picks the platform surface (xcb, xlib, wayland)
+			throw std::runtime_error("Window creation failed.");
+		}
+#endif
+	}
+
+	// swap chain support
+
+	SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device) {
+		SwapChainSupportDetails details;
+
+		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+
+		uint32_t formatCount;
+		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr); // querying the supported surface formats
+
+		if (formatCount != 0) {
+			details.formats.resize(formatCount);
+			vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
+		}
+
+		uint32_t presentModeCount;
+		vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr); // querying the supported presentation modes
+
+		if (presentModeCount != 0) {
+			details.presentModes.resize(presentModeCount);
+			vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
+		}
+
+		return details;
+	}
+
+	// swap chain settings: surface format
+
+	VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
+		for (const auto& availableFormat : availableFormats) {
+			if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+				return availableFormat;
+			}
+		}
+
+		return availableFormats[0];
+	}
+
+	// swap chain settings: presentation mode, looks for the best mode that is available
+
+	VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
+		for (const auto& availablePresentMode : availablePresentModes) {
+			if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+				return availablePresentMode; // best mode (?)
+			}
+		}
+
+		return VK_PRESENT_MODE_FIFO_KHR; // mode guaranteed to be available
+	}
+
+	// swap chain settings: swap extent
+
+	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
+		if (capabilities.currentExtent.width != (std::numeric_limits<uint32_t>::max)()) {
+			return capabilities.currentExtent;
+		}
+		else {
+			int width, height;
+			glfwGetFramebufferSize(window, &width, &height);
+
+			VkExtent2D actualExtent = {
+				static_cast<uint32_t>(width),
+				static_cast<uint32_t>(height)
+			};
+
+			actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+			actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+
+			return actualExtent;
+		}
+	}
+
+	// creating the swap chain
+
+	void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE) {
+		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
+
+		VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
+		VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+		VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
+
+		uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1; // recommended to request at least one more image than the minimum
+
+		if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
+			imageCount = swapChainSupport.capabilities.maxImageCount;
+		}
+
+		VkSwapchainCreateInfoKHR createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+		createInfo.surface = surface;
+		createInfo.minImageCount = imageCount;
+		createInfo.imageFormat = surfaceFormat.format;
+		createInfo.imageColorSpace = surfaceFormat.colorSpace;
+		createInfo.imageExtent = extent;
+		createInfo.imageArrayLayers = 1; // always 1 unless you are developing a stereoscopic 3D application
+		createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; // or VK_IMAGE_USAGE_TRANSFER_DST_BIT
+
+		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+		uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+
+		if (indices.graphicsFamily != indices.presentFamily) {
+			createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+			// EXCLUSIVE: An image is owned by one queue family at a time and ownership must be explicitly transferred before using it in another queue family. This option offers the best performance.
+			// CONCURRENT: Images can be used across multiple queue families without explicit ownership transfers.
+			createInfo.queueFamilyIndexCount = 2;
+			createInfo.pQueueFamilyIndices = queueFamilyIndices;
+		}
+		else {
+			createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			createInfo.queueFamilyIndexCount = 0; // optional
+			createInfo.pQueueFamilyIndices = nullptr; // optional
+		}
+
+		createInfo.preTransform = swapChainSupport.capabilities.currentTransform; // to specify that you do not want any transformation, simply specify the current transformation
+		createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR; // specifies if the alpha channel should be used for blending with other windows in the window system, almost always ignore the alpha channel like this
+		createInfo.presentMode = presentMode;
+		createInfo.clipped = VK_TRUE; // true to not care about the color of pixels that are obscured
+		createInfo.oldSwapchain = oldSwapChain; // when recreating: lets the driver reuse resources of the old swap chain and hand over presentation without a gap
+
+		if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create swap chain.");
+		}
+
+		// retrieving the swap chain images
+
+		vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
+		swapChainImages.resize(imageCount);
+		vkGetSwapchainImagesKHR(device, swapChain, &imageCount, swapChainImages.data());
+
+		swapChainImageFormat = surfaceFormat.format;
+		swapChainExtent = extent;
+	}
+
+	// swap chain recreation (window resized, or the surface changed in a way the old swap chain can't present to anymore)
+
+	void recreateSwapChain() {
+		int width = 0, height = 0;
+		glfwGetFramebufferSize(window, &width, &height);
+
+		while (width == 0 || height == 0) { // minimized: there is nothing to render to until the window comes back
+			glfwWaitEvents();
+			glfwGetFramebufferSize(window, &width, &height);
+		}
+
+		auto recreateStart = std::chrono::steady_clock::now();
+
+		// the old objects may still be used by frames in flight, they are retired instead of waiting for the device to go idle
+
+		VkSwapchainKHR oldSwapChain = swapChain;
+		retireRenderTargets();
+
+		// the old swap chain can't go with the last frame submitted to it: that timeline value covers the rendering, not the presents still queued on it
+		// it's destroyed after the first frame presented on the new one (retireSwapChains)
+		retiredSwapChains.push_back(oldSwapChain);
+
+		createSwapChain(oldSwapChain);
+		createImageViews();
+		createFramebuffers(); // also marks the static command buffers dirty
+
+		imagesInFlight.assign(swapChainImages.size(), 0); // the new images haven't been used by any frame yet
+		resizePending = false;
+
+		frameTimings.recreateCount++;
+		frameTimings.recreateMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recreateStart).count();
+	}
+
+	void retireRenderTargets() { // image views and framebuffers go to the deletion queue, the frames in flight may still render to them
+		std::vector<VkImageView> oldImageViews = swapChainImageViews;
+		std::vector<VkFramebuffer> oldFramebuffers = swapChainFramebuffers;
+
+		deletionQueue.push(frameScheduler.lastSubmitted(), [this, oldImageViews, oldFramebuffers]() {
+			for (auto framebuffer : oldFramebuffers) {
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			}
+
+			for (auto imageView : oldImageViews) {
+				vkDestroyImageView(device, imageView, nullptr);
+			}
+		});
+
+		swapChainImageViews.clear();
+		swapChainFramebuffers.clear();
+	}
+
+	// offscreen images (headless mode): stand in for the swap chain images, so image views, framebuffers and command recording stay the same
+
+	void createOffscreenImages() {
+		swapChainImageFormat = OFFSCREEN_IMAGE_FORMAT;
+		swapChainExtent = { config.width, config.height };
+
+		swapChainImages.resize(OFFSCREEN_IMAGE_COUNT);
+		offscreenImageMemory.resize(OFFSCREEN_IMAGE_COUNT);
+
+		for (uint32_t i = 0; i < OFFSCREEN_IMAGE_COUNT; i++) {
+			VkImageCreateInfo image_info = {};
+			image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			image_info.imageType = VK_IMAGE_TYPE_2D;
+			image_info.format = swapChainImageFormat;
+			image_info.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+			image_info.mipLevels = 1;
+			image_info.arrayLayers = 1;
+			image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+			image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+			image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT; // rendered into, then available for readback
+			image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			if (vkCreateImage(device, &image_info, nullptr, &swapChainImages[i]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create offscreen image.");
+			}
+
+			offscreenImageMemory[i] = gpuAllocator.allocateImage(swapChainImages[i], image_info.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT); // the images share a block
+		}
+	}
+
+	void destroyOffscreenImages() {
+		for (size_t i = 0; i < swapChainImages.size(); i++) {
+			vkDestroyImage(device, swapChainImages[i], nullptr);
+			gpuAllocator.free(offscreenImageMemory[i]);
+		}
+
+		swapChainImages.clear();
+		offscreenImageMemory.clear();
+	}
+
+	// GPU memory: every buffer and image goes through the allocator instead of its own vkAllocateMemory
+
+	void createGpuAllocator() {
+		gpuAllocator.create(physicalDevice, device);
+		transientBuffers.create(gpuAllocator, device, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			TRANSIENT_BUFFER_SIZE_PER_FRAME, MAX_FRAMES_IN_FLIGHT);
+	}
+
+	void destroyGpuAllocator() { // after every resource that has memory from it
+		transientBuffers.destroy();
+		gpuAllocator.destroy();
+	}
+
+	// uploads: everything that goes to device local memory is staged in the ring and copied by one transfer submission per frame
+
+	void createUploadQueue() {
+		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+		uint32_t graphicsFamily = indices.graphicsFamily.value();
+		uint32_t transferFamily = config.transferQueue && indices.transferFamily.has_value() ? indices.transferFamily.value() : graphicsFamily;
+
+		uploadQueue.create(gpuAllocator, device, transferQueue, transferFamily, graphicsFamily, STAGING_RING_SIZE);
+
+		std::cout << "uploads: " << (uploadQueue.separateFamily() ? "transfer queue (family " + std::to_string(transferFamily) + ")" : std::string("graphics queue"))
+			<< ", " << uploadQueue.ringSize() / 1024 << " KiB staging ring" << std::endl;
+
+		if (config.streamingUploadKiB == 0) {
+			return;
+		}
+
+		VkBufferCreateInfo buffer_info = {};
+		buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_info.size = VkDeviceSize(config.streamingUploadKiB) * 1024;
+		buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // ownership moves from the transfer to the graphics family with every upload
+
+		if (vkCreateBuffer(device, &buffer_info, nullptr, &streamingBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create streaming buffer.");
+		}
+
+		streamingBufferMemory = gpuAllocator.allocateBuffer(streamingBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	static MeshData sceneMeshData() { // the triangle, in clip space: the vertex shader doesn't transform it
+		MeshData mesh;
+		mesh.vertices = {
+			{ { 0.0f, -0.5f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f }, { 0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f } },
+			{ { 0.5f, 0.5f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f, 0.0f } },
+			{ { -0.5f, 0.5f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f }, { 0.0f, 0.0f, 1.0f } }
+		};
+		mesh.indices = { 0, 1, 2 };
+		return mesh;
+	}
+
+	MeshData loadSceneMeshData(bool optimize) const {
+		if (config.meshPath.empty()) {
+			return sceneMeshData();
+		}
+
+		MeshImportStats stats;
+		MeshData mesh = importMesh(config.meshPath, 0, &stats);
+
+		std::cout << "mesh: " << config.meshPath << ", " << stats.triangleCount << " triangles, " << stats.vertexCount << " vertices (" << stats.sourceVertexCount << " before deduplication), "
+			<< stats.totalMs << " ms on " << stats.threadCount << " threads (parse " << stats.parseMs << ", deduplicate " << stats.deduplicateMs << ", finish " << stats.finishMs << ")"
+			<< (stats.generatedNormals ? ", generated normals" : "") << (stats.generatedTangents ? ", generated tangents" : "")
+			<< (stats.skippedPrimitives > 0 ? ", skipped " + std::to_string(stats.skippedPrimitives) + " non-triangle primitives" : std::string()) << std::endl;
+
+		if (optimize) {
+			double acmrBefore = analyzeVertexCache(mesh.indices, mesh.vertices.size()).acmr;
+			auto optimizeStart = std::chrono::steady_clock::now();
+			optimizeMesh(mesh);
+			double optimizeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - optimizeStart).count();
+
+			std::cout << "mesh optimized in " << optimizeMs << " ms, ACMR " << acmrBefore << " -> " << analyzeVertexCache(mesh.indices, mesh.vertices.size()).acmr << std::endl;
+		}
+
+		return mesh;
+	}
+
+	void createSceneMesh() { // staged now, copied with the first frame's uploads
+		QuantizedMesh quantized = quantizeMesh(loadSceneMeshData(config.optimizeMesh));
+
+		sceneMesh.create(gpuAllocator, device, uploadQueue, quantized.vertices, quantized.indices, submittedUploads);
+		sceneMeshDecode = meshDecodeConstants(quantized.bounds);
+
+		if (!config.meshPath.empty()) { // no camera: decode straight into the middle of clip space instead, x and y scaled alike, y up, depth over [0, 1]
+			glm::vec3 extent = quantized.bounds.positionExtent;
+			float scale = 1.8f / (std::max)({ extent.x, extent.y, 1e-20f });
+			sceneMeshDecode.positionScale = glm::vec4(extent.x * scale, -extent.y * scale, extent.z > 0.0f ? 1.0f : 0.0f, 0.0f);
+			sceneMeshDecode.positionOffset = glm::vec4(-extent.x * scale * 0.5f, extent.y * scale * 0.5f, 0.0f, 1.0f);
+		}
+	}
+
+	void printQuantizationReports() const {
+		MeshData triangle = sceneMeshData();
+		printQuantizationReport("scene triangle", measureQuantizationError(triangle, quantizeMesh(triangle)));
+
+		if (!config.meshPath.empty()) {
+			MeshData mesh = loadSceneMeshData(config.optimizeMesh);
+			printQuantizationReport(config.meshPath.c_str(), measureQuantizationError(mesh, quantizeMesh(mesh)));
+		}
+
+		MeshData sphere = generateSphere(64, 128);
+		printQuantizationReport("sphere 64x128", measureQuantizationError(sphere, quantizeMesh(sphere)));
+	}
+
+	static void runSelfTests() {
+		for (uint32_t seed = 1; seed <= 4; seed++) {
+			std::string error = tlsfSelfTest(100000, seed);
+			if (!error.empty()) {
+				throw std::runtime_error("TLSF self test failed (seed " + std::to_string(seed) + "): " + error + ".");
+			}
+		}
+
+		std::cout << "TLSF self test: passed" << std::endl;
+	}
+
+	static void runGpuSelfTests() { // headless: an instance without extensions and a device with one queue, nothing is submitted
+		VkApplicationInfo appInfo = {};
+		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName = "GPU allocator self test";
+		appInfo.apiVersion = VK_API_VERSION_1_1;
+
+		VkInstanceCreateInfo instance_info = {};
+		instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instance_info.pApplicationInfo = &appInfo;
+
+		VkInstance testInstance = VK_NULL_HANDLE;
+		uint32_t deviceCount = 0;
+
+		if (vkCreateInstance(&instance_info, nullptr, &testInstance) == VK_SUCCESS) {
+			vkEnumeratePhysicalDevices(testInstance, &deviceCount, nullptr);
+		}
+
+		if (deviceCount == 0) { // no loader, no ICD or no device: nothing to test on, ctest reports it as skipped
+			if (testInstance != VK_NULL_HANDLE) {
+				vkDestroyInstance(testInstance, nullptr);
+			}
+			std::cout << "GPU allocator self test: skipped, no Vulkan device" << std::endl;
+			return;
+		}
+
+		deviceCount = 1;
+		VkPhysicalDevice testPhysicalDevice = VK_NULL_HANDLE;
+		vkEnumeratePhysicalDevices(testInstance, &deviceCount, &testPhysicalDevice);
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(testPhysicalDevice, &properties);
+
+		float priority = 1.0f;
+		VkDeviceQueueCreateInfo queue_info = {};
+		queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queue_info.queueFamilyIndex = 0; // any family, the queue is never used
+		queue_info.queueCount = 1;
+		queue_info.pQueuePriorities = &priority;
+
+		VkDeviceCreateInfo device_info = {};
+		device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		device_info.queueCreateInfoCount = 1;
+		device_info.pQueueCreateInfos = &queue_info;
+
+		VkDevice testDevice = VK_NULL_HANDLE;
+		if (vkCreateDevice(testPhysicalDevice, &device_info, nullptr, &testDevice) != VK_SUCCESS) {
+			vkDestroyInstance(testInstance, nullptr);
+			throw std::runtime_error("Failed to create logical device.");
+		}
+
+		std::string error;
+		uint32_t seed = 1;
+
+		for (; seed <= 4 && error.empty(); seed++) {
+			error = gpuAllocatorSelfTest(testPhysicalDevice, testDevice, 20000, seed);
+		}
+
+		vkDestroyDevice(testDevice, nullptr);
+		vkDestroyInstance(testInstance, nullptr);
+
+		if (!error.empty()) {
+			throw std::runtime_error("GPU allocator self test failed on " + std::string(properties.deviceName) + " (seed " + std::to_string(seed - 1) + "): " + error + ".");
+		}
+
+		std::cout << "GPU allocator self test: passed on " << properties.deviceName << std::endl;
+	}
+
+	void printMeshOptimizationReports() const {
+		if (!config.meshPath.empty()) {
+			printMeshOptimizationReport(config.meshPath.c_str(), measureMeshOptimization(loadSceneMeshData(false))); // the report optimizes a copy itself
+		}
+
+		MeshData sphere = generateSphere(64, 128); // already in a good order for the vertex cache, as generated row by row
+		printMeshOptimizationReport("sphere 64x128", measureMeshOptimization(sphere));
+
+		std::mt19937 random(1); // the same sphere with its triangles shuffled, the order of a careless exporter
+		for (size_t triangle = sphere.indices.size() / 3; triangle > 1; triangle--) {
+			size_t other = std::uniform_int_distribution<size_t>(0, triangle - 1)(random);
+			std::swap_ranges(sphere.indices.begin() + (triangle - 1) * 3, sphere.indices.begin() + triangle * 3, sphere.indices.begin() + other * 3);
+		}
+		printMeshOptimizationReport("sphere 64x128, shuffled triangles", measureMeshOptimization(sphere));
+	}
+
+	void destroyUploadQueue() { // before the allocator, the staging ring has memory from it
+		uploadQueue.destroy();
+
+		if (streamingBuffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(device, streamingBuffer, nullptr);
+			gpuAllocator.free(streamingBufferMemory);
+			streamingBuffer = VK_NULL_HANDLE;
+		}
+	}
+
+	void streamUploads() { // config.streamingUploadKiB: the whole buffer again every frame; nothing reads it, so overwriting it while frames are in flight is fine
+		if (streamingBuffer == VK_NULL_HANDLE) {
+			return;
+		}
+
+		VkDeviceSize size = VkDeviceSize(config.streamingUploadKiB) * 1024;
+		void* staging = uploadQueue.stageBuffer(streamingBuffer, 0, size, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+
+		if (staging != nullptr) { // ring full: skipped this frame, counted as deferred
+			std::memset(staging, static_cast<int>(frameTimings.frameCount & 0xff), static_cast<size_t>(size));
+		}
+	}
+
+	void printGpuMemoryStatistics() {
+		GpuMemoryStats stats = gpuAllocator.statistics();
+
+		std::cout << "gpu memory: " << stats.allocationCount << " allocations in " << stats.deviceAllocationCount << " device allocations (limit " << stats.maxDeviceAllocationCount << "), "
+			<< stats.usedBytes / 1024 << " KiB used of " << stats.reservedBytes / 1024 << " KiB reserved" << std::endl;
+
+		for (const auto& type : stats.memoryTypes) {
+			std::cout << "  memory type " << type.memoryType << " (heap " << type.heap << "): " << type.blockCount << " blocks, " << type.dedicatedCount << " dedicated, "
+				<< type.allocationCount << " allocations, " << type.freeRangeCount << " free ranges (largest " << type.largestFreeRange / 1024 << " KiB)" << std::endl;
+		}
+	}
+
+	// image views (quite literally a view into an image)
+
+	void createImageViews() { // creates a basic image view for every image in the swap chain so that we can use them as color targets later on
+		swapChainImageViews.resize(swapChainImages.size()); // resize the list to fit all of the image views we'll be creating
+
+		for (size_t i = 0; i < swapChainImages.size(); i++) { // iterates over all of the swap chain images
+			VkImageViewCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			createInfo.image = swapChainImages[i];
+			createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D; // treat images as 1D textures, 2D textures (here), 3D textures and cube maps
+			createInfo.format = swapChainImageFormat;
+			createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+			// swizzle the color channels around, can also map constant values of 0 and 1 to a channel, here: default mapping
+			createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			createInfo.subresourceRange.baseMipLevel = 0;
+			createInfo.subresourceRange.levelCount = 1;
+			createInfo.subresourceRange.baseArrayLayer = 0;
+			createInfo.subresourceRange.layerCount = 1;
+
+			if (vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews[i]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create image views.");
+			}
+		}
+	}
+
+	void createPipelineCache() { // loaded from disk if a cache from an earlier run on the same GPU and driver exists
+		pipelineCache.create(device, physicalDevice, config.pipelineCachePath);
+	}
+
+	void createPipelineCompiler() {
+		if (config.pipelineCompileThreads > 0) {
+			pipelineCompiler.create(device, pipelineCache.handle(), config.pipelineCompileThreads);
+		}
+	}
+
+	void destroyPipelineCompiler() { // expects the device to be idle
+		pipelineCompiler.destroy(); // waits for the worker, a pending pipeline is finished afterwards
+
+		if (pendingPipelines.valid()) {
+			supersededPipelines.push_back(std::move(pendingPipelines));
+		}
+		destroySupersededPipelines(true);
+	}
+
+	void destroySupersededPipelines(bool wait) { // they were never used, nothing on the GPU can reference them
+		for (auto superseded = supersededPipelines.begin(); superseded != supersededPipelines.end(); ) {
+			if (!wait && superseded->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				++superseded;
+				continue;
+			}
+
+			try {
+				for (const auto& compiled : superseded->get()) {
+					if (compiled.pipeline != VK_NULL_HANDLE) {
+						vkDestroyPipeline(device, compiled.pipeline, nullptr);
+					}
+				}
+			}
+			catch (const std::exception&) { // a shader that didn't compile, there is nothing to destroy
+			}
+
+			superseded = supersededPipelines.erase(superseded);
+		}
+	}
+
+	void createShaderCompiler() {
+		if (config.runtimeShaderCompile) {
+			shaderCompiler.create(config.shaderCacheDirectory, (std::max)(std::thread::hardware_concurrency(), 1u));
+		}
+	}
+
+	std::vector<ShaderCompileRequest> shaderCompileRequests() const { // vertex stage first, then the fragment stage
+		std::vector<ShaderCompileRequest> requests = {
+			{ .path = VERTEX_SHADER_SOURCE, .stage = VK_SHADER_STAGE_VERTEX_BIT, .defines = {}, .optimization = config.shaderOptimization, .frozenConstants = {} },
+			{ .path = FRAGMENT_SHADER_SOURCE, .stage = VK_SHADER_STAGE_FRAGMENT_BIT, .defines = {}, .optimization = config.shaderOptimization, .frozenConstants = {} }
+		};
+
+		if (freezesSpecialization()) { // every brightness is its own module then, cached like any other
+			requests[1].frozenConstants = fragmentSpecialization();
+		}
+
+		return requests;
+	}
+
+	bool freezesSpecialization() const { // the optimizer only runs on runtime compiled shaders, prebuilt ones are specialized by the pipeline
+		return config.runtimeShaderCompile && config.shaderOptimization != ShaderOptimization::None;
+	}
+
+	SpecializationData fragmentSpecialization() const {
+		FragmentConstants fragmentConstants;
+		fragmentConstants.set<BrightnessConstant>(config.brightness);
+		return fragmentConstants.build();
+	}
+
+	void writeShaderBundle() { // the offline step for --prebuilt-shaders, the modules are not frozen to the current specialization so any --brightness works with the bundle
+		if (!config.writeShaderBundle) {
+			return;
+		}
+
+		if (!config.runtimeShaderCompile) {
+			throw std::runtime_error("Writing a shader bundle needs runtime shader compilation.");
+		}
+
+		std::vector<ShaderCompileRequest> requests = shaderCompileRequests();
+		for (auto& request : requests) {
+			request.frozenConstants = {};
+		}
+
+		std::vector<ShaderCompileResult> results = shaderCompiler.compile(requests);
+		std::vector<ShaderBundleShader> shaders;
+
+		for (size_t i = 0; i < requests.size(); i++) {
+			shaders.push_back({ requests[i].path, requests[i].stage, std::move(results[i].code), std::move(results[i].reflection) });
+		}
+
+		ShaderBundle::write(config.shaderBundlePath, shaders);
+		std::cout << "shader bundle: " << shaders.size() << " shaders written to " << config.shaderBundlePath << std::endl;
+	}
+
+	void openShaderBundle() {
+		if (config.runtimeShaderCompile) {
+			return;
+		}
+
+		if (!shaderBundle.open(config.shaderBundlePath)) {
+			std::cout << "shader bundle: " << config.shaderBundlePath << " not found or invalid, loading the .spv files" << std::endl;
+		}
+	}
+
+	std::vector<ShaderStageDesc> loadShaderStages() { // vertex stage first, then the fragment stage
+		if (shaderBundle.isOpen()) { // no copies: the stages point into the mapping, the reflection comes from the bundle too
+			std::vector<ShaderStageDesc> stages;
+
+			for (const auto& request : shaderCompileRequests()) {
+				const ShaderBundleEntry* entry = shaderBundle.find(request.path);
+				if (entry == nullptr || entry->stage != request.stage) {
+					throw std::runtime_error("Shader " + request.path + " is missing from the shader bundle.");
+				}
+
+				ShaderStageDesc stage;
+				stage.stage = entry->stage;
+				stage.mappedCode = shaderBundle.code(*entry);
+				stage.mappedCodeSize = entry->codeSize;
+				stage.reflection = shaderBundle.reflection(*entry);
+				stages.push_back(std::move(stage));
+			}
+
+			return stages;
+		}
+
+		if (!config.runtimeShaderCompile) {
+			std::vector<ShaderStageDesc> stages(2); // every other field keeps its default
+			stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+			stages[0].code = readSpirvFile("shaders/vert.spv");
+			stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+			stages[1].code = readSpirvFile("shaders/frag.spv");
+
+			for (auto& stage : stages) { // no cache for prebuilt modules, they are reflected on every start
+				stage.reflection = reflectShader(stage.code, stage.stage);
+			}
+
+			return stages;
+		}
+
+		std::vector<ShaderCompileRequest> requests = shaderCompileRequests();
+
+		std::vector<ShaderCompileResult> results = shaderCompiler.compile(requests); // cache hits cost a hash of the sources, misses are compiled in parallel
+
+		std::vector<ShaderStageDesc> stages;
+		uint32_t compiledCount = 0;
+		double compileMs = 0.0;
+
+		for (size_t i = 0; i < requests.size(); i++) {
+			if (!results[i].cacheHit) { // the optimizer's effect, a cached module only knows its optimized size
+				std::cout << requests[i].path << ": " << results[i].unoptimizedInstructionCount << " -> " << results[i].instructionCount << " instructions (" << shaderOptimizationName(requests[i].optimization) << ")" << std::endl;
+			}
+
+			ShaderStageDesc& stage = stages.emplace_back();
+			stage.stage = requests[i].stage;
+			stage.code = std::move(results[i].code);
+			stage.reflection = std::move(results[i].reflection);
+			compiledCount += results[i].cacheHit ? 0 : 1;
+			compileMs += results[i].compileMs;
+		}
+
+		std::cout << "shaders: " << requests.size() - compiledCount << " cached, " << compiledCount << " compiled (" << compileMs << " ms)" << std::endl;
+		return stages;
+	}
+
+	// materials: the scene's draws use config.materialCount fixed function permutations, the pipelines are made per combination of the state that can't be dynamic
+	// with extended dynamic state most of the permutations collapse into one pipeline, the rest of the difference is a few vkCmdSet* calls while recording
+
+	static FixedFunctionState materialState(uint32_t index) { // every combination of a few settings, repeating after 32 materials; none of them changes what the triangle looks like
+		FixedFunctionState state;
+		bool flipped = (index >> 2) & 1; // the other winding convention, with the other face culled: the same triangles stay visible
+		state.cullMode = index & 1 ? (flipped ? VK_CULL_MODE_FRONT_BIT : VK_CULL_MODE_BACK_BIT) : VK_CULL_MODE_NONE; // the triangle is clockwise on screen
+		state.frontFace = flipped ? VK_FRONT_FACE_COUNTER_CLOCKWISE : VK_FRONT_FACE_CLOCKWISE;
+		state.blendEnable = (index >> 1) & 1 ? VK_TRUE : VK_FALSE; // the fragment shader writes alpha 1
+		state.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; // recordDraws draws triangle list indices, another topology would draw other triangles
+		state.depthCompareOp = MATERIAL_DEPTH_COMPARE_OPS[(index >> 3) % std::size(MATERIAL_DEPTH_COMPARE_OPS)]; // there is no depth attachment
+		return state;
+	}
+
+	uint32_t materialIndex(uint32_t draw) const { // the draws are sorted by material, like a renderer that sorts by state would submit them
+		return static_cast<uint32_t>(static_cast<uint64_t>(draw) * config.materialCount / (std::max)(config.sceneDrawCount, 1u));
+	}
+
+	void createMaterials() { // after createLogicalDevice, what is dynamic depends on the device
+		materials.clear();
+		materialPipelines.clear();
+		pipelineStates.clear();
+
+		for (uint32_t i = 0; i < config.materialCount; i++) {
+			materials.push_back(materialState(i));
+
+			FixedFunctionState baked = bakedState(materials.back(), dynamicMaterialState);
+			auto existing = std::find_if(pipelineStates.begin(), pipelineStates.end(), [this, &baked](const FixedFunctionState& state) {
+				return bakedState(state, dynamicMaterialState) == baked;
+			});
+
+			if (existing == pipelineStates.end()) {
+				pipelineStates.push_back(materials.back());
+				existing = pipelineStates.end() - 1;
+			}
+
+			materialPipelines.push_back(static_cast<uint32_t>(existing - pipelineStates.begin()));
+		}
+
+		std::cout << "materials: " << materials.size() << " -> " << pipelineStates.size() << " pipelines (dynamic: " << dynamicStateNames(dynamicMaterialState) << ")" << std::endl;
+	}
+
+	void createGraphicsPipeline() { // the fixed function state lives in buildGraphicsPipeline (pipeline_compiler.cpp), this only describes the pipelines
+		std::vector<GraphicsPipelineDesc> pipelineDescs = describeGraphicsPipelines(renderPass, swapChainImageFormat);
+
+		if (!pipelineCompiler.enabled()) {
+			usePipelines(buildGraphicsPipelines(device, pipelineCache.handle(), pipelineDescs), true);
+			return;
+		}
+
+		// async: unoptimized builds are quick and let frames be drawn right away, the optimized ones replace them once a worker is done
+
+		std::vector<GraphicsPipelineDesc> fallbackDescs = pipelineDescs;
+		for (auto& fallbackDesc : fallbackDescs) {
+			fallbackDesc.flags |= VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT;
+		}
+		usePipelines(buildGraphicsPipelines(device, pipelineCache.handle(), fallbackDescs), false);
+
+		pendingPipelines = pipelineCompiler.submit(std::move(pipelineDescs));
+	}
+
+	// one per entry of pipelineStates; also runs on a pipeline compiler worker for hot reloads, so the render pass and color format come in as copies made on the main thread
+	// (recreateSwapChain assigns swapChainImageFormat), everything else it reads is only written during initVulkan
+	std::vector<GraphicsPipelineDesc> describeGraphicsPipelines(VkRenderPass targetRenderPass, VkFormat colorFormat) {
+		// loading shader, the description owns the SPIR-V so it can be compiled on another thread
+
+		GraphicsPipelineDesc pipelineDesc;
+		pipelineDesc.stages = loadShaderStages();
+
+		if (!freezesSpecialization()) { // every brightness is its own pipeline variant, built from the same SPIR-V
+			pipelineDesc.stages[1].specialization = fragmentSpecialization();
+		}
+
+		// pipeline layout: whatever descriptor sets and push constants the shaders use, an identical layout from an earlier build is reused
+
+		ShaderReflection shaderInterface;
+		for (const auto& stage : pipelineDesc.stages) {
+			shaderInterface.merge(stage.reflection);
+		}
+
+		pipelineDesc.layout = pipelineLayoutCache.pipelineLayout(shaderInterface);
+
+		// vertex input: one binding of PackedVertex structs, whatever the vertex shader reads has to be in there
+
+		constexpr auto vertexAttributes = vertexAttributeDescriptions<PackedVertex>(0);
+		pipelineDesc.vertexBindings = { vertexBindingDescription<PackedVertex>(0) };
+		pipelineDesc.vertexAttributes.assign(vertexAttributes.begin(), vertexAttributes.end());
+
+		std::string vertexInputError = checkVertexInputs(shaderInterface.vertexInputs, vertexAttributes.data(), static_cast<uint32_t>(vertexAttributes.size()));
+		if (!vertexInputError.empty()) {
+			throw std::runtime_error("Vertex input doesn't match the vertex shader: " + vertexInputError + ".");
+		}
+		if (shaderInterface.vertexInputs.size() != vertexAttributes.size()) { // attributes it ignores are legal, but this shader is written for PackedVertex: most likely a stale prebuilt module
+			throw std::runtime_error("The vertex shader reads " + std::to_string(shaderInterface.vertexInputs.size()) + " of the " + std::to_string(vertexAttributes.size())
+				+ " vertex attributes, rebuild shaders/vert.spv with shaders/compile.sh (compile.bat on Windows).");
+		}
+
+		bool readsDecodeConstants = std::any_of(shaderInterface.pushConstantRanges.begin(), shaderInterface.pushConstantRanges.end(), [](const VkPushConstantRange& range) {
+			return (range.stageFlags & VK_SHADER_STAGE_VERTEX_BIT) != 0 && range.offset == 0 && range.size >= sizeof(MeshDecodeConstants);
+		});
+		if (!readsDecodeConstants) { // recordDraws pushes them, into a layout that has to have room for them
+			throw std::runtime_error("The vertex shader doesn't read the MeshDecodeConstants push constants, rebuild shaders/vert.spv with shaders/compile.sh (compile.bat on Windows).");
+		}
+		pipelineDesc.renderPass = targetRenderPass;
+		if (usesDynamicRendering()) { // no render pass to be compatible with, the pipeline only needs the attachment formats
+			pipelineDesc.colorAttachmentFormats = { colorFormat };
+		}
+
+		pipelineDesc.dynamicState = dynamicMaterialState;
+
+		// the variants only differ in the baked material state
+
+		std::vector<GraphicsPipelineDesc> pipelineDescs(pipelineStates.size(), pipelineDesc);
+		for (size_t i = 0; i < pipelineStates.size(); i++) {
+			pipelineDescs[i].state = pipelineStates[i];
+		}
+
+		return pipelineDescs;
+	}
+
+	void usePipelines(const std::vector<CompiledPipeline>& compiled, bool reportCompileTime) { // all or nothing; the replaced pipelines are destroyed once the frames drawn with them are done
+		bool failed = std::any_of(compiled.begin(), compiled.end(), [](const CompiledPipeline& pipeline) {
+			return pipeline.result != VK_SUCCESS;
+		});
+
+		if (failed || compiled.size() != pipelineStates.size()) {
+			for (const auto& pipeline : compiled) { // never used, nothing on the GPU references them
+				if (pipeline.pipeline != VK_NULL_HANDLE) {
+					vkDestroyPipeline(device, pipeline.pipeline, nullptr);
+				}
+			}
+
+			throw std::runtime_error("Failed to create graphics pipeline.");
+		}
+
+		if (reportCompileTime) { // only the optimized pipelines, so cold and warm starts stay comparable
+			for (const auto& pipeline : compiled) {
+				pipelineCache.reportCompileTime(pipeline.key, pipeline.compileMs);
+			}
+		}
+
+		if (!graphicsPipelines.empty()) {
+			deletionQueue.push(frameScheduler.lastSubmitted(), [device = device, pipelines = graphicsPipelines]() {
+				for (auto pipeline : pipelines) {
+					vkDestroyPipeline(device, pipeline, nullptr);
+				}
+			});
+		}
+
+		graphicsPipelines.clear();
+		for (const auto& pipeline : compiled) {
+			graphicsPipelines.push_back(pipeline.pipeline);
+		}
+
+		pipelineLayout = compiled.front().layout; // the same layout for every variant
+		commandBuffersDirty = true; // pre-recorded command buffers still bind the old pipelines
+	}
+
+	void updatePendingPipeline(bool wait) { // called between frames on the main thread, never while workers record
+		destroySupersededPipelines(false);
+
+		if (!pendingPipelines.valid()) {
+			return;
+		}
+
+		if (!wait && pendingPipelines.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			return;
+		}
+
+		if (!pendingIsReload) {
+			usePipelines(pendingPipelines.get(), true);
+			return;
+		}
+
+		// hot reload: a shader with errors keeps the current pipelines, the next save tries again
+
+		pendingIsReload = false;
+
+		try {
+			usePipelines(pendingPipelines.get(), true);
+			std::cout << "hot reload: pipelines replaced" << std::endl;
+		}
+		catch (const std::exception& e) {
+			std::cerr << "hot reload failed, keeping the current pipelines: " << e.what() << std::endl;
+		}
+
+		updateShaderDependencies(); // the edit may have added or removed an include
+	}
+
+	// shader hot reload: the watcher thread reports changed files, the rebuild runs on a pipeline compiler worker and updatePendingPipeline swaps it in between frames
+	// the old pipeline goes through the deletion queue like everything else, there is no vkDeviceWaitIdle anywhere in this path
+
+	void createShaderWatcher() {
+		if (!config.hotReload) {
+			return;
+		}
+
+		if (!config.runtimeShaderCompile || !pipelineCompiler.enabled()) {
+			std::cerr << "hot reload needs runtime shader compilation and at least one pipeline compile thread, it is disabled" << std::endl;
+			return;
+		}
+
+		updateShaderDependencies();
+		shaderWatcher.start(SHADER_DIRECTORY);
+	}
+
+	void updateShaderDependencies() {
+		shaderDependencies.clear();
+
+		for (const auto& request : shaderCompileRequests()) {
+			for (const auto& file : shaderCompiler.sourceFiles(request)) {
+				shaderDependencies.insert(file);
+			}
+		}
+	}
+
+	void checkShaderChanges() {
+		if (!shaderWatcher.running()) {
+			return;
+		}
+
+		std::vector<std::string> changes = shaderWatcher.takeChanges(HOT_RELOAD_SETTLE_TIME);
+		auto affected = std::find_if(changes.begin(), changes.end(), [this](const std::string& path) {
+			return shaderDependencies.count(path) > 0;
+		});
+
+		if (affected == changes.end()) {
+			return;
+		}
+
+		std::cout << "hot reload: " << *affected << " changed, rebuilding the pipeline" << std::endl;
+
+		if (pendingPipelines.valid()) { // a build that is still running is outdated now
+			supersededPipelines.push_back(std::move(pendingPipelines));
+		}
+
+		pendingPipelines = pipelineCompiler.submit([this, targetRenderPass = renderPass, colorFormat = swapChainImageFormat]() {
+			return describeGraphicsPipelines(targetRenderPass, colorFormat);
+		});
+		pendingIsReload = true;
+	}
+
+	static std::vector<uint32_t> readSpirvFile(const std::string& filename) { // reads all of the words of a SPIR-V module, read as words so the code is aligned the way VkShaderModuleCreateInfo needs it
+		std::ifstream file(filename, std::ios::ate | std::ios::binary); // ate: start reading at the end of the file, binary: read the file as a binary file (avoid text transformation)
+
+		if (!file.is_open()) {
+			throw std::runtime_error("Failed to open file.");
+		}
+
+		size_t fileSize = (size_t)file.tellg();
+		if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0) {
+			throw std::runtime_error("Invalid SPIR-V file " + filename + ".");
+		}
+
+		std::vector<uint32_t> buffer(fileSize / sizeof(uint32_t));
+
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(buffer.data()), fileSize);
+
+		file.close();
+
+		return buffer;
+	}
+
+	// render passes
+
+	void createRenderPass() {
+		if (usesDynamicRendering()) { // no render pass: the attachments are passed to vkCmdBeginRendering, the layout transitions are barriers in recordCommandBuffer
+			return;
+		}
+
+		// attachment description
+
+		VkAttachmentDescription color_attachment_desc = {};
+		color_attachment_desc.format = swapChainImageFormat; // should match the format of the swap chain images
+		color_attachment_desc.samples = VK_SAMPLE_COUNT_1_BIT; // use 1 sample unless you're doing multisampling
+		// applies to color an depth data
+		color_attachment_desc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR; // determines what to do with the data in the attachment before rendering and after rendering, clear the framebuffer to black before drawing a new frame
+		color_attachment_desc.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // same, rendered contents will be stored in memory and can be read later
+		// applies to stencil data
+		color_attachment_desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE; // stencil is irrelevant when not doing anything with the stencil buffer
+		color_attachment_desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE; // same
+		color_attachment_desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // undefined means we don't care, specifies which layout the image will have before the render pass begins
+		color_attachment_desc.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // for images to be presented in the swap chain, images need to be transitioned to specific layouts that are suitable for the operation that they're going to be involved in next
+		if (config.headless) {
+			color_attachment_desc.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; // offscreen images are never presented, keep them ready to be copied out
+		}
+
+		// subpasses and attachment references
+
+		VkAttachmentReference color_attachment_ref = {};
+		color_attachment_ref.attachment = 0; // index of the attachment to reference (from the description array, which only consists of 1 element)
+		color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; // optimal for best performance
+
+		VkSubpassDescription subpass_desc = {};
+		subpass_desc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass_desc.colorAttachmentCount = 1;
+		subpass_desc.pColorAttachments = &color_attachment_ref;
+
+		// subpass dependencies (new in rendering an presentation)
+
+		VkSubpassDependency subpass_dependency = {};
+		subpass_dependency.srcSubpass = VK_SUBPASS_EXTERNAL; // refers to the implicit subpass before or after the render pass
+		subpass_dependency.dstSubpass = 0; // dstSubpass must always be higher than srcSubpass to prevent cycles in the dependency graph (unless one of the subpasses is VK_SUBPASS_EXTERNAL
+		subpass_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		subpass_dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		subpass_dependency.srcAccessMask = 0;
+		subpass_dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		// render pass
+
+		VkRenderPassCreateInfo render_pass_info = {};
+		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		render_pass_info.attachmentCount = 1;
+		render_pass_info.pAttachments = &color_attachment_desc;
+		render_pass_info.subpassCount = 1;
+		render_pass_info.pSubpasses = &subpass_desc;
+		render_pass_info.dependencyCount = 1;
+		render_pass_info.pDependencies = &subpass_dependency;
+
+		if (vkCreateRenderPass(device, &render_pass_info, nullptr, &renderPass) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create render pass.");
+		}
+	}
+
+	// framebuffers
+
+	void createFramebuffers() {
+		commandBuffersDirty = true; // new framebuffers / image views (and maybe a new extent) have to be recorded again
+
+		if (usesDynamicRendering()) { // the image views are used directly, there is nothing to create
+			return;
+		}
+
+		swapChainFramebuffers.resize(swapChainImageViews.size()); // resize the container to hold all of the framebuffers
+
+		for (size_t i = 0; i < swapChainImageViews.size(); i++)
+		{
+			VkImageView attachments[] = {
+				swapChainImageViews[i]
+			};
+
+			VkFramebufferCreateInfo framebuffer_info = {};
+			framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebuffer_info.renderPass = renderPass; // compatible render pass: framebuffer and render pass use the same number of attachments
+			framebuffer_info.attachmentCount = 1;
+			framebuffer_info.pAttachments = attachments;
+			framebuffer_info.width = swapChainExtent.width;
+			framebuffer_info.height = swapChainExtent.height;
+			framebuffer_info.layers = 1; // number of layers in image arrays, here single images
+
+			if (vkCreateFramebuffer(device, &framebuffer_info, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create framebuffer.");
+			}
+		}
+	}
+
+	// command buffers
+
+	// command pools: manage the memory that is used to store the buffers and command buffers are allocated from them
+
+	void createCommandPool() {
+		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+		VkCommandPoolCreateInfo command_pool_info = {};
+		command_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		command_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // allows command buffers to be rerecorded individually, without this flag they all have to be reset together
+		command_pool_info.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+		if (vkCreateCommandPool(device, &command_pool_info, nullptr, &commandPool) != VK_SUCCESS) { // commands will be used throughout the program to draw things on the screen
+			throw std::runtime_error("Failed to create command pool.");
+		}
+	}
+
+	// command buffer allocation
+
+	void createCommandBuffers() { // one command buffer per frame in flight, so the CPU can record the next frame while the GPU still executes the previous one
+		frames.resize(config.framesInFlight);
+		currentFrame = 0;
+
+		std::vector<VkCommandBuffer> commandBuffers(frames.size() * 2); // the frame's own and the one for the upload acquire barriers
+
+		VkCommandBufferAllocateInfo command_buffer_allocate_info = {};
+		command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		command_buffer_allocate_info.commandPool = commandPool;
+		command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; // PRIMARY: can be submitted to a queue for execution, but cannot be called from other command buffers; SECONDARY: can't be submitted directly, but can be called from primary command buffers
+		command_buffer_allocate_info.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+
+		if (vkAllocateCommandBuffers(device, &command_buffer_allocate_info, commandBuffers.data()) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate command buffers.");
+		}
+
+		for (size_t i = 0; i < frames.size(); i++) {
+			frames[i].commandBuffer = commandBuffers[i * 2];
+			frames[i].uploadCommandBuffer = commandBuffers[i * 2 + 1];
+		}
+	}
+
+	void createParallelRecorder() { // worker command pools for every possible frame slot, so the recorder survives rebuilding the frame ring
+		if (config.recordThreads > 0) {
+			parallelRecorder.create(device, findQueueFamilies(physicalDevice).graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, config.recordThreads);
+		}
+	}
+
+	// GPU profiler
+
+	void createGpuProfiler() { // query pools for every possible frame slot, results are read when a slot is reused
+		if (!config.gpuProfiling) {
+			return;
+		}
+
+		gpuProfiler.create(device, physicalDevice, findQueueFamilies(physicalDevice).graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, pipelineStatisticsEnabled);
+
+		if (!gpuProfiler.enabled()) {
+			std::cerr << "GPU profiler: the graphics queue doesn't support timestamps, profiling is disabled" << std::endl;
+		}
+	}
+
+	void destroyGpuProfiler() {
+		if (gpuProfiler.enabled() && !config.gpuProfilePath.empty()) {
+			for (const auto& stats : gpuProfiler.statistics()) {
+				std::cout << "gpu " << stats.name << ": avg " << stats.averageMs << " ms | p50 " << stats.p50Ms << " ms | p95 " << stats.p95Ms << " ms | p99 " << stats.p99Ms << " ms" << std::endl;
+			}
+
+			if (config.gpuProfilePath.ends_with(".json")) {
+				gpuProfiler.writeJson(config.gpuProfilePath);
+			}
+			else {
+				gpuProfiler.writeCsv(config.gpuProfilePath);
+			}
+		}
+
+		gpuProfiler.destroy();
+	}
+
+	// static command buffers: the recorded commands only depend on the framebuffer, so with nothing changing they can be recorded once and submitted every frame
+
+	void recordImageCommandBuffers() { // (re-)records the command buffer of every framebuffer, called when commandBuffersDirty is set
+		frameScheduler.waitIdle(); // none of them may still be pending on the GPU; a timeline wait, not vkDeviceWaitIdle
+
+		if (imageCommandBuffers.size() != swapChainImages.size()) {
+			if (!imageCommandBuffers.empty()) {
+				vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(imageCommandBuffers.size()), imageCommandBuffers.data());
+			}
+
+			imageCommandBuffers.resize(swapChainImages.size());
+
+			VkCommandBufferAllocateInfo command_buffer_allocate_info = {};
+			command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			command_buffer_allocate_info.commandPool = commandPool;
+			command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			command_buffer_allocate_info.commandBufferCount = static_cast<uint32_t>(imageCommandBuffers.size());
+
+			if (vkAllocateCommandBuffers(device, &command_buffer_allocate_info, imageCommandBuffers.data()) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to allocate command buffers.");
+			}
+		}
+
+		for (uint32_t i = 0; i < imageCommandBuffers.size(); i++) {
+			recordCommandBuffer(imageCommandBuffers[i], i); // vkBeginCommandBuffer resets them, the pool was created with VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT
+		}
+
+		commandBuffersDirty = false;
+	}
+
+	// command buffer recording
+
+	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, const std::vector<VkCommandBuffer>& secondaryCommandBuffers = {}, bool profile = false) { // writes the commands we want to execute into a command buffer; draws are recorded inline unless secondary command buffers are passed in; profile: GPU profiler scopes for the current frame slot
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = 0; // specifies how we're going to use the command buffer (3 types available)
+		begin_info.pInheritanceInfo = nullptr; // only relevant for secondary command buffers, specifies which state to inherit from the calling primary command buffers
+
+		if (vkBeginCommandBuffer(commandBuffer, &begin_info) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to begin recording command buffer.");
+		}
+
+		profile = profile && gpuProfiler.enabled();
+		if (profile) {
+			gpuProfiler.beginFrame(commandBuffer, currentFrame, secondaryCommandBuffers.empty() || inheritedQueriesEnabled); // query resets have to happen outside of the render pass
+			gpuProfiler.beginScope(commandBuffer, "frame");
+		}
+
+		if (usesDynamicRendering()) {
+			recordDynamicRendering(commandBuffer, imageIndex, secondaryCommandBuffers, profile);
+		}
+		else {
+			recordRenderPass(commandBuffer, imageIndex, secondaryCommandBuffers, profile);
+		}
+
+		if (profile) {
+			gpuProfiler.endScope(commandBuffer); // frame
+		}
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) { // finished recording the command buffer
+			throw std::runtime_error("Failed to record command buffer.");
+		}
+	}
+
+	void recordRenderPass(VkCommandBuffer commandBuffer, uint32_t imageIndex, const std::vector<VkCommandBuffer>& secondaryCommandBuffers, bool profile) {
+		// starting a render pass
+
+		VkRenderPassBeginInfo render_pass_begin_info = {};
+		render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		render_pass_begin_info.renderPass = renderPass;
+		render_pass_begin_info.framebuffer = swapChainFramebuffers[imageIndex];
+		render_pass_begin_info.renderArea.offset = { 0, 0 }; // size of the render area, where shader loads and stores will take place
+		render_pass_begin_info.renderArea.extent = swapChainExtent;
+
+		VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} }; // black with 100% opacity
+
+		render_pass_begin_info.clearValueCount = 1;
+		render_pass_begin_info.pClearValues = &clearColor;
+
+		if (profile) {
+			gpuProfiler.beginScope(commandBuffer, "render pass");
+		}
+
+		if (secondaryCommandBuffers.empty()) {
+			vkCmdBeginRenderPass(commandBuffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE); // render pass can now begin; INLINE: render pass commands will be embedded in the primary command buffer itself and no secondary command buffers will be executed
+			recordDraws(commandBuffer, 0, config.sceneDrawCount);
+		}
+		else {
+			vkCmdBeginRenderPass(commandBuffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS); // SECONDARY: the whole subpass comes from secondary command buffers, no inline commands allowed
+			vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+
+		if (profile) {
+			gpuProfiler.endScope(commandBuffer); // render pass
+		}
+	}
+
+	// dynamic rendering: the same work without a render pass or framebuffer, the attachment is the image view itself
+	// what the render pass did implicitly (layout transitions, the external dependency) are two image barriers
+
+	void recordDynamicRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex, const std::vector<VkCommandBuffer>& secondaryCommandBuffers, bool profile) {
+		// undefined -> color attachment; waits on the same stage the acquire semaphore is waited on, like the render pass' external dependency
+
+		transitionImageLayout(commandBuffer, swapChainImages[imageIndex], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+
+		VkRenderingAttachmentInfo color_attachment_info = {};
+		color_attachment_info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		color_attachment_info.imageView = swapChainImageViews[imageIndex];
+		color_attachment_info.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		color_attachment_info.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR; // same load / store ops as the render pass attachment
+		color_attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		color_attachment_info.clearValue = { {{0.0f, 0.0f, 0.0f, 1.0f}} }; // black with 100% opacity
+
+		VkRenderingInfo rendering_info = {};
+		rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		rendering_info.flags = secondaryCommandBuffers.empty() ? 0 : VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+		rendering_info.renderArea.offset = { 0, 0 };
+		rendering_info.renderArea.extent = swapChainExtent;
+		rendering_info.layerCount = 1;
+		rendering_info.colorAttachmentCount = 1;
+		rendering_info.pColorAttachments = &color_attachment_info;
+
+		if (profile) {
+			gpuProfiler.beginScope(commandBuffer, "render pass"); // same scope name as the render pass path, so profiles of both compare directly
+		}
+
+		cmdBeginRendering(commandBuffer, &rendering_info);
+
+		if (secondaryCommandBuffers.empty()) {
+			recordDraws(commandBuffer, 0, config.sceneDrawCount);
+		}
+		else {
+			vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+		}
+
+		cmdEndRendering(commandBuffer);
+
+		if (profile) {
+			gpuProfiler.endScope(commandBuffer); // render pass
+		}
+
+		// color attachment -> present (or transfer source for the offscreen images), the render pass' final layout
+
+		transitionImageLayout(commandBuffer, swapChainImages[imageIndex], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, config.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0); // presentation is ordered by the render finished semaphore, nothing to wait for here
+	}
+
+	static void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+
+		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount) { // records a range of the scene's draws; also called from worker threads, so it only reads renderer state
+		// basic drawing commands
+
+		VkViewport viewport = {};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(swapChainExtent.width);
+		viewport.height = static_cast<float>(swapChainExtent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+		VkRect2D scissor = {};
+		scissor.offset = { 0, 0 };
+		scissor.extent = swapChainExtent;
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor); // every pipeline has viewport and scissor dynamic, so binding another one keeps them
+
+		// material changes: a pipeline bind where the baked state differs, vkCmdSet* calls for the dynamic fields that differ
+
+		sceneMesh.bind(commandBuffer); // every draw uses the same vertex and index buffer
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(sceneMeshDecode), &sceneMeshDecode); // all pipelines share the layout, the constants survive the pipeline binds
+
+		uint32_t boundPipeline = UINT32_MAX; // state is not inherited by secondary command buffers, so every range binds again
+		const FixedFunctionState* currentState = nullptr;
+		uint64_t pipelineBinds = 0;
+		uint64_t dynamicStateCalls = 0;
+
+		for (uint32_t draw = firstDraw; draw < firstDraw + drawCount; draw++) {
+			uint32_t material = materialIndex(draw);
+			uint32_t pipeline = materialPipelines[material];
+
+			if (pipeline != boundPipeline) {
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipelines[pipeline]); // GRAPHICS: the pipeline object is a graphics pipeline, not a compute one
+				boundPipeline = pipeline;
+				pipelineBinds++;
+			}
+
+			if (dynamicMaterialState != 0) { // dynamic state set before a bind stays valid, the pipelines all have the same fields dynamic
+				dynamicStateCalls += extendedDynamicState.apply(commandBuffer, dynamicMaterialState, materials[material], currentState);
+				currentState = &materials[material];
+			}
+
+			vkCmdDrawIndexed(commandBuffer, sceneMesh.indexCount(), 1, 0, 0, draw); // draw command for the mesh
+			// 1. indexCount: number of indices read from the index buffer
+			// 2. instanceCount: for instance rendering, use 1 if you're not doing that
+			// 3. firstIndex: offset into the index buffer
+			// 4. vertexOffset: added to every index before the vertex buffer is read
+			// 5. firstInstance: offset for instanced rendering, defines the lowest value of gl_InstanceIndex (here: the draw index)
+		}
+
+		pipelineBindCount += pipelineBinds; // once per range, the workers don't contend on every draw
+		dynamicStateCallCount += dynamicStateCalls;
+	}
+
+	// rendering and presentation
+
+	void drawFrame() {
+		CPU_PROFILE_SCOPE("drawFrame");
+		auto frameStart = std::chrono::steady_clock::now();
+
+		// synchronization
+
+		// semaphores: used to add order between queue operations (work we submit to a queue), there's binary semaphore and timeline semaphore in Vulkan; binary semaphores do not block host execution
+		//			   we need 2 binary semaphores per frame in flight, because the swap chain only works with binary ones:
+		//			   1. to signal that an image has been acquired from the swapchain and is ready for rendering
+		//			   2. to signal that rendering has finished and presentation can happen
+		// timeline semaphore: a counter the GPU increases, the host can wait for an exact value (replaces the fences, so there's nothing to reset)
+		//			   every submission signals the next value, the CPU only waits when it wraps around to a slot whose frame is still on the GPU
+
+		FrameResources& frame = frames[currentFrame];
+
+		// waiting for the frame that last used this slot
+
+		auto waitStart = std::chrono::steady_clock::now();
+		{
+			CPU_PROFILE_SCOPE("wait frame slot");
+			frameScheduler.wait(frame.timelineValue); // returns immediately if the value is already known to be reached
+		}
+		double gpuWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+
+		deletionQueue.collect(frameScheduler.completedValue());
+		transientBuffers.beginFrame(currentFrame); // the slot's previous frame is done, so is its transient data
+		checkShaderChanges();
+		updatePendingPipeline(false);
+
+		// coalesced resize: only recreate once the window size has settled
+
+		if (resizePending && std::chrono::steady_clock::now() - lastResizeTime >= RESIZE_SETTLE_TIME) {
+			recreateSwapChain();
+		}
+
+		for (auto& deletion : frame.transientDeletions) { // the GPU is done with this slot, so its transient allocations can go
+			deletion();
+		}
+		frame.transientDeletions.clear();
+
+		// acquiring an image from the swap chain
+
+		uint32_t imageIndex;
+		if (config.headless) {
+			imageIndex = nextOffscreenImage;
+			nextOffscreenImage = (nextOffscreenImage + 1) % static_cast<uint32_t>(swapChainImages.size());
+		}
+		else {
+			CPU_PROFILE_SCOPE("vkAcquireNextImageKHR");
+			VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex); // imageIndex refers to the VkImage in our swapChainImages array, we're going to use it to pick the VkFrameBuffer
+
+			if (result == VK_ERROR_OUT_OF_DATE_KHR) { // the swap chain can't be used anymore, recreate right away and try again next frame (the semaphore was not signaled)
+				recreateSwapChain();
+				return;
+			}
+			else if (result == VK_SUBOPTIMAL_KHR) { // still presentable, recreate once the size settles
+				resizePending = true;
+			}
+			else if (result != VK_SUCCESS) {
+				throw std::runtime_error("Failed to acquire swap chain image.");
+			}
+		}
+
+		// the image can be handed out again while an older frame (from a different slot) still renders into it
+
+		waitStart = std::chrono::steady_clock::now();
+		{
+			CPU_PROFILE_SCOPE("wait image");
+			frameScheduler.wait(imagesInFlight[imageIndex]);
+		}
+		gpuWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+
+		// recording the command buffer
+
+		auto recordStart = std::chrono::steady_clock::now();
+		VkCommandBuffer commandBuffer = frame.commandBuffer;
+
+		{
+			CPU_PROFILE_SCOPE("record");
+
+			if (config.staticCommandBuffers) { // the buffer for this image was recorded earlier, the wait on imagesInFlight above made sure it is no longer pending
+				if (commandBuffersDirty) {
+					recordImageCommandBuffers();
+				}
+
+				commandBuffer = imageCommandBuffers[imageIndex];
+			}
+			else if (parallelRecorder.threadCount() > 0) { // draws recorded by the workers, the primary only wraps them in the render pass
+				VkCommandBufferInheritanceInfo inheritance_info = {};
+				inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+				inheritance_info.renderPass = renderPass;
+				inheritance_info.subpass = 0;
+				inheritance_info.framebuffer = usesDynamicRendering() ? VK_NULL_HANDLE : swapChainFramebuffers[imageIndex]; // optional, but lets the driver know the exact target
+
+				VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info = {}; // dynamic rendering: the secondaries are told the attachment formats instead of a render pass
+				inheritance_rendering_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+				inheritance_rendering_info.colorAttachmentCount = 1;
+				inheritance_rendering_info.pColorAttachmentFormats = &swapChainImageFormat;
+				inheritance_rendering_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+				if (usesDynamicRendering()) {
+					inheritance_info.pNext = &inheritance_rendering_info;
+				}
+				inheritance_info.pipelineStatistics = gpuProfiler.enabled() && inheritedQueriesEnabled ? gpuProfiler.pipelineStatisticsFlags() : 0; // must match the statistics query active in the primary, which needs inheritedQueries
+
+				const auto& secondaryCommandBuffers = parallelRecorder.record(currentFrame, inheritance_info, config.sceneDrawCount, [this](VkCommandBuffer secondaryCommandBuffer, uint32_t firstDraw, uint32_t drawCount) {
+					recordDraws(secondaryCommandBuffer, firstDraw, drawCount);
+				});
+
+				vkResetCommandBuffer(frame.commandBuffer, 0);
+				recordCommandBuffer(frame.commandBuffer, imageIndex, secondaryCommandBuffers, true);
+			}
+			else {
+				vkResetCommandBuffer(frame.commandBuffer, 0);
+				recordCommandBuffer(frame.commandBuffer, imageIndex, {}, true); // function we defined before
+			}
+		}
+
+		frameTimings.recordMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+		frameTimings.pipelineBinds += pipelineBindCount.exchange(0); // static command buffers only count when they are recorded
+		frameTimings.dynamicStateCalls += dynamicStateCallCount.exchange(0);
+
+		// uploads: everything staged since the last frame goes to the transfer queue now, the frame waits for it on the GPU only
+
+		auto uploadStart = std::chrono::steady_clock::now();
+		UploadSubmission uploads;
+		{
+			CPU_PROFILE_SCOPE("uploads");
+			streamUploads();
+
+			uint64_t uploadedBytes = uploadQueue.statistics().bytes;
+			uploads = std::move(submittedUploads);
+			uploads.merge(uploadQueue.submit());
+			submittedUploads = {};
+			frameTimings.uploadBytes += uploadQueue.statistics().bytes - uploadedBytes;
+
+			if (uploads.needsAcquire()) { // ownership transfers to the graphics family, in a command buffer of their own so pre-recorded ones stay untouched
+				VkCommandBufferBeginInfo begin_info = {};
+				begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+				vkResetCommandBuffer(frame.uploadCommandBuffer, 0);
+				if (vkBeginCommandBuffer(frame.uploadCommandBuffer, &begin_info) != VK_SUCCESS) {
+					throw std::runtime_error("Failed to begin recording upload acquire command buffer.");
+				}
+
+				UploadQueue::recordAcquire(frame.uploadCommandBuffer, uploads);
+
+				if (vkEndCommandBuffer(frame.uploadCommandBuffer) != VK_SUCCESS) {
+					throw std::runtime_error("Failed to record upload acquire command buffer.");
+				}
+			}
+		}
+		frameTimings.uploadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+
+		// submitting the command buffer
+
+		frame.timelineValue = frameScheduler.nextSubmitValue();
+		imagesInFlight[imageIndex] = frame.timelineValue;
+
+		VkSemaphore waitSemaphores[] = { frame.imageAvailableSemaphore, uploadQueue.semaphore() };
+		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, uploads.waitStages };
+		uint64_t waitValues[] = { 0, uploads.timelineValue }; // ignored for binary semaphores
+
+		VkSemaphore signalSemaphores[] = { frame.renderFinishedSemaphore, frameScheduler.semaphore() };
+		uint64_t signalValues[] = { 0, frame.timelineValue };
+
+		uint32_t binarySemaphoreCount = config.headless ? 0 : 1; // headless: nothing was acquired and nothing will be presented, only the timeline is signaled
+		uint32_t waitSemaphoreCount = binarySemaphoreCount + (uploads.timelineValue != 0 ? 1 : 0); // the upload wait only if something was submitted this frame
+
+		VkCommandBuffer submitCommandBuffers[] = { frame.uploadCommandBuffer, commandBuffer };
+		uint32_t firstCommandBuffer = uploads.needsAcquire() ? 0 : 1;
+
+		VkTimelineSemaphoreSubmitInfo timeline_submit_info = {}; // values for the timeline semaphores in the wait / signal lists
+		timeline_submit_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timeline_submit_info.waitSemaphoreValueCount = waitSemaphoreCount;
+		timeline_submit_info.pWaitSemaphoreValues = waitValues + (1 - binarySemaphoreCount);
+		timeline_submit_info.signalSemaphoreValueCount = 1 + binarySemaphoreCount;
+		timeline_submit_info.pSignalSemaphoreValues = signalValues + (1 - binarySemaphoreCount);
+
+		VkSubmitInfo submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.pNext = &timeline_submit_info;
+		submit_info.waitSemaphoreCount = waitSemaphoreCount;
+		submit_info.pWaitSemaphores = waitSemaphores + (1 - binarySemaphoreCount);
+		submit_info.pWaitDstStageMask = waitStages + (1 - binarySemaphoreCount);
+		submit_info.commandBufferCount = 2 - firstCommandBuffer;
+		submit_info.pCommandBuffers = submitCommandBuffers + firstCommandBuffer;
+		submit_info.signalSemaphoreCount = 1 + binarySemaphoreCount;
+		submit_info.pSignalSemaphores = signalSemaphores + (1 - binarySemaphoreCount);
+
+		{
+			CPU_PROFILE_SCOPE("vkQueueSubmit");
+
+			if (vkQueueSubmit(graphicsQueue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) { // no fence, the timeline value tells us when the frame is done
+				throw std::runtime_error("Failed to submit draw command buffer.");
+			}
+		}
+
+		if (config.headless) {
+			finishFrame(frameStart, gpuWaitMs);
+			return;
+		}
+
+		// presentation
+
+		VkPresentInfoKHR present_info = {};
+		present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		present_info.waitSemaphoreCount = 1;
+		present_info.pWaitSemaphores = &frame.renderFinishedSemaphore;
+
+		VkSwapchainKHR swapChains[] = { swapChain };
+
+		present_info.swapchainCount = 1;
+		present_info.pSwapchains = swapChains;
+		present_info.pImageIndices = &imageIndex;
+		present_info.pResults = nullptr;
+
+		VkResult result;
+		{
+			CPU_PROFILE_SCOPE("vkQueuePresentKHR");
+			result = vkQueuePresentKHR(presentQueue, &present_info); // submits the request to present an image to the swap chain
+		}
+
+		if ((result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) && !retiredSwapChains.empty()) {
+			retireSwapChains(frame.timelineValue);
+		}
+
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) { // handled at the start of the next frame
+			resizePending = true;
+		}
+		else if (result != VK_SUCCESS) {
+			throw std::runtime_error("Failed to present swap chain image.");
+		}
+
+		finishFrame(frameStart, gpuWaitMs);
+	}
+
+	void retireSwapChains(uint64_t timelineValue) { // a frame was presented on the current swap chain, the retired ones go once it is done
+		// the presents of a queue are processed in order, every present on the old swap chains was queued before this one
+		// VK_EXT_swapchain_maintenance1 present fences would tell exactly when they are done, it isn't enabled here
+		std::vector<VkSwapchainKHR> oldSwapChains;
+		oldSwapChains.swap(retiredSwapChains);
+
+		deletionQueue.push(timelineValue, [this, oldSwapChains]() { // after their image views, which were pushed with an earlier value
+			for (auto oldSwapChain : oldSwapChains) {
+				vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+			}
+		});
+	}
+
+	void finishFrame(std::chrono::steady_clock::time_point frameStart, double gpuWaitMs) {
+		currentFrame = (currentFrame + 1) % static_cast<uint32_t>(frames.size()); // advance to the next slot of the ring
+
+		frameTimings.frameCount++;
+		frameTimings.gpuWaitMs += gpuWaitMs;
+		frameTimings.cpuFrameMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+	}
+
+	void createSyncObjects() {
+		// synchronization
+
+		if (frameScheduler.semaphore() == VK_NULL_HANDLE) { // the timeline keeps counting when the frame ring is rebuilt
+			frameScheduler.create(device);
+		}
+
+		imagesInFlight.assign(swapChainImages.size(), 0);
+
+		VkSemaphoreCreateInfo semaphore_info = {};
+		semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		for (auto& frame : frames) {
+			frame.timelineValue = 0; // value 0 is reached from the start, so the first wait on every slot returns immediately
+
+			if (vkCreateSemaphore(device, &semaphore_info, nullptr, &frame.imageAvailableSemaphore) != VK_SUCCESS ||
+				vkCreateSemaphore(device, &semaphore_info, nullptr, &frame.renderFinishedSemaphore) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create semaphores (synchronization).");
+			}
+		}
+	}
+
+	void destroyFrameResources() { // expects the device to be idle
+		for (auto& frame : frames) {
+			for (auto& deletion : frame.transientDeletions) {
+				deletion();
+			}
+
+			vkDestroySemaphore(device, frame.imageAvailableSemaphore, nullptr);
+			vkDestroySemaphore(device, frame.renderFinishedSemaphore, nullptr);
+			vkFreeCommandBuffers(device, commandPool, 1, &frame.commandBuffer);
+			vkFreeCommandBuffers(device, commandPool, 1, &frame.uploadCommandBuffer);
+		}
+
+		frames.clear();
+		imagesInFlight.clear();
+	}
+};
@@ -0,0 +1,267 @@
+#include "json.h"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+const uint32_t JSON_MAX_DEPTH = 256; // nesting beyond this is rejected instead of overflowing the stack
+
+class JsonParser {
+public:
+	JsonParser(const char* text, size_t size) : position(text), end(text + size) {}
+
+	JsonValue parseDocument() {
+		JsonValue value = parseValue(0);
+		skipWhitespace();
+
+		if (position != end) {
+			fail("trailing characters after the document");
+		}
+
+		return value;
+	}
+
+private:
+	[[noreturn]] void fail(const char* message) {
+		throw std::runtime_error(std::string("Invalid JSON: ") + message + ".");
+	}
+
+	void skipWhitespace() {
+		while (position != end && (*position == ' ' || *position == '\t' || *position == '\n' || *position == '\r')) {
+			position++;
+		}
+	}
+
+	void expect(char c) {
+		skipWhitespace();
+		if (position == end || *position != c) {
+			fail("unexpected character");
+		}
+		position++;
+	}
+
+	bool consume(const char* literal) {
+		size_t length = std::strlen(literal);
+		if (static_cast<size_t>(end - position) < length || std::memcmp(position, literal, length) != 0) {
+			return false;
+		}
+		position += length;
+		return true;
+	}
+
+	JsonValue parseValue(uint32_t depth) {
+		if (depth > JSON_MAX_DEPTH) {
+			fail("nested too deeply");
+		}
+
+		skipWhitespace();
+		if (position == end) {
+			fail("unexpected end of the document");
+		}
+
+		JsonValue value;
+
+		switch (*position) {
+		case '{':
+			value.type = JsonValue::Type::Object;
+			position++;
+			skipWhitespace();
+
+			if (position != end && *position == '}') {
+				position++;
+				return value;
+			}
+
+			while (true) {
+				skipWhitespace();
+				if (position == end || *position != '"') {
+					fail("expected a member name");
+				}
+
+				std::string key = parseString();
+				expect(':');
+				value.object.emplace_back(std::move(key), parseValue(depth + 1));
+
+				skipWhitespace();
+				if (position != end && *position == ',') {
+					position++;
+					continue;
+				}
+				expect('}');
+				return value;
+			}
+
+		case '[':
+			value.type = JsonValue::Type::Array;
+			position++;
+			skipWhitespace();
+
+			if (position != end && *position == ']') {
+				position++;
+				return value;
+			}
+
+			while (true) {
+				value.array.push_back(parseValue(depth + 1));
+
+				skipWhitespace();
+				if (position != end && *position == ',') {
+					position++;
+					continue;
+				}
+				expect(']');
+				return value;
+			}
+
+		case '"':
+			value.type = JsonValue::Type::String;
+			value.string = parseString();
+			return value;
+
+		case 't':
+		case 'f':
+			value.type = JsonValue::Type::Bool;
+			value.boolean = *position == 't';
+			if (!consume(value.boolean ? "true" : "false")) {
+				fail("unknown literal");
+			}
+			return value;
+
+		case 'n':
+			if (!consume("null")) {
+				fail("unknown literal");
+			}
+			return value;
+
+		default: {
+			value.type = JsonValue::Type::Number;
+			const char* start = position;
+			auto result = std::from_chars(start, end, value.number); // accepts a little more than JSON (inf, nan, leading zeros), harmless here
+			if (result.ec != std::errc()) {
+				fail("invalid number");
+			}
+			position = result.ptr;
+			return value;
+		}
+		}
+	}
+
+	std::string parseString() { // position is on the opening quote
+		position++;
+		std::string result;
+
+		while (true) {
+			if (position == end) {
+				fail("unterminated string");
+			}
+
+			char c = *position++;
+
+			if (c == '"') {
+				return result;
+			}
+
+			if (c != '\\') {
+				result.push_back(c); // UTF-8 passes through unchanged
+				continue;
+			}
+
+			if (position == end) {
+				fail("unterminated escape sequence");
+			}
+
+			switch (*position++) {
+			case '"': result.push_back('"'); break;
+			case '\\': result.push_back('\\'); break;
+			case '/': result.push_back('/'); break;
+			case 'b': result.push_back('\b'); break;
+			case 'f': result.push_back('\f'); break;
+			case 'n': result.push_back('\n'); break;
+			case 'r': result.push_back('\r'); break;
+			case 't': result.push_back('\t'); break;
+			case 'u': {
+				uint32_t codePoint = parseHex4();
+
+				if (codePoint >= 0xd800 && codePoint < 0xdc00) { // high surrogate, the low one follows as another \u escape
+					if (!consume("\\u")) {
+						fail("unpaired surrogate");
+					}
+					uint32_t low = parseHex4();
+					if (low < 0xdc00 || low >= 0xe000) {
+						fail("unpaired surrogate");
+					}
+					codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+				}
+
+				appendUtf8(result, codePoint);
+				break;
+			}
+			default:
+				fail("unknown escape sequence");
+			}
+		}
+	}
+
+	uint32_t parseHex4() {
+		if (end - position < 4) {
+			fail("truncated \\u escape");
+		}
+
+		uint32_t value = 0;
+		auto result = std::from_chars(position, position + 4, value, 16);
+		if (result.ec != std::errc() || result.ptr != position + 4) {
+			fail("invalid \\u escape");
+		}
+
+		position += 4;
+		return value;
+	}
+
+	static void appendUtf8(std::string& text, uint32_t codePoint) {
+		if (codePoint < 0x80) {
+			text.push_back(static_cast<char>(codePoint));
+		}
+		else if (codePoint < 0x800) {
+			text.push_back(static_cast<char>(0xc0 | (codePoint >> 6)));
+			text.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+		}
+		else if (codePoint < 0x10000) {
+			text.push_back(static_cast<char>(0xe0 | (codePoint >> 12)));
+			text.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+			text.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+		}
+		else {
+			text.push_back(static_cast<char>(0xf0 | (codePoint >> 18)));
+			text.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f)));
+			text.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+			text.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+		}
+	}
+
+	const char* position;
+	const char* end;
+};
+
+const JsonValue* JsonValue::find(const char* key) const {
+	if (type != Type::Object) {
+		return nullptr;
+	}
+
+	for (const auto& member : object) {
+		if (member.first == key) {
+			return &member.second;
+		}
+	}
+
+	return nullptr;
+}
+
+double JsonValue::numberOr(const char* key, double fallback) const {
+	const JsonValue* member = find(key);
+	return member != nullptr && member->isNumber() ? member->number : fallback;
+}
+
+JsonValue parseJson(const char* text, size_t size) {
+	return JsonParser(text, size).parseDocument();
+}
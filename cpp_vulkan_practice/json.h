@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// minimal JSON reader for the glTF importer: the whole document into a tree of JsonValue, numbers as double
+// glTF headers are small (the geometry is in binary buffers), so a DOM is fine here; throws std::runtime_error on malformed input
+
+struct JsonValue {
+	enum class Type { Null, Bool, Number, String, Array, Object };
+
+	Type type = Type::Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> object; // in document order, looked up linearly (glTF objects have a handful of members)
+
+	bool isNumber() const { return type == Type::Number; }
+	bool isString() const { return type == Type::String; }
+	bool isArray() const { return type == Type::Array; }
+	bool isObject() const { return type == Type::Object; }
+
+	const JsonValue* find(const char* key) const; // nullptr if this isn't an object or has no such member
+	double numberOr(const char* key, double fallback) const; // the member if it is a number
+	size_t size() const { return array.size(); } // arrays only
+	const JsonValue& operator[](size_t index) const { return array[index]; }
+};
+
+JsonValue parseJson(const char* text, size_t size);
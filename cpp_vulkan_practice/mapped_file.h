@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// read-only memory mapping of a whole file: the pages are read in by the OS on first touch, no copy into a buffer of our own
+// threads can read different parts of the mapping at the same time, the mapping starts on a page boundary
+
+class MappedFile {
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete; // owns the mapping
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	bool open(const std::string& path); // false if the file is missing, empty or can't be mapped
+	void close(); // pointers into data() are invalid afterwards
+
+	bool isOpen() const { return mapped != nullptr; }
+	const uint8_t* data() const { return mapped; }
+	size_t size() const { return mappedSize; }
+
+private:
+	const uint8_t* mapped = nullptr;
+	size_t mappedSize = 0;
+
+#ifdef _WIN32
+	void* file = nullptr; // HANDLE, kept out of the header so windows.h isn't pulled into every file
+	void* mapping = nullptr;
+#endif
+};
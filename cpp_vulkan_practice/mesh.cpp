@@ -0,0 +1,97 @@
+#include "mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+void GpuMesh::create(GpuAllocator& allocator, VkDevice device, UploadQueue& uploadQueue, const void* vertexData, uint32_t vertexCount, uint32_t vertexStride,
+	const std::vector<uint32_t>& indexData, UploadSubmission& submitted) {
+	this->allocator = &allocator;
+	this->device = device;
+	vertices = vertexCount;
+	indices = static_cast<uint32_t>(indexData.size());
+
+	// 16 bit indices if every vertex can be addressed with them, UINT16_MAX stays free as the primitive restart value
+
+	std::vector<uint16_t> shortIndices;
+	if (vertexCount < UINT16_MAX) {
+		indexType = VK_INDEX_TYPE_UINT16;
+		shortIndices.assign(indexData.begin(), indexData.end());
+	}
+	else {
+		indexType = VK_INDEX_TYPE_UINT32;
+	}
+
+	VkDeviceSize vertexSize = VkDeviceSize(vertexCount) * vertexStride;
+	VkDeviceSize indexSize = indexType == VK_INDEX_TYPE_UINT16 ? shortIndices.size() * sizeof(uint16_t) : indexData.size() * sizeof(uint32_t);
+	indexOffset = (vertexSize + 3) & ~VkDeviceSize(3); // index buffer offsets have to be a multiple of the index size
+
+	VkBufferCreateInfo buffer_info = {};
+	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_info.size = (std::max)(indexOffset + indexSize, VkDeviceSize(4));
+	buffer_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT; // one buffer for both, a single allocation and a single copy
+	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &buffer_info, nullptr, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create mesh buffer.");
+	}
+
+	memory = allocator.allocateBuffer(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT); // only the copy writes it, the CPU never touches it again
+
+	const VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+	uploadQueue.uploadBufferBlocking(buffer, 0, vertexData, vertexSize, dstStage, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, submitted);
+	uploadQueue.uploadBufferBlocking(buffer, indexOffset, indexType == VK_INDEX_TYPE_UINT16 ? static_cast<const void*>(shortIndices.data()) : indexData.data(), indexSize,
+		dstStage, VK_ACCESS_INDEX_READ_BIT, submitted);
+}
+
+void GpuMesh::destroy() {
+	if (buffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkDestroyBuffer(device, buffer, nullptr);
+	allocator->free(memory);
+	buffer = VK_NULL_HANDLE;
+	indices = 0;
+	vertices = 0;
+}
+
+void GpuMesh::bind(VkCommandBuffer commandBuffer, uint32_t binding) const {
+	VkDeviceSize vertexOffset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, binding, 1, &buffer, &vertexOffset); // binds vertex buffers to bindings
+	vkCmdBindIndexBuffer(commandBuffer, buffer, indexOffset, indexType);
+}
+
+MeshData generateSphere(uint32_t rings, uint32_t segments) {
+	const float pi = 3.14159265358979f;
+	MeshData mesh;
+
+	// a grid over latitude and longitude, the seam column is duplicated so the uvs can wrap
+
+	for (uint32_t ring = 0; ring <= rings; ring++) {
+		float theta = pi * ring / rings; // from the north pole down
+
+		for (uint32_t segment = 0; segment <= segments; segment++) {
+			float phi = 2.0f * pi * segment / segments;
+
+			MeshVertex vertex;
+			vertex.normal = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			vertex.position = vertex.normal;
+			vertex.tangent = glm::vec4(-std::sin(phi), 0.0f, std::cos(phi), (segment & 1) ? -1.0f : 1.0f); // direction of increasing u; alternating handedness, so the sign is exercised too
+			vertex.uv = glm::vec2(static_cast<float>(segment) / segments, static_cast<float>(ring) / rings);
+			vertex.color = vertex.normal * 0.5f + 0.5f;
+			mesh.vertices.push_back(vertex);
+		}
+	}
+
+	for (uint32_t ring = 0; ring < rings; ring++) {
+		for (uint32_t segment = 0; segment < segments; segment++) {
+			uint32_t first = ring * (segments + 1) + segment;
+			uint32_t below = first + segments + 1;
+
+			mesh.indices.insert(mesh.indices.end(), { first, below, first + 1, first + 1, below, below + 1 });
+		}
+	}
+
+	return mesh;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "gpu_allocator.h"
+#include "upload_queue.h"
+#include "vertex_layout.h"
+
+// meshes on the CPU: full precision vertices as they come from a file or a generator, quantized before the upload (vertex_quantization.h)
+// meshes on the GPU: vertices and indices in one device local buffer, the indices right behind the vertices
+// filled through the UploadQueue, so both go to the GPU as regions of the same vkCmdCopyBuffer
+// 16 bit indices whenever the vertex count allows it, half the index fetch bandwidth of 32 bit ones
+
+struct MeshVertex { // 60 bytes of floats, never uploaded like this
+	glm::vec3 position;
+	glm::vec3 normal; // unit length
+	glm::vec4 tangent; // xyz unit length and perpendicular to the normal, w the handedness of the bitangent (+1 or -1)
+	glm::vec2 uv;
+	glm::vec3 color; // linear, >= 0
+};
+
+struct MeshData {
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices; // triangle list
+};
+
+MeshData generateSphere(uint32_t rings, uint32_t segments); // unit sphere, every attribute varies over the surface (test data for the quantization report)
+
+class GpuMesh {
+public:
+	// vertexStride: bytes per vertex; the data is staged right away, submitted is extended if the ring has to be submitted (and waited for) to make room
+	void create(GpuAllocator& allocator, VkDevice device, UploadQueue& uploadQueue, const void* vertices, uint32_t vertexCount, uint32_t vertexStride,
+		const std::vector<uint32_t>& indices, UploadSubmission& submitted);
+
+	template <typename VertexType>
+	void create(GpuAllocator& allocator, VkDevice device, UploadQueue& uploadQueue, const std::vector<VertexType>& vertices, const std::vector<uint32_t>& indices, UploadSubmission& submitted) {
+		create(allocator, device, uploadQueue, vertices.data(), static_cast<uint32_t>(vertices.size()), sizeof(VertexType), indices, submitted);
+	}
+
+	void destroy(); // the GPU must be done with the mesh
+
+	void bind(VkCommandBuffer commandBuffer, uint32_t binding = 0) const; // vertex buffer and index buffer
+	uint32_t indexCount() const { return indices; }
+	uint32_t vertexCount() const { return vertices; }
+	VkDeviceSize sizeInBytes() const { return memory.size; }
+	bool valid() const { return buffer != VK_NULL_HANDLE; }
+
+private:
+	GpuAllocator* allocator = nullptr;
+	VkDevice device = VK_NULL_HANDLE;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	GpuAllocation memory;
+	VkDeviceSize indexOffset = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	uint32_t indices = 0;
+	uint32_t vertices = 0;
+};
@@ -0,0 +1,1284 @@
+#include "mesh_importer.h"
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "cpu_profiler.h"
+#include "json.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+const size_t OBJ_MIN_CHUNK_SIZE = 1024 * 1024; // smaller chunks cost more in bookkeeping than they win in parallelism
+const uint32_t OBJ_CHUNKS_PER_THREAD = 4; // lines differ a lot in cost, more chunks than threads keep every worker busy until the end
+const int32_t OBJ_NO_INDEX = INT32_MIN; // a face corner without uv or normal
+const size_t IMPORT_RANGE_SIZE = 64 * 1024; // vertices or indices per task of the parallel passes
+const uint32_t DEDUPLICATE_SHARD_BITS = 8; // 256 shards: plenty to balance the threads, the per-range shard counts stay small
+const uint64_t VERTEX_HASH_SEED = 0x2545f4914f6cdd1dull;
+
+const uint32_t GLB_MAGIC = 0x46546c67; // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4e4f534a;
+const uint32_t GLB_CHUNK_BIN = 0x004e4942;
+const uint32_t GLTF_TRIANGLES = 4;
+
+// runs task(i) for i in [0, count) on the pool, inline without one; returns once all of them are done and rethrows the first exception
+
+template <typename Task>
+static void parallelFor(ThreadPool* threadPool, size_t count, const Task& task) {
+	if (threadPool == nullptr || count <= 1) {
+		for (size_t i = 0; i < count; i++) {
+			task(i);
+		}
+		return;
+	}
+
+	std::vector<std::future<void>> futures;
+	futures.reserve(count);
+
+	for (size_t i = 0; i < count; i++) {
+		futures.push_back(threadPool->submit([&task, i]() { task(i); }));
+	}
+
+	for (auto& future : futures) { // all of them, even if one threw: the tasks reference task
+		future.wait();
+	}
+
+	for (auto& future : futures) {
+		future.get();
+	}
+}
+
+static size_t rangeCount(size_t count) {
+	return (count + IMPORT_RANGE_SIZE - 1) / IMPORT_RANGE_SIZE;
+}
+
+// vertex hash over the bit patterns of the floats, one multiply per float
+// std::hash of glm vectors (glm/gtx/hash.hpp) hashes every float on its own and combines them, several times the work for the same quality
+
+static uint64_t hashFloats(const float* values, size_t count, uint64_t value = VERTEX_HASH_SEED) {
+	for (size_t i = 0; i < count; i++) {
+		uint32_t bits;
+		std::memcpy(&bits, &values[i], sizeof(bits));
+		value = (value ^ bits) * 0x9e3779b97f4a7c15ull;
+		value ^= value >> 29;
+	}
+
+	value ^= value >> 33; // final avalanche (MurmurHash3 fmix64), the shard is taken from the top bits
+	value *= 0xff51afd7ed558ccdull;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ull;
+	value ^= value >> 33;
+	return value;
+}
+
+// deduplication of source items (OBJ face corners, glTF vertices) that make the same vertex
+// Source provides key(item): the vertex as a struct of floats, hashed and compared bitwise (so -0 and 0 are different vertices)
+// the items are bucketed into shards by the top bits of their hash, every shard is deduplicated on its own with an open addressing table
+// the table keeps a copy of every vertex's key: the items of a shard are spread over the whole file, fetching a second key for every compare would miss the cache
+// uniqueIds[item]: the vertex of the item; representatives[vertex]: one item that makes it
+
+template <typename Source>
+static uint32_t deduplicate(const Source& source, size_t itemCount, ThreadPool* threadPool, std::vector<uint32_t>& uniqueIds, std::vector<uint32_t>& representatives) {
+	const size_t shardCount = size_t(1) << DEDUPLICATE_SHARD_BITS;
+	const size_t ranges = rangeCount(itemCount);
+
+	std::vector<uint32_t> hashes(itemCount); // the top 32 bits: the shard in the top bits, the table slot in the low ones
+	std::vector<uint32_t> counts(ranges * shardCount, 0);
+
+	parallelFor(threadPool, ranges, [&](size_t range) {
+		size_t first = range * IMPORT_RANGE_SIZE;
+		size_t last = (std::min)(first + IMPORT_RANGE_SIZE, itemCount);
+		uint32_t* rangeCounts = &counts[range * shardCount];
+
+		for (size_t item = first; item < last; item++) {
+			auto key = source.key(item);
+			hashes[item] = static_cast<uint32_t>(hashFloats(reinterpret_cast<const float*>(&key), sizeof(key) / sizeof(float)) >> 32);
+			rangeCounts[hashes[item] >> (32 - DEDUPLICATE_SHARD_BITS)]++;
+		}
+	});
+
+	// shard-major order; within a shard the items keep their file order, the first item of every vertex becomes its representative
+
+	std::vector<size_t> shardStarts(shardCount + 1, 0);
+	std::vector<size_t> offsets(ranges * shardCount);
+	size_t offset = 0;
+
+	for (size_t shard = 0; shard < shardCount; shard++) {
+		shardStarts[shard] = offset;
+		for (size_t range = 0; range < ranges; range++) {
+			offsets[range * shardCount + shard] = offset;
+			offset += counts[range * shardCount + shard];
+		}
+	}
+	shardStarts[shardCount] = offset;
+
+	std::vector<uint32_t> shardItems(itemCount);
+
+	parallelFor(threadPool, ranges, [&](size_t range) {
+		size_t first = range * IMPORT_RANGE_SIZE;
+		size_t last = (std::min)(first + IMPORT_RANGE_SIZE, itemCount);
+		size_t* rangeOffsets = &offsets[range * shardCount];
+
+		for (size_t item = first; item < last; item++) {
+			shardItems[rangeOffsets[hashes[item] >> (32 - DEDUPLICATE_SHARD_BITS)]++] = static_cast<uint32_t>(item);
+		}
+	});
+
+	uniqueIds.resize(itemCount);
+	std::vector<std::vector<uint32_t>> shardRepresentatives(shardCount);
+
+	parallelFor(threadPool, shardCount, [&](size_t shard) {
+		size_t first = shardStarts[shard];
+		size_t last = shardStarts[shard + 1];
+
+		size_t tableSize = 16;
+		while (tableSize < (last - first) * 2) { // at most half full, short probes
+			tableSize *= 2;
+		}
+
+		const uint32_t EMPTY = UINT32_MAX;
+		std::vector<uint32_t> table(tableSize, EMPTY); // shard-local vertex ids
+		std::vector<uint32_t>& localRepresentatives = shardRepresentatives[shard];
+		std::vector<uint32_t> localHashes;
+		std::vector<decltype(source.key(0))> localKeys;
+		uint32_t mask = static_cast<uint32_t>(tableSize - 1);
+
+		for (size_t i = first; i < last; i++) {
+			uint32_t item = shardItems[i];
+			uint32_t hash = hashes[item];
+			uint32_t slot = hash & mask;
+			auto key = source.key(item);
+
+			while (true) {
+				uint32_t candidate = table[slot];
+
+				if (candidate == EMPTY) {
+					candidate = static_cast<uint32_t>(localRepresentatives.size());
+					localRepresentatives.push_back(item);
+					localHashes.push_back(hash);
+					localKeys.push_back(key);
+					table[slot] = candidate;
+					uniqueIds[item] = candidate;
+					break;
+				}
+
+				if (localHashes[candidate] == hash && std::memcmp(&localKeys[candidate], &key, sizeof(key)) == 0) {
+					uniqueIds[item] = candidate;
+					break;
+				}
+
+				slot = (slot + 1) & mask;
+			}
+		}
+	});
+
+	std::vector<uint32_t> shardBases(shardCount);
+	uint32_t uniqueCount = 0;
+
+	for (size_t shard = 0; shard < shardCount; shard++) {
+		shardBases[shard] = uniqueCount;
+		uniqueCount += static_cast<uint32_t>(shardRepresentatives[shard].size());
+	}
+
+	representatives.resize(uniqueCount);
+
+	parallelFor(threadPool, shardCount, [&](size_t shard) { // shard-local ids to global ones
+		std::copy(shardRepresentatives[shard].begin(), shardRepresentatives[shard].end(), representatives.begin() + shardBases[shard]);
+
+		for (size_t i = shardStarts[shard]; i < shardStarts[shard + 1]; i++) {
+			uniqueIds[shardItems[i]] += shardBases[shard];
+		}
+	});
+
+	return uniqueCount;
+}
+
+// renumbers the vertices in order of first use by the triangles (the shard order above is random), then builds them from their representatives
+// vertices no triangle uses are dropped; Source provides vertex(item)
+
+template <typename Source>
+static MeshData buildMesh(const Source& source, std::vector<uint32_t>&& cornerVertices, uint32_t uniqueCount, const std::vector<uint32_t>& representatives, ThreadPool* threadPool) {
+	std::vector<uint32_t> order(uniqueCount, UINT32_MAX);
+	uint32_t vertexCount = 0;
+
+	for (auto& vertex : cornerVertices) { // inherently sequential, but one pass of cheap integer work
+		if (order[vertex] == UINT32_MAX) {
+			order[vertex] = vertexCount++;
+		}
+		vertex = order[vertex];
+	}
+
+	MeshData mesh;
+	mesh.vertices.resize(vertexCount);
+	mesh.indices = std::move(cornerVertices);
+
+	parallelFor(threadPool, rangeCount(uniqueCount), [&](size_t range) {
+		size_t first = range * IMPORT_RANGE_SIZE;
+		size_t last = (std::min)(first + IMPORT_RANGE_SIZE, static_cast<size_t>(uniqueCount));
+
+		for (size_t vertex = first; vertex < last; vertex++) {
+			if (order[vertex] != UINT32_MAX) {
+				mesh.vertices[order[vertex]] = source.vertex(representatives[vertex]);
+			}
+		}
+	});
+
+	return mesh;
+}
+
+// missing attributes are marked by the parsers: a zero normal, a tangent with w == 0
+
+static void completeVertices(MeshData& mesh, MeshImportStats& stats) {
+	bool missingNormals = false;
+	bool missingTangents = false;
+
+	for (const auto& vertex : mesh.vertices) {
+		missingNormals |= vertex.normal == glm::vec3(0.0f);
+		missingTangents |= vertex.tangent.w == 0.0f;
+	}
+
+	size_t triangleCount = mesh.indices.size() / 3;
+
+	if (missingNormals) { // area weighted face normals, the cross product is twice the area
+		std::vector<glm::vec3> normals(mesh.vertices.size(), glm::vec3(0.0f));
+
+		for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+			const uint32_t* corners = &mesh.indices[triangle * 3];
+			glm::vec3 p0 = mesh.vertices[corners[0]].position;
+			glm::vec3 faceNormal = glm::cross(mesh.vertices[corners[1]].position - p0, mesh.vertices[corners[2]].position - p0);
+
+			for (int i = 0; i < 3; i++) {
+				normals[corners[i]] += faceNormal;
+			}
+		}
+
+		for (size_t i = 0; i < mesh.vertices.size(); i++) {
+			if (mesh.vertices[i].normal == glm::vec3(0.0f)) {
+				float length = glm::length(normals[i]);
+				mesh.vertices[i].normal = length > 0.0f ? normals[i] / length : glm::vec3(0.0f, 0.0f, 1.0f);
+			}
+		}
+
+		stats.generatedNormals = true;
+	}
+
+	if (missingTangents) { // the directions of increasing u and v on every triangle (Lengyel), summed per vertex
+		std::vector<glm::vec3> uDirections(mesh.vertices.size(), glm::vec3(0.0f));
+		std::vector<glm::vec3> vDirections(mesh.vertices.size(), glm::vec3(0.0f));
+
+		for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+			const uint32_t* corners = &mesh.indices[triangle * 3];
+			const MeshVertex& v0 = mesh.vertices[corners[0]];
+			glm::vec3 edge1 = mesh.vertices[corners[1]].position - v0.position;
+			glm::vec3 edge2 = mesh.vertices[corners[2]].position - v0.position;
+			glm::vec2 uv1 = mesh.vertices[corners[1]].uv - v0.uv;
+			glm::vec2 uv2 = mesh.vertices[corners[2]].uv - v0.uv;
+
+			float determinant = uv1.x * uv2.y - uv2.x * uv1.y;
+			if (determinant == 0.0f) { // no uv mapping on this triangle
+				continue;
+			}
+
+			glm::vec3 uDirection = (edge1 * uv2.y - edge2 * uv1.y) / determinant;
+			glm::vec3 vDirection = (edge2 * uv1.x - edge1 * uv2.x) / determinant;
+
+			for (int i = 0; i < 3; i++) {
+				uDirections[corners[i]] += uDirection;
+				vDirections[corners[i]] += vDirection;
+			}
+		}
+
+		for (size_t i = 0; i < mesh.vertices.size(); i++) {
+			MeshVertex& vertex = mesh.vertices[i];
+			if (vertex.tangent.w != 0.0f) {
+				continue;
+			}
+
+			glm::vec3 tangent = uDirections[i] - vertex.normal * glm::dot(vertex.normal, uDirections[i]);
+			float length = glm::length(tangent);
+
+			if (length > 1e-12f) {
+				tangent /= length;
+			}
+			else { // any direction perpendicular to the normal, crossed with the axis it is least aligned with
+				glm::vec3 axis = std::abs(vertex.normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+				tangent = glm::normalize(glm::cross(axis, vertex.normal));
+			}
+
+			vertex.tangent = glm::vec4(tangent, glm::dot(glm::cross(vertex.normal, tangent), vDirections[i]) < 0.0f ? -1.0f : 1.0f);
+		}
+
+		stats.generatedTangents = true;
+	}
+}
+
+// OBJ
+
+struct ObjCorner {
+	int32_t indices[3]; // position, uv, normal; uv and normal OBJ_NO_INDEX if the face has none
+};
+
+struct ObjChunk {
+	const char* begin = nullptr;
+	const char* end = nullptr;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> colors; // empty until the chunk has a vertex with a color, then one per position
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<ObjCorner> corners; // three per triangle
+	std::vector<uint32_t> relativeIndices; // corner * 3 + component of the negative indices: relative to the chunk's own counts until the chunk offsets are known
+};
+
+struct ObjData {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> colors; // empty if no vertex has one
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<ObjCorner> corners;
+};
+
+static const char* skipSpaces(const char* p, const char* end) {
+	while (p != end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+		p++;
+	}
+	return p;
+}
+
+static const char* parseObjFloat(const char* p, const char* end, float& value) {
+	if (p != end && *p == '+') { // from_chars doesn't take a plus sign
+		p++;
+	}
+
+	value = 0.0f;
+	auto result = std::from_chars(p, end, value);
+
+	if (result.ec == std::errc::invalid_argument) {
+		throw std::runtime_error("Invalid number in OBJ file.");
+	}
+
+	return result.ptr; // out of range (denormals): value stays 0
+}
+
+static const char* parseObjIndex(const char* p, const char* end, int32_t& value) {
+	bool negative = p != end && *p == '-';
+	if (negative) {
+		p++;
+	}
+
+	if (p == end || *p < '0' || *p > '9') {
+		throw std::runtime_error("Invalid face index in OBJ file.");
+	}
+
+	int64_t number = 0;
+	while (p != end && *p >= '0' && *p <= '9') {
+		number = number * 10 + (*p - '0');
+		if (number > INT32_MAX) {
+			throw std::runtime_error("Face index out of range in OBJ file.");
+		}
+		p++;
+	}
+
+	value = static_cast<int32_t>(negative ? -number : number);
+	return p;
+}
+
+static size_t parseObjFloats(const char* p, const char* end, float* values, size_t maxCount) { // the numbers up to the end of the line or a comment
+	size_t count = 0;
+
+	while (count < maxCount) {
+		p = skipSpaces(p, end);
+		if (p == end || *p == '#') {
+			break;
+		}
+		p = parseObjFloat(p, end, values[count++]);
+	}
+
+	return count;
+}
+
+static void parseObjFace(const char* p, const char* end, ObjChunk& chunk) {
+	ObjCorner first = {};
+	ObjCorner previous = {};
+	uint32_t firstRelative = 0; // bit per component, see ObjChunk::relativeIndices
+	uint32_t previousRelative = 0;
+	uint32_t cornerCount = 0;
+
+	auto addCorner = [&chunk](const ObjCorner& corner, uint32_t relative) {
+		uint32_t index = static_cast<uint32_t>(chunk.corners.size());
+		chunk.corners.push_back(corner);
+
+		for (uint32_t component = 0; component < 3; component++) {
+			if (relative & (1u << component)) {
+				chunk.relativeIndices.push_back(index * 3 + component);
+			}
+		}
+	};
+
+	while (true) {
+		p = skipSpaces(p, end);
+		if (p == end || *p == '#') {
+			break;
+		}
+
+		// v, v/vt, v//vn or v/vt/vn; 1 based, negative counts back from the last element declared so far
+
+		int32_t values[3] = { 0, 0, 0 };
+		bool present[3] = { true, false, false };
+
+		p = parseObjIndex(p, end, values[0]);
+		for (int component = 1; component < 3 && p != end && *p == '/'; component++) {
+			p++;
+			if (p != end && *p != '/' && *p != ' ' && *p != '\t' && *p != '\r') {
+				p = parseObjIndex(p, end, values[component]);
+				present[component] = true;
+			}
+		}
+
+		ObjCorner corner = {};
+		uint32_t relative = 0;
+		size_t counts[3] = { chunk.positions.size(), chunk.uvs.size(), chunk.normals.size() };
+
+		for (int component = 0; component < 3; component++) {
+			if (!present[component]) {
+				corner.indices[component] = OBJ_NO_INDEX;
+			}
+			else if (values[component] > 0) {
+				corner.indices[component] = values[component] - 1;
+			}
+			else if (values[component] < 0) {
+				corner.indices[component] = static_cast<int32_t>(counts[component]) + values[component]; // may be negative: an element of an earlier chunk
+				relative |= 1u << component;
+			}
+			else {
+				throw std::runtime_error("Face index 0 in OBJ file.");
+			}
+		}
+
+		if (cornerCount == 0) {
+			first = corner;
+			firstRelative = relative;
+		}
+		else if (cornerCount >= 2) { // a fan around the first corner
+			addCorner(first, firstRelative);
+			addCorner(previous, previousRelative);
+			addCorner(corner, relative);
+		}
+
+		previous = corner;
+		previousRelative = relative;
+		cornerCount++;
+	}
+}
+
+static void parseObjChunk(ObjChunk& chunk) {
+	const char* p = chunk.begin;
+	const char* end = chunk.end;
+
+	while (p != end) {
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if (lineEnd == nullptr) {
+			lineEnd = end;
+		}
+
+		p = skipSpaces(p, lineEnd);
+
+		if (lineEnd - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+			float values[7]; // x y z, optionally w, or r g b after x y z (the common extension for colored scans)
+			size_t count = parseObjFloats(p + 2, lineEnd, values, 7);
+
+			if (count < 3) {
+				throw std::runtime_error("OBJ vertex with less than 3 coordinates.");
+			}
+
+			chunk.positions.emplace_back(values[0], values[1], values[2]);
+
+			if (count >= 6) {
+				if (chunk.colors.empty()) {
+					chunk.colors.resize(chunk.positions.size() - 1, glm::vec3(1.0f));
+				}
+				chunk.colors.emplace_back(values[count - 3], values[count - 2], values[count - 1]);
+			}
+			else if (!chunk.colors.empty()) {
+				chunk.colors.emplace_back(1.0f);
+			}
+		}
+		else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t')) {
+			float values[3] = { 0.0f, 0.0f, 0.0f };
+			parseObjFloats(p + 3, lineEnd, values, 3);
+			chunk.uvs.emplace_back(values[0], 1.0f - values[1]); // OBJ has v going up, Vulkan images start at the top
+		}
+		else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+			float values[3] = { 0.0f, 0.0f, 0.0f };
+			parseObjFloats(p + 3, lineEnd, values, 3);
+			glm::vec3 normal(values[0], values[1], values[2]);
+			float length = glm::length(normal);
+			chunk.normals.push_back(length > 0.0f ? normal / length : normal); // a zero normal is treated as missing and generated later
+		}
+		else if (lineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			parseObjFace(p + 2, lineEnd, chunk);
+		}
+		// anything else (comments, o, g, s, usemtl, mtllib, l, p) doesn't contribute to the triangles
+
+		p = lineEnd == end ? end : lineEnd + 1;
+	}
+}
+
+static ObjData parseObj(const char* text, size_t size, ThreadPool* threadPool, uint32_t threadCount, MeshImportStats& stats) {
+	size_t chunkCount = std::clamp(size / OBJ_MIN_CHUNK_SIZE, static_cast<size_t>(1), static_cast<size_t>(threadCount) * OBJ_CHUNKS_PER_THREAD);
+	std::vector<ObjChunk> chunks(chunkCount);
+
+	const char* chunkBegin = text;
+	for (size_t i = 0; i < chunkCount; i++) { // split after a line break near the even split
+		const char* chunkEnd = text + size;
+
+		if (i + 1 < chunkCount) {
+			const char* target = (std::max)(text + size * (i + 1) / chunkCount, chunkBegin);
+			const char* lineEnd = static_cast<const char*>(std::memchr(target, '\n', text + size - target));
+			chunkEnd = lineEnd != nullptr ? lineEnd + 1 : text + size;
+		}
+
+		chunks[i].begin = chunkBegin;
+		chunks[i].end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	stats.chunkCount = static_cast<uint32_t>(chunkCount);
+
+	parallelFor(threadPool, chunkCount, [&chunks](size_t i) {
+		parseObjChunk(chunks[i]);
+	});
+
+	// every chunk's elements start where the ones of the chunks before it end
+
+	std::vector<size_t> positionBases(chunkCount), uvBases(chunkCount), normalBases(chunkCount), cornerBases(chunkCount);
+	size_t positionCount = 0, uvCount = 0, normalCount = 0, cornerCount = 0;
+	bool hasColors = false;
+
+	for (size_t i = 0; i < chunkCount; i++) {
+		positionBases[i] = positionCount;
+		uvBases[i] = uvCount;
+		normalBases[i] = normalCount;
+		cornerBases[i] = cornerCount;
+		positionCount += chunks[i].positions.size();
+		uvCount += chunks[i].uvs.size();
+		normalCount += chunks[i].normals.size();
+		cornerCount += chunks[i].corners.size();
+		hasColors |= !chunks[i].colors.empty();
+	}
+
+	if (positionCount >= INT32_MAX || uvCount >= INT32_MAX || normalCount >= INT32_MAX || cornerCount >= UINT32_MAX) {
+		throw std::runtime_error("OBJ file is too large.");
+	}
+
+	ObjData obj;
+	obj.positions.resize(positionCount);
+	obj.colors.resize(hasColors ? positionCount : 0);
+	obj.uvs.resize(uvCount);
+	obj.normals.resize(normalCount);
+	obj.corners.resize(cornerCount);
+
+	parallelFor(threadPool, chunkCount, [&](size_t i) {
+		ObjChunk& chunk = chunks[i];
+
+		std::copy(chunk.positions.begin(), chunk.positions.end(), obj.positions.begin() + positionBases[i]);
+		std::copy(chunk.uvs.begin(), chunk.uvs.end(), obj.uvs.begin() + uvBases[i]);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), obj.normals.begin() + normalBases[i]);
+
+		if (hasColors) {
+			if (chunk.colors.empty()) {
+				std::fill(obj.colors.begin() + positionBases[i], obj.colors.begin() + positionBases[i] + chunk.positions.size(), glm::vec3(1.0f));
+			}
+			else {
+				std::copy(chunk.colors.begin(), chunk.colors.end(), obj.colors.begin() + positionBases[i]);
+			}
+		}
+
+		int32_t bases[3] = { static_cast<int32_t>(positionBases[i]), static_cast<int32_t>(uvBases[i]), static_cast<int32_t>(normalBases[i]) };
+
+		for (uint32_t relative : chunk.relativeIndices) {
+			chunk.corners[relative / 3].indices[relative % 3] += bases[relative % 3];
+		}
+
+		int32_t counts[3] = { static_cast<int32_t>(positionCount), static_cast<int32_t>(uvCount), static_cast<int32_t>(normalCount) };
+
+		for (const auto& corner : chunk.corners) {
+			for (int component = 0; component < 3; component++) {
+				int32_t index = corner.indices[component];
+				if (index != OBJ_NO_INDEX && (index < 0 || index >= counts[component])) {
+					throw std::runtime_error("OBJ face refers to an element that doesn't exist.");
+				}
+			}
+		}
+
+		std::copy(chunk.corners.begin(), chunk.corners.end(), obj.corners.begin() + cornerBases[i]);
+		chunk = ObjChunk(); // its memory is no longer needed
+	});
+
+	return obj;
+}
+
+struct ObjVertexKey { // the vertex as it will be, without the generated tangent
+	glm::vec3 position;
+	glm::vec3 color;
+	glm::vec2 uv;
+	glm::vec3 normal; // zero: generated
+};
+
+struct ObjCornerSource {
+	const ObjData& obj;
+
+	ObjVertexKey key(size_t item) const {
+		const int32_t* indices = obj.corners[item].indices;
+
+		ObjVertexKey key;
+		key.position = obj.positions[indices[0]];
+		key.color = obj.colors.empty() ? glm::vec3(1.0f) : obj.colors[indices[0]];
+		key.uv = indices[1] != OBJ_NO_INDEX ? obj.uvs[indices[1]] : glm::vec2(0.0f);
+		key.normal = indices[2] != OBJ_NO_INDEX ? obj.normals[indices[2]] : glm::vec3(0.0f);
+		return key;
+	}
+
+	MeshVertex vertex(size_t item) const {
+		ObjVertexKey values = key(item);
+
+		MeshVertex vertex;
+		vertex.position = values.position;
+		vertex.normal = values.normal;
+		vertex.tangent = glm::vec4(0.0f); // generated
+		vertex.uv = values.uv;
+		vertex.color = values.color;
+		return vertex;
+	}
+};
+
+static_assert(sizeof(ObjVertexKey) == 11 * sizeof(float), "Vertex keys are hashed and compared as floats, they must not have padding.");
+
+static MeshData importObj(const MappedFile& file, ThreadPool* threadPool, uint32_t threadCount, MeshImportStats& stats) {
+	auto parseStart = std::chrono::steady_clock::now();
+	ObjData obj;
+	{
+		CPU_PROFILE_SCOPE("parse obj");
+		obj = parseObj(reinterpret_cast<const char*>(file.data()), file.size(), threadPool, threadCount, stats);
+	}
+	stats.parseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - parseStart).count();
+
+	auto deduplicateStart = std::chrono::steady_clock::now();
+	ObjCornerSource source{ obj };
+	std::vector<uint32_t> cornerVertices;
+	std::vector<uint32_t> representatives;
+	uint32_t uniqueCount;
+	{
+		CPU_PROFILE_SCOPE("deduplicate vertices");
+		uniqueCount = deduplicate(source, obj.corners.size(), threadPool, cornerVertices, representatives);
+	}
+	stats.deduplicateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - deduplicateStart).count();
+	stats.sourceVertexCount = obj.corners.size();
+
+	auto finishStart = std::chrono::steady_clock::now();
+	MeshData mesh = buildMesh(source, std::move(cornerVertices), uniqueCount, representatives, threadPool);
+	stats.finishMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - finishStart).count();
+	return mesh;
+}
+
+// glTF
+
+struct GltfBuffer {
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+};
+
+struct GltfAccessor { // data == nullptr: the attribute is missing
+	const uint8_t* data = nullptr; // first element
+	size_t stride = 0;
+	size_t count = 0;
+	uint32_t componentType = 0;
+	uint32_t componentCount = 0;
+	bool normalized = false;
+
+	glm::vec4 read(size_t index, glm::vec4 value = glm::vec4(0.0f)) const { // the components the accessor doesn't have keep the ones of value
+		const uint8_t* element = data + index * stride;
+
+		for (uint32_t i = 0; i < componentCount; i++) {
+			switch (componentType) {
+			case 5126: { float component; std::memcpy(&component, element + i * 4, 4); value[i] = component; break; } // FLOAT
+			case 5121: value[i] = normalized ? element[i] / 255.0f : element[i]; break; // UNSIGNED_BYTE
+			case 5120: { int8_t component = static_cast<int8_t>(element[i]); value[i] = normalized ? (std::max)(component / 127.0f, -1.0f) : component; break; } // BYTE
+			case 5123: { uint16_t component; std::memcpy(&component, element + i * 2, 2); value[i] = normalized ? component / 65535.0f : component; break; } // UNSIGNED_SHORT
+			case 5122: { int16_t component; std::memcpy(&component, element + i * 2, 2); value[i] = normalized ? (std::max)(component / 32767.0f, -1.0f) : component; break; } // SHORT
+			case 5125: { uint32_t component; std::memcpy(&component, element + i * 4, 4); value[i] = static_cast<float>(component); break; } // UNSIGNED_INT
+			}
+		}
+
+		return value;
+	}
+
+	uint32_t readIndex(size_t index) const {
+		const uint8_t* element = data + index * stride;
+
+		switch (componentType) {
+		case 5121: return element[0];
+		case 5123: { uint16_t value; std::memcpy(&value, element, 2); return value; }
+		default: { uint32_t value; std::memcpy(&value, element, 4); return value; }
+		}
+	}
+};
+
+struct GltfPrimitive {
+	GltfAccessor positions;
+	GltfAccessor normals;
+	GltfAccessor tangents;
+	GltfAccessor uvs;
+	GltfAccessor colors;
+	GltfAccessor indices; // missing: not indexed
+	glm::mat4 transform = glm::mat4(1.0f);
+	glm::mat3 normalTransform = glm::mat3(1.0f);
+	bool mirrored = false; // negative determinant: the winding and the bitangent sign flip
+	size_t vertexBase = 0;
+	size_t indexBase = 0;
+	size_t indexCount = 0;
+};
+
+struct GltfDocument {
+	MappedFile file;
+	JsonValue json;
+	std::vector<GltfBuffer> buffers;
+	std::vector<std::unique_ptr<MappedFile>> externalFiles;
+	std::vector<std::vector<uint8_t>> decodedBuffers; // data: URIs
+};
+
+static const JsonValue& gltfElement(const JsonValue& json, const char* array, size_t index) {
+	const JsonValue* elements = json.find(array);
+	if (elements == nullptr || !elements->isArray() || index >= elements->size()) {
+		throw std::runtime_error(std::string("glTF refers to a missing element of ") + array + ".");
+	}
+	return (*elements)[index];
+}
+
+static size_t gltfIndex(const JsonValue& object, const char* key) { // SIZE_MAX if the member is missing
+	const JsonValue* member = object.find(key);
+	if (member == nullptr) {
+		return SIZE_MAX;
+	}
+	if (!member->isNumber() || member->number < 0.0) {
+		throw std::runtime_error(std::string("Invalid glTF index: ") + key + ".");
+	}
+	return static_cast<size_t>(member->number);
+}
+
+static std::vector<uint8_t> decodeBase64(const char* text, size_t size) {
+	std::vector<uint8_t> bytes;
+	bytes.reserve(size / 4 * 3);
+
+	uint32_t bits = 0;
+	int bitCount = 0;
+
+	for (size_t i = 0; i < size && text[i] != '='; i++) {
+		char c = text[i];
+		uint32_t value;
+
+		if (c >= 'A' && c <= 'Z') value = c - 'A';
+		else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+		else if (c >= '0' && c <= '9') value = c - '0' + 52;
+		else if (c == '+') value = 62;
+		else if (c == '/') value = 63;
+		else throw std::runtime_error("Invalid base64 data in glTF buffer.");
+
+		bits = (bits << 6) | value;
+		bitCount += 6;
+
+		if (bitCount >= 8) {
+			bitCount -= 8;
+			bytes.push_back(static_cast<uint8_t>(bits >> bitCount));
+		}
+	}
+
+	return bytes;
+}
+
+static std::string decodeUri(const std::string& uri) { // %XX escapes, e.g. spaces in file names
+	std::string result;
+
+	for (size_t i = 0; i < uri.size(); i++) {
+		if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) && std::isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+			result.push_back(static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+			i += 2;
+		}
+		else {
+			result.push_back(uri[i]);
+		}
+	}
+
+	return result;
+}
+
+static void loadGltfDocument(const std::string& path, bool binary, GltfDocument& document) {
+	const uint8_t* data = document.file.data();
+	size_t size = document.file.size();
+	GltfBuffer binaryChunk;
+
+	if (binary) { // 12 byte header, then chunks of { length, type, data }: JSON first, optionally BIN
+		uint32_t header[5];
+		if (size < sizeof(header)) {
+			throw std::runtime_error("GLB file is too small.");
+		}
+		std::memcpy(header, data, sizeof(header));
+
+		if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > size || header[2] < sizeof(header) || header[4] != GLB_CHUNK_JSON || header[3] > header[2] - sizeof(header)) {
+			throw std::runtime_error("Invalid GLB header.");
+		}
+
+		document.json = parseJson(reinterpret_cast<const char*>(data + sizeof(header)), header[3]);
+
+		size_t binOffset = sizeof(header) + ((header[3] + 3) & ~3u); // chunks are 4 byte aligned
+		if (binOffset + 8 <= header[2]) {
+			uint32_t chunk[2];
+			std::memcpy(chunk, data + binOffset, sizeof(chunk));
+
+			if (chunk[1] == GLB_CHUNK_BIN && chunk[0] <= header[2] - binOffset - 8) {
+				binaryChunk.data = data + binOffset + 8;
+				binaryChunk.size = chunk[0];
+			}
+		}
+	}
+	else {
+		document.json = parseJson(reinterpret_cast<const char*>(data), size);
+	}
+
+	const JsonValue* buffers = document.json.find("buffers");
+	if (buffers == nullptr || !buffers->isArray()) {
+		return;
+	}
+
+	std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+	for (size_t i = 0; i < buffers->size(); i++) {
+		const JsonValue& buffer = (*buffers)[i];
+		const JsonValue* uri = buffer.find("uri");
+		size_t byteLength = static_cast<size_t>(buffer.numberOr("byteLength", 0.0));
+		GltfBuffer loaded;
+
+		if (uri == nullptr || !uri->isString()) { // the GLB's own BIN chunk
+			if (i != 0 || binaryChunk.data == nullptr) {
+				throw std::runtime_error("glTF buffer without data.");
+			}
+			loaded = binaryChunk;
+		}
+		else if (uri->string.compare(0, 5, "data:") == 0) {
+			size_t comma = uri->string.find(',');
+			if (comma == std::string::npos || uri->string.find(";base64") > comma) {
+				throw std::runtime_error("Only base64 data URIs are supported in glTF buffers.");
+			}
+
+			document.decodedBuffers.push_back(decodeBase64(uri->string.data() + comma + 1, uri->string.size() - comma - 1));
+			loaded.data = document.decodedBuffers.back().data();
+			loaded.size = document.decodedBuffers.back().size();
+		}
+		else {
+			auto external = std::make_unique<MappedFile>();
+			std::string bufferPath = (directory / decodeUri(uri->string)).string();
+
+			if (!external->open(bufferPath)) {
+				throw std::runtime_error("Failed to open glTF buffer " + bufferPath + ".");
+			}
+
+			loaded.data = external->data();
+			loaded.size = external->size();
+			document.externalFiles.push_back(std::move(external));
+		}
+
+		if (loaded.size < byteLength) {
+			throw std::runtime_error("glTF buffer is shorter than its byteLength.");
+		}
+
+		document.buffers.push_back(loaded);
+	}
+}
+
+static GltfAccessor gltfAccessor(const GltfDocument& document, size_t index) {
+	const JsonValue& accessor = gltfElement(document.json, "accessors", index);
+
+	if (accessor.find("sparse") != nullptr) {
+		throw std::runtime_error("Sparse glTF accessors are not supported.");
+	}
+
+	size_t viewIndex = gltfIndex(accessor, "bufferView");
+	if (viewIndex == SIZE_MAX) {
+		throw std::runtime_error("glTF accessors without a buffer view are not supported.");
+	}
+
+	const JsonValue& view = gltfElement(document.json, "bufferViews", viewIndex);
+	size_t bufferIndex = gltfIndex(view, "buffer");
+	if (bufferIndex >= document.buffers.size()) {
+		throw std::runtime_error("glTF buffer view refers to a missing buffer.");
+	}
+
+	GltfAccessor result;
+	result.componentType = static_cast<uint32_t>(accessor.numberOr("componentType", 0.0));
+	result.count = static_cast<size_t>(accessor.numberOr("count", 0.0));
+	const JsonValue* normalized = accessor.find("normalized");
+	result.normalized = normalized != nullptr && normalized->boolean;
+
+	const JsonValue* type = accessor.find("type");
+	std::string typeName = type != nullptr && type->isString() ? type->string : "";
+	result.componentCount = typeName == "SCALAR" ? 1 : typeName == "VEC2" ? 2 : typeName == "VEC3" ? 3 : typeName == "VEC4" ? 4 : 0;
+
+	size_t componentSize = result.componentType == 5120 || result.componentType == 5121 ? 1 : result.componentType == 5122 || result.componentType == 5123 ? 2 : result.componentType == 5125 || result.componentType == 5126 ? 4 : 0;
+	if (result.componentCount == 0 || componentSize == 0) {
+		throw std::runtime_error("Unsupported glTF accessor type.");
+	}
+
+	size_t elementSize = componentSize * result.componentCount;
+	size_t viewOffset = static_cast<size_t>(view.numberOr("byteOffset", 0.0));
+	size_t viewLength = static_cast<size_t>(view.numberOr("byteLength", 0.0));
+	size_t accessorOffset = static_cast<size_t>(accessor.numberOr("byteOffset", 0.0));
+	result.stride = static_cast<size_t>(view.numberOr("byteStride", static_cast<double>(elementSize)));
+
+	const GltfBuffer& buffer = document.buffers[bufferIndex];
+
+	if (viewOffset + viewLength > buffer.size || result.stride < elementSize
+		|| (result.count > 0 && accessorOffset + (result.count - 1) * result.stride + elementSize > viewLength)) {
+		throw std::runtime_error("glTF accessor is out of bounds of its buffer.");
+	}
+
+	result.data = buffer.data + viewOffset + accessorOffset;
+	return result;
+}
+
+// what the glTF spec allows for a vertex attribute: componentCounts of FLOAT, or of normalized UNSIGNED_BYTE / UNSIGNED_SHORT where normalizedIntegers; one element per vertex
+// read() trusts the accessor's type and count, so anything else has to be caught here
+static void checkGltfAttribute(const GltfAccessor& accessor, const char* name, uint32_t minComponents, uint32_t maxComponents, bool normalizedIntegers, size_t vertexCount) {
+	if (accessor.data == nullptr) {
+		return;
+	}
+
+	bool floats = accessor.componentType == 5126;
+	bool integers = normalizedIntegers && accessor.normalized && (accessor.componentType == 5121 || accessor.componentType == 5123);
+
+	if (accessor.componentCount < minComponents || accessor.componentCount > maxComponents || (!floats && !integers)) {
+		throw std::runtime_error("Invalid glTF " + std::string(name) + " accessor type.");
+	}
+	if (accessor.count != vertexCount) {
+		throw std::runtime_error("glTF " + std::string(name) + " accessor count doesn't match the POSITION count.");
+	}
+}
+
+static glm::mat4 gltfNodeTransform(const JsonValue& node) {
+	const JsonValue* matrix = node.find("matrix");
+	if (matrix != nullptr && matrix->isArray() && matrix->size() == 16) {
+		float values[16];
+		for (size_t i = 0; i < 16; i++) {
+			values[i] = static_cast<float>((*matrix)[i].number);
+		}
+		return glm::make_mat4(values); // column major, as glTF stores it
+	}
+
+	auto vector = [&node](const char* key, glm::vec4 value, size_t size) {
+		const JsonValue* member = node.find(key);
+		if (member != nullptr && member->isArray() && member->size() == size) {
+			for (size_t i = 0; i < size; i++) {
+				value[static_cast<int>(i)] = static_cast<float>((*member)[i].number);
+			}
+		}
+		return value;
+	};
+
+	glm::vec4 translation = vector("translation", glm::vec4(0.0f), 3);
+	glm::vec4 rotation = vector("rotation", glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), 4); // x y z w
+	glm::vec4 scale = vector("scale", glm::vec4(1.0f), 3);
+
+	return glm::translate(glm::mat4(1.0f), glm::vec3(translation)) * glm::mat4_cast(glm::quat(rotation.w, rotation.x, rotation.y, rotation.z)) * glm::scale(glm::mat4(1.0f), glm::vec3(scale));
+}
+
+static void collectGltfInstances(const JsonValue& json, size_t nodeIndex, const glm::mat4& parent, size_t depth, std::vector<std::pair<size_t, glm::mat4>>& instances) {
+	const JsonValue* nodes = json.find("nodes");
+	if (depth > nodes->size()) {
+		throw std::runtime_error("glTF node hierarchy has a cycle.");
+	}
+
+	const JsonValue& node = gltfElement(json, "nodes", nodeIndex);
+	glm::mat4 transform = parent * gltfNodeTransform(node);
+
+	size_t mesh = gltfIndex(node, "mesh");
+	if (mesh != SIZE_MAX) {
+		instances.emplace_back(mesh, transform);
+	}
+
+	const JsonValue* children = node.find("children");
+	if (children != nullptr && children->isArray()) {
+		for (const auto& child : children->array) {
+			collectGltfInstances(json, static_cast<size_t>(child.number), transform, depth + 1, instances);
+		}
+	}
+}
+
+struct GltfVertexSource {
+	const std::vector<MeshVertex>& vertices;
+
+	MeshVertex key(size_t item) const {
+		return vertices[item];
+	}
+
+	MeshVertex vertex(size_t item) const {
+		return vertices[item];
+	}
+};
+
+static_assert(sizeof(MeshVertex) == 15 * sizeof(float), "Vertex keys are hashed and compared as floats, they must not have padding.");
+
+static MeshData importGltf(const std::string& path, bool binary, GltfDocument& document, ThreadPool* threadPool, MeshImportStats& stats) {
+	auto parseStart = std::chrono::steady_clock::now();
+	loadGltfDocument(path, binary, document);
+	const JsonValue& json = document.json;
+
+	// the mesh instances: the nodes of the default scene, or every mesh once if the file has no scene
+
+	std::vector<std::pair<size_t, glm::mat4>> instances;
+	const JsonValue* scenes = json.find("scenes");
+
+	if (scenes != nullptr && scenes->isArray() && scenes->size() > 0 && json.find("nodes") != nullptr) {
+		size_t sceneIndex = gltfIndex(json, "scene");
+		const JsonValue& scene = gltfElement(json, "scenes", sceneIndex == SIZE_MAX ? 0 : sceneIndex);
+		const JsonValue* roots = scene.find("nodes");
+
+		if (roots != nullptr && roots->isArray()) {
+			for (const auto& root : roots->array) {
+				collectGltfInstances(json, static_cast<size_t>(root.number), glm::mat4(1.0f), 0, instances);
+			}
+		}
+	}
+	else if (const JsonValue* meshes = json.find("meshes"); meshes != nullptr && meshes->isArray()) {
+		for (size_t mesh = 0; mesh < meshes->size(); mesh++) {
+			instances.emplace_back(mesh, glm::mat4(1.0f));
+		}
+	}
+
+	std::vector<GltfPrimitive> primitives;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+
+	for (const auto& instance : instances) {
+		const JsonValue& mesh = gltfElement(json, "meshes", instance.first);
+		const JsonValue* meshPrimitives = mesh.find("primitives");
+		if (meshPrimitives == nullptr || !meshPrimitives->isArray()) {
+			continue;
+		}
+
+		for (const auto& meshPrimitive : meshPrimitives->array) {
+			const JsonValue* attributes = meshPrimitive.find("attributes");
+
+			if (static_cast<uint32_t>(meshPrimitive.numberOr("mode", GLTF_TRIANGLES)) != GLTF_TRIANGLES || attributes == nullptr || attributes->find("POSITION") == nullptr) {
+				stats.skippedPrimitives++;
+				continue;
+			}
+
+			GltfPrimitive primitive;
+			auto attribute = [&](const char* name) {
+				size_t index = gltfIndex(*attributes, name);
+				return index != SIZE_MAX ? gltfAccessor(document, index) : GltfAccessor();
+			};
+
+			primitive.positions = attribute("POSITION");
+			primitive.normals = attribute("NORMAL");
+			primitive.tangents = attribute("TANGENT");
+			primitive.uvs = attribute("TEXCOORD_0");
+			primitive.colors = attribute("COLOR_0");
+
+			checkGltfAttribute(primitive.positions, "POSITION", 3, 3, false, primitive.positions.count);
+			checkGltfAttribute(primitive.normals, "NORMAL", 3, 3, false, primitive.positions.count);
+			checkGltfAttribute(primitive.tangents, "TANGENT", 4, 4, false, primitive.positions.count);
+			checkGltfAttribute(primitive.uvs, "TEXCOORD_0", 2, 2, true, primitive.positions.count);
+			checkGltfAttribute(primitive.colors, "COLOR_0", 3, 4, true, primitive.positions.count);
+
+			size_t indices = gltfIndex(meshPrimitive, "indices");
+			if (indices != SIZE_MAX) {
+				primitive.indices = gltfAccessor(document, indices);
+				if (primitive.indices.componentCount != 1 || (primitive.indices.componentType != 5121 && primitive.indices.componentType != 5123 && primitive.indices.componentType != 5125)) {
+					throw std::runtime_error("Invalid glTF index accessor.");
+				}
+			}
+
+			primitive.transform = instance.second;
+			primitive.normalTransform = glm::inverseTranspose(glm::mat3(instance.second));
+			primitive.mirrored = glm::determinant(glm::mat3(instance.second)) < 0.0f;
+			primitive.vertexBase = vertexCount;
+			primitive.indexBase = indexCount;
+			primitive.indexCount = (primitive.indices.data != nullptr ? primitive.indices.count : primitive.positions.count) / 3 * 3;
+
+			vertexCount += primitive.positions.count;
+			indexCount += primitive.indexCount;
+			primitives.push_back(primitive);
+		}
+	}
+
+	if (vertexCount >= UINT32_MAX || indexCount >= UINT32_MAX) {
+		throw std::runtime_error("glTF file is too large.");
+	}
+
+	// ranges of every primitive's vertices and indices, converted in parallel
+
+	struct Range {
+		const GltfPrimitive* primitive;
+		bool indices;
+		size_t first;
+		size_t count;
+	};
+
+	std::vector<Range> ranges;
+	for (const auto& primitive : primitives) {
+		for (size_t first = 0; first < primitive.positions.count; first += IMPORT_RANGE_SIZE) {
+			ranges.push_back({ &primitive, false, first, (std::min)(IMPORT_RANGE_SIZE, primitive.positions.count - first) });
+		}
+		for (size_t first = 0; first < primitive.indexCount; first += IMPORT_RANGE_SIZE / 3 * 3) { // whole triangles
+			ranges.push_back({ &primitive, true, first, (std::min)(IMPORT_RANGE_SIZE / 3 * 3, primitive.indexCount - first) });
+		}
+	}
+
+	stats.chunkCount = static_cast<uint32_t>(ranges.size());
+
+	std::vector<MeshVertex> vertices(vertexCount);
+	std::vector<uint32_t> sourceIndices(indexCount);
+
+	parallelFor(threadPool, ranges.size(), [&](size_t i) {
+		const Range& range = ranges[i];
+		const GltfPrimitive& primitive = *range.primitive;
+
+		if (range.indices) {
+			for (size_t index = range.first; index < range.first + range.count; index++) {
+				size_t source = index;
+				if (primitive.mirrored && index % 3 != 0) { // swap the second and third corner
+					source = index % 3 == 1 ? index + 1 : index - 1;
+				}
+
+				size_t vertex = primitive.indices.data != nullptr ? primitive.indices.readIndex(source) : source;
+				if (vertex >= primitive.positions.count) {
+					throw std::runtime_error("glTF index refers to a vertex that doesn't exist.");
+				}
+
+				sourceIndices[primitive.indexBase + index] = static_cast<uint32_t>(primitive.vertexBase + vertex);
+			}
+			return;
+		}
+
+		for (size_t index = range.first; index < range.first + range.count; index++) {
+			MeshVertex& vertex = vertices[primitive.vertexBase + index];
+			vertex.position = glm::vec3(primitive.transform * glm::vec4(glm::vec3(primitive.positions.read(index)), 1.0f));
+			vertex.normal = glm::vec3(0.0f); // missing, generated
+			vertex.tangent = glm::vec4(0.0f);
+			vertex.uv = glm::vec2(0.0f);
+			vertex.color = glm::vec3(1.0f);
+
+			if (primitive.normals.data != nullptr) {
+				glm::vec3 normal = primitive.normalTransform * glm::vec3(primitive.normals.read(index));
+				float length = glm::length(normal);
+				vertex.normal = length > 0.0f ? normal / length : normal;
+			}
+
+			if (primitive.tangents.data != nullptr) {
+				glm::vec4 tangent = primitive.tangents.read(index, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+				glm::vec3 direction = glm::mat3(primitive.transform) * glm::vec3(tangent);
+				float length = glm::length(direction);
+
+				if (length > 0.0f) {
+					vertex.tangent = glm::vec4(direction / length, (tangent.w < 0.0f) != primitive.mirrored ? -1.0f : 1.0f);
+				}
+			}
+
+			if (primitive.uvs.data != nullptr) {
+				vertex.uv = glm::vec2(primitive.uvs.read(index));
+			}
+
+			if (primitive.colors.data != nullptr) {
+				vertex.color = glm::vec3(primitive.colors.read(index, glm::vec4(1.0f)));
+			}
+		}
+	});
+
+	stats.parseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - parseStart).count();
+
+	// glTF is indexed already, but exporters often split vertices that are equal (per-face attributes that turned out the same, merged meshes)
+
+	auto deduplicateStart = std::chrono::steady_clock::now();
+	GltfVertexSource source{ vertices };
+	std::vector<uint32_t> uniqueIds;
+	std::vector<uint32_t> representatives;
+	uint32_t uniqueCount;
+	{
+		CPU_PROFILE_SCOPE("deduplicate vertices");
+		uniqueCount = deduplicate(source, vertices.size(), threadPool, uniqueIds, representatives);
+
+		parallelFor(threadPool, rangeCount(indexCount), [&](size_t range) { // the indices to the deduplicated vertices
+			size_t first = range * IMPORT_RANGE_SIZE;
+			size_t last = (std::min)(first + IMPORT_RANGE_SIZE, indexCount);
+
+			for (size_t index = first; index < last; index++) {
+				sourceIndices[index] = uniqueIds[sourceIndices[index]];
+			}
+		});
+	}
+	stats.deduplicateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - deduplicateStart).count();
+	stats.sourceVertexCount = vertexCount;
+
+	auto finishStart = std::chrono::steady_clock::now();
+	MeshData mesh = buildMesh(source, std::move(sourceIndices), uniqueCount, representatives, threadPool);
+	stats.finishMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - finishStart).count();
+	return mesh;
+}
+
+MeshData importMesh(const std::string& path, uint32_t threadCount, MeshImportStats* stats) {
+	CPU_PROFILE_SCOPE("import mesh");
+	auto importStart = std::chrono::steady_clock::now();
+
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	if (extension != ".obj" && extension != ".gltf" && extension != ".glb") {
+		throw std::runtime_error("Unsupported mesh format: " + path + " (OBJ, glTF and GLB are supported).");
+	}
+
+	GltfDocument document; // keeps the mappings alive until the vertices are built
+	if (!document.file.open(path)) {
+		throw std::runtime_error("Failed to open mesh file " + path + ".");
+	}
+
+	if (threadCount == 0) {
+		threadCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+	}
+
+	std::unique_ptr<ThreadPool> threadPool = threadCount > 1 ? std::make_unique<ThreadPool>(threadCount) : nullptr;
+
+	MeshImportStats importStats;
+	importStats.fileBytes = document.file.size();
+	importStats.threadCount = threadCount;
+
+	MeshData mesh = extension == ".obj" ? importObj(document.file, threadPool.get(), threadCount, importStats) : importGltf(path, extension == ".glb", document, threadPool.get(), importStats);
+
+	auto finishStart = std::chrono::steady_clock::now();
+	completeVertices(mesh, importStats);
+	importStats.finishMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - finishStart).count();
+
+	importStats.triangleCount = mesh.indices.size() / 3;
+	importStats.vertexCount = mesh.vertices.size();
+	importStats.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - importStart).count();
+
+	if (mesh.indices.empty()) {
+		throw std::runtime_error("Mesh file " + path + " has no triangles.");
+	}
+
+	if (stats != nullptr) {
+		*stats = importStats;
+	}
+
+	return mesh;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "mesh.h"
+
+// mesh import: Wavefront OBJ, glTF 2.0 (.gltf with external or data: buffers) and binary glTF (.glb) into one MeshData, ready for quantizeMesh
+//
+// - the file is memory mapped, nothing is read into a buffer first
+// - OBJ: the text is split into chunks at line boundaries and the chunks are parsed in parallel; negative (relative) indices are resolved
+//   once every chunk knows how many elements the chunks before it declared
+// - glTF: the accessors of every primitive instance are converted in parallel ranges, node transforms applied (the default scene, or every mesh once)
+// - vertices are deduplicated on their attribute values in parallel: the vertices are split into shards by hash, each shard has its own hash table
+//   the output vertices are in order of first use by the indices, as the file had them
+// - missing normals are generated from the faces, missing tangents from the uvs (any perpendicular direction without uvs)
+// - only triangles: OBJ polygons are triangulated as fans, glTF primitives other than triangle lists are skipped and counted
+
+struct MeshImportStats {
+	size_t fileBytes = 0; // the main file, not the external glTF buffers
+	uint32_t threadCount = 0;
+	uint32_t chunkCount = 0; // units of parallel work in the parse
+	uint64_t triangleCount = 0;
+	uint64_t sourceVertexCount = 0; // before deduplication: OBJ face corners, glTF accessor vertices
+	uint64_t vertexCount = 0;
+	uint32_t skippedPrimitives = 0; // glTF points, lines and strips
+	bool generatedNormals = false;
+	bool generatedTangents = false;
+	double parseMs = 0.0;
+	double deduplicateMs = 0.0;
+	double finishMs = 0.0; // first use order, generated normals and tangents
+	double totalMs = 0.0;
+};
+
+// by extension (.obj, .gltf, .glb, any case); threadCount 0: one per hardware thread; throws std::runtime_error if the file can't be read or is malformed
+MeshData importMesh(const std::string& path, uint32_t threadCount = 0, MeshImportStats* stats = nullptr);
@@ -0,0 +1,479 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include "cpu_profiler.h"
+#include "vertex_quantization.h"
+
+const uint32_t NO_VERTEX = UINT32_MAX;
+const uint32_t VERTEX_FETCH_CACHE_BYTES = 16 * 1024;
+const uint32_t VERTEX_FETCH_LINE_BYTES = 64;
+const uint32_t OVERDRAW_GRID_SIZE = 256; // pixels per side of each view
+
+// FIFO post-transform cache with time stamps: a miss stamps the vertex and advances the time, so a vertex is still cached while fewer than cacheSize misses came after it
+// starting the time at cacheSize + 1 (or advancing it by that much) makes every stamp of 0 (or older) a miss
+
+struct VertexCacheModel {
+	VertexCacheModel(size_t vertexCount, uint32_t cacheSize) : stamps(vertexCount, 0), time(cacheSize + 1), cacheSize(cacheSize) {}
+
+	bool cached(uint32_t vertex) const {
+		return time - stamps[vertex] <= cacheSize;
+	}
+
+	bool access(uint32_t vertex) { // true on a miss
+		if (cached(vertex)) {
+			return false;
+		}
+
+		stamps[vertex] = time++;
+		return true;
+	}
+
+	uint32_t accessTriangle(const uint32_t* triangle) { // misses
+		return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+	}
+
+	void flush() {
+		time += cacheSize + 1;
+	}
+
+	std::vector<uint32_t> stamps;
+	uint32_t time;
+	uint32_t cacheSize;
+};
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+	CPU_PROFILE_SCOPE("optimize vertex cache");
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// the triangles of each vertex, compressed rows: adjacency[adjacencyOffsets[v] .. adjacencyOffsets[v + 1])
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32_t index : indices) {
+		adjacencyOffsets[index + 1]++;
+	}
+	for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+		adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+	}
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> liveTriangles(vertexCount); // not emitted yet
+	{
+		std::vector<uint32_t> cursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++) {
+			adjacency[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+	for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+		liveTriangles[vertex] = adjacencyOffsets[vertex + 1] - adjacencyOffsets[vertex];
+	}
+
+	VertexCacheModel cache(vertexCount, cacheSize);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnds; // vertices of recent triangles, where to go on when the candidates of a fan have no triangles left
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	size_t nextVertex = 0; // the last resort: the lowest numbered vertex with triangles left
+
+	uint32_t fan = indices[0];
+
+	while (fan != NO_VERTEX) {
+		// emit every remaining triangle around the fan vertex
+
+		candidates.clear();
+
+		for (uint32_t a = adjacencyOffsets[fan]; a < adjacencyOffsets[fan + 1]; a++) {
+			uint32_t triangle = adjacency[a];
+			if (emitted[triangle]) {
+				continue;
+			}
+
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				uint32_t vertex = indices[triangle * 3 + corner];
+				output.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+				cache.access(vertex);
+			}
+
+			emitted[triangle] = 1;
+		}
+
+		// next fan: the candidate that has been in the cache longest and is still cached after its own fan (2 new vertices per triangle at most)
+		// any other candidate with triangles left over none
+
+		uint32_t next = NO_VERTEX;
+		int64_t bestPriority = -1;
+
+		for (uint32_t vertex : candidates) {
+			if (liveTriangles[vertex] == 0) {
+				continue;
+			}
+
+			int64_t age = cache.time - cache.stamps[vertex];
+			int64_t priority = age + 2 * static_cast<int64_t>(liveTriangles[vertex]) <= cacheSize ? age : 0;
+
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+
+		if (next == NO_VERTEX) { // dead end: the most recently used vertex with triangles left, or the next one in input order
+			while (!deadEnds.empty() && next == NO_VERTEX) {
+				uint32_t vertex = deadEnds.back();
+				deadEnds.pop_back();
+
+				if (liveTriangles[vertex] > 0) {
+					next = vertex;
+				}
+			}
+
+			while (next == NO_VERTEX && nextVertex < vertexCount) {
+				if (liveTriangles[nextVertex] > 0) {
+					next = static_cast<uint32_t>(nextVertex);
+				}
+				nextVertex++;
+			}
+		}
+
+		fan = next;
+	}
+
+	indices.swap(output);
+}
+
+struct TriangleCluster {
+	size_t firstTriangle;
+	size_t triangleCount;
+	float sortKey;
+};
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices, float threshold, uint32_t cacheSize) {
+	CPU_PROFILE_SCOPE("optimize overdraw");
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2) {
+		return;
+	}
+
+	// hard boundaries: triangles that miss the cache on all three vertices, the cache order starts over there anyway
+
+	std::vector<size_t> hardBoundaries = { 0 };
+	{
+		VertexCacheModel cache(vertices.size(), cacheSize);
+
+		for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+			if (cache.accessTriangle(&indices[triangle * 3]) == 3 && triangle > 0) {
+				hardBoundaries.push_back(triangle);
+			}
+		}
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// soft boundaries inside each run: cut as soon as the cluster so far (starting with a cold cache) gets within threshold of the ACMR of the whole run
+
+	std::vector<TriangleCluster> clusters;
+	VertexCacheModel cache(vertices.size(), cacheSize);
+
+	for (size_t run = 0; run + 1 < hardBoundaries.size(); run++) {
+		size_t runBegin = hardBoundaries[run];
+		size_t runEnd = hardBoundaries[run + 1];
+
+		cache.flush();
+		uint64_t runMisses = 0;
+		for (size_t triangle = runBegin; triangle < runEnd; triangle++) {
+			runMisses += cache.accessTriangle(&indices[triangle * 3]);
+		}
+		double acmrLimit = threshold * static_cast<double>(runMisses) / (runEnd - runBegin);
+
+		cache.flush();
+		size_t clusterBegin = runBegin;
+		uint64_t clusterMisses = 0;
+
+		for (size_t triangle = runBegin; triangle < runEnd; triangle++) {
+			clusterMisses += cache.accessTriangle(&indices[triangle * 3]);
+			size_t clusterTriangles = triangle + 1 - clusterBegin;
+
+			if (triangle + 1 == runEnd || static_cast<double>(clusterMisses) / clusterTriangles <= acmrLimit) {
+				clusters.push_back({ clusterBegin, clusterTriangles, 0.0f });
+				clusterBegin = triangle + 1;
+				clusterMisses = 0;
+				cache.flush();
+			}
+		}
+	}
+
+	// sort key: how far the cluster faces out from the centroid of the mesh, clusters on the outside facing out first
+	// the vertex normals give the facing, so it doesn't depend on the winding of the file
+
+	glm::dvec3 meshCentroid(0.0);
+	double meshArea = 0.0;
+	std::vector<glm::vec3> clusterCentroids(clusters.size());
+	std::vector<glm::vec3> clusterNormals(clusters.size());
+
+	for (size_t i = 0; i < clusters.size(); i++) {
+		const TriangleCluster& cluster = clusters[i];
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+
+		for (size_t triangle = cluster.firstTriangle; triangle < cluster.firstTriangle + cluster.triangleCount; triangle++) {
+			const MeshVertex& a = vertices[indices[triangle * 3]];
+			const MeshVertex& b = vertices[indices[triangle * 3 + 1]];
+			const MeshVertex& c = vertices[indices[triangle * 3 + 2]];
+
+			float triangleArea = 0.5f * glm::length(glm::cross(b.position - a.position, c.position - a.position));
+			centroid += (a.position + b.position + c.position) * (triangleArea / 3.0f);
+			normal += (a.normal + b.normal + c.normal) * triangleArea;
+			area += triangleArea;
+		}
+
+		clusterCentroids[i] = area > 0.0f ? centroid / area : vertices[indices[cluster.firstTriangle * 3]].position;
+		float normalLength = glm::length(normal);
+		clusterNormals[i] = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f);
+		meshCentroid += glm::dvec3(centroid);
+		meshArea += area;
+	}
+
+	glm::vec3 center = meshArea > 0.0 ? glm::vec3(meshCentroid / meshArea) : glm::vec3(0.0f);
+
+	for (size_t i = 0; i < clusters.size(); i++) {
+		clusters[i].sortKey = glm::dot(clusterCentroids[i] - center, clusterNormals[i]);
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const TriangleCluster& a, const TriangleCluster& b) { return a.sortKey > b.sortKey; });
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	for (const auto& cluster : clusters) {
+		output.insert(output.end(), indices.begin() + cluster.firstTriangle * 3, indices.begin() + (cluster.firstTriangle + cluster.triangleCount) * 3);
+	}
+
+	indices.swap(output);
+}
+
+void optimizeVertexFetch(MeshData& mesh) {
+	CPU_PROFILE_SCOPE("optimize vertex fetch");
+
+	std::vector<uint32_t> remap(mesh.vertices.size(), NO_VERTEX);
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	for (uint32_t& index : mesh.indices) {
+		if (remap[index] == NO_VERTEX) {
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(mesh.vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	mesh.vertices.swap(vertices);
+}
+
+void optimizeMesh(MeshData& mesh) {
+	CPU_PROFILE_SCOPE("optimize mesh");
+
+	optimizeVertexCache(mesh.indices, mesh.vertices.size());
+	optimizeOverdraw(mesh.indices, mesh.vertices);
+	optimizeVertexFetch(mesh);
+}
+
+static size_t referencedVertexCount(const std::vector<uint32_t>& indices, size_t vertexCount) {
+	std::vector<uint8_t> referenced(vertexCount, 0);
+	size_t count = 0;
+
+	for (uint32_t index : indices) {
+		count += referenced[index] == 0;
+		referenced[index] = 1;
+	}
+
+	return count;
+}
+
+VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+	VertexCacheStatistics statistics;
+	VertexCacheModel cache(vertexCount, cacheSize);
+
+	for (uint32_t index : indices) {
+		statistics.vertexShaderInvocations += cache.access(index);
+	}
+
+	size_t triangleCount = indices.size() / 3;
+	size_t referenced = referencedVertexCount(indices, vertexCount);
+	statistics.acmr = triangleCount > 0 ? static_cast<double>(statistics.vertexShaderInvocations) / triangleCount : 0.0;
+	statistics.atvr = referenced > 0 ? static_cast<double>(statistics.vertexShaderInvocations) / referenced : 0.0;
+	return statistics;
+}
+
+VertexFetchStatistics analyzeVertexFetch(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t vertexStride) {
+	// every vertex shader invocation fetches its vertex, through a direct-mapped cache of whole lines
+
+	const uint32_t lineCount = VERTEX_FETCH_CACHE_BYTES / VERTEX_FETCH_LINE_BYTES;
+	std::vector<uint64_t> lineTags(lineCount, UINT64_MAX);
+	VertexFetchStatistics statistics;
+	VertexCacheModel cache(vertexCount, VERTEX_CACHE_SIZE);
+
+	for (uint32_t index : indices) {
+		if (!cache.access(index)) {
+			continue;
+		}
+
+		uint64_t firstLine = static_cast<uint64_t>(index) * vertexStride / VERTEX_FETCH_LINE_BYTES;
+		uint64_t lastLine = (static_cast<uint64_t>(index) * vertexStride + vertexStride - 1) / VERTEX_FETCH_LINE_BYTES;
+
+		for (uint64_t line = firstLine; line <= lastLine; line++) {
+			uint64_t& tag = lineTags[line % lineCount];
+			if (tag != line) {
+				tag = line;
+				statistics.bytesFetched += VERTEX_FETCH_LINE_BYTES;
+			}
+		}
+	}
+
+	size_t referenced = referencedVertexCount(indices, vertexCount);
+	statistics.overfetch = referenced > 0 ? static_cast<double>(statistics.bytesFetched) / (static_cast<double>(referenced) * vertexStride) : 0.0;
+	return statistics;
+}
+
+static float edgeFunction(glm::vec3 a, glm::vec3 b, float x, float y) { // > 0 left of a -> b (y down)
+	return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+}
+
+static bool ownsEdge(glm::vec3 a, glm::vec3 b) { // pixel centers exactly on an edge go to one of its two triangles: they run along it in opposite directions
+	return b.y > a.y || (b.y == a.y && b.x > a.x);
+}
+
+static void rasterizeTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c, std::vector<float>& depth, OverdrawStatistics& statistics) {
+	float area = edgeFunction(a, b, c.x, c.y);
+	if (area == 0.0f) {
+		return;
+	}
+	if (area < 0.0f) { // both facings are drawn, some materials don't cull
+		std::swap(b, c);
+		area = -area;
+	}
+
+	int32_t maxPixel = static_cast<int32_t>(OVERDRAW_GRID_SIZE) - 1;
+	int32_t minX = (std::max)(static_cast<int32_t>(std::floor((std::min)({ a.x, b.x, c.x }))), 0);
+	int32_t maxX = (std::min)(static_cast<int32_t>(std::ceil((std::max)({ a.x, b.x, c.x }))), maxPixel);
+	int32_t minY = (std::max)(static_cast<int32_t>(std::floor((std::min)({ a.y, b.y, c.y }))), 0);
+	int32_t maxY = (std::min)(static_cast<int32_t>(std::ceil((std::max)({ a.y, b.y, c.y }))), maxPixel);
+
+	bool ownsBc = ownsEdge(b, c);
+	bool ownsCa = ownsEdge(c, a);
+	bool ownsAb = ownsEdge(a, b);
+
+	for (int32_t y = minY; y <= maxY; y++) {
+		for (int32_t x = minX; x <= maxX; x++) {
+			float sampleX = x + 0.5f;
+			float sampleY = y + 0.5f;
+			float wa = edgeFunction(b, c, sampleX, sampleY);
+			float wb = edgeFunction(c, a, sampleX, sampleY);
+			float wc = edgeFunction(a, b, sampleX, sampleY);
+
+			if (wa < 0.0f || wb < 0.0f || wc < 0.0f || (wa == 0.0f && !ownsBc) || (wb == 0.0f && !ownsCa) || (wc == 0.0f && !ownsAb)) {
+				continue;
+			}
+
+			float z = (wa * a.z + wb * b.z + wc * c.z) / area;
+			float& pixel = depth[y * OVERDRAW_GRID_SIZE + x];
+
+			if (pixel == std::numeric_limits<float>::infinity()) {
+				statistics.pixelsCovered++;
+			}
+			if (z < pixel) {
+				pixel = z;
+				statistics.pixelsShaded++;
+			}
+		}
+	}
+}
+
+OverdrawStatistics analyzeOverdraw(const MeshData& mesh) {
+	OverdrawStatistics statistics;
+	if (mesh.vertices.empty()) {
+		return statistics;
+	}
+
+	// the bounding box scaled uniformly into [0, 1], then orthographic views along +-x, +-y and +-z with a depth test, in index order
+
+	glm::vec3 minimum = mesh.vertices[0].position;
+	glm::vec3 maximum = minimum;
+	for (const auto& vertex : mesh.vertices) {
+		minimum = glm::min(minimum, vertex.position);
+		maximum = glm::max(maximum, vertex.position);
+	}
+	glm::vec3 extent = maximum - minimum;
+	float scale = 1.0f / (std::max)({ extent.x, extent.y, extent.z, 1e-20f });
+
+	std::vector<glm::vec3> projected(mesh.vertices.size());
+	std::vector<float> depth(OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE);
+
+	for (int axis = 0; axis < 3; axis++) {
+		for (int direction = 0; direction < 2; direction++) {
+			for (size_t i = 0; i < mesh.vertices.size(); i++) {
+				glm::vec3 p = (mesh.vertices[i].position - minimum) * scale;
+				float z = direction == 0 ? p[axis] : 1.0f - p[axis];
+				projected[i] = glm::vec3(p[(axis + 1) % 3] * OVERDRAW_GRID_SIZE, p[(axis + 2) % 3] * OVERDRAW_GRID_SIZE, z);
+			}
+
+			std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::infinity());
+
+			for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+				rasterizeTriangle(projected[mesh.indices[i]], projected[mesh.indices[i + 1]], projected[mesh.indices[i + 2]], depth, statistics);
+			}
+		}
+	}
+
+	statistics.overdraw = statistics.pixelsCovered > 0 ? static_cast<double>(statistics.pixelsShaded) / statistics.pixelsCovered : 0.0;
+	return statistics;
+}
+
+MeshStatistics analyzeMesh(const MeshData& mesh) {
+	MeshStatistics statistics;
+	statistics.vertexCache = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+	statistics.vertexFetch = analyzeVertexFetch(mesh.indices, mesh.vertices.size(), sizeof(PackedVertex));
+	statistics.overdraw = analyzeOverdraw(mesh);
+	return statistics;
+}
+
+MeshOptimizationReport measureMeshOptimization(const MeshData& mesh) {
+	MeshOptimizationReport report;
+	report.triangleCount = mesh.indices.size() / 3;
+	report.vertexCount = mesh.vertices.size();
+	report.before = analyzeMesh(mesh);
+
+	MeshData optimized = mesh;
+	auto start = std::chrono::steady_clock::now();
+	optimizeMesh(optimized);
+	report.optimizeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	report.after = analyzeMesh(optimized);
+	return report;
+}
+
+void printMeshOptimizationReport(const char* name, const MeshOptimizationReport& report) {
+	std::cout << name << ": " << report.triangleCount << " triangles, " << report.vertexCount << " vertices, optimized in "
+		<< std::fixed << std::setprecision(1) << report.optimizeMs << " ms" << std::endl;
+	std::cout << std::setprecision(3);
+	std::cout << "  vertex cache (" << VERTEX_CACHE_SIZE << " entry FIFO): ACMR " << report.before.vertexCache.acmr << " -> " << report.after.vertexCache.acmr
+		<< ", ATVR " << report.before.vertexCache.atvr << " -> " << report.after.vertexCache.atvr << std::endl;
+	std::cout << "  vertex fetch (" << sizeof(PackedVertex) << " byte vertices, " << VERTEX_FETCH_LINE_BYTES << " byte lines): overfetch "
+		<< report.before.vertexFetch.overfetch << " -> " << report.after.vertexFetch.overfetch << std::endl;
+	std::cout << "  overdraw (6 axis views at " << OVERDRAW_GRID_SIZE << "^2): " << report.before.overdraw.overdraw << " -> " << report.after.overdraw.overdraw << std::endl;
+	std::cout << std::defaultfloat;
+}
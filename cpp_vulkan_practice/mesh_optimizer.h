@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mesh.h"
+
+// mesh optimization: reorders the triangles and vertices of a MeshData for the GPU, between the import and quantizeMesh; the triangles themselves stay the same
+//
+// - vertex cache: Tipsify (Sander, Nehab, Barczak 2007), fans around vertices that are still in the post-transform cache, so each vertex is shaded as few times as possible
+// - overdraw: the cache ordered triangles are cut into clusters, the clusters sorted so the ones facing away from the center of the mesh come first;
+//   from most directions those are in front and fill the depth buffer early, so fewer fragments behind them are shaded
+//   the cuts are where the cache order starts over anyway, and inside those runs wherever the cluster costs at most OVERDRAW_ACMR_THRESHOLD times its run's ACMR
+// - vertex fetch: the vertices renumbered in order of first use by the indices, the fetch walks through the vertex buffer instead of jumping around
+//
+// the statistics come from a CPU model of the GPU, not from a GPU: a FIFO post-transform cache, a direct-mapped cache for the vertex fetch
+// and a small rasterizer with a depth buffer that draws the mesh from the six axis directions
+
+const uint32_t VERTEX_CACHE_SIZE = 16; // entries of the modeled post-transform cache, the optimization targets the same size
+const float OVERDRAW_ACMR_THRESHOLD = 1.05f; // how much worse than the cache order a cluster's ACMR may get to cut it smaller for the overdraw sort
+
+struct VertexCacheStatistics {
+	uint64_t vertexShaderInvocations = 0; // cache misses
+	double acmr = 0.0; // average cache miss ratio: invocations per triangle, 0.5 at best (a large regular grid), 3 at worst
+	double atvr = 0.0; // average transform to vertex ratio: invocations per referenced vertex, 1 at best
+};
+
+struct VertexFetchStatistics {
+	uint64_t bytesFetched = 0; // whole cache lines, for the vertex shader invocations
+	double overfetch = 0.0; // bytes fetched per byte of referenced vertices, 1 at best
+};
+
+struct OverdrawStatistics {
+	uint64_t pixelsCovered = 0; // over all views
+	uint64_t pixelsShaded = 0; // fragments that passed the depth test when they were drawn
+	double overdraw = 0.0; // shaded per covered, 1 at best
+};
+
+struct MeshStatistics {
+	VertexCacheStatistics vertexCache;
+	VertexFetchStatistics vertexFetch;
+	OverdrawStatistics overdraw;
+};
+
+struct MeshOptimizationReport {
+	size_t triangleCount = 0;
+	size_t vertexCount = 0;
+	MeshStatistics before;
+	MeshStatistics after;
+	double optimizeMs = 0.0;
+};
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices, float threshold = OVERDRAW_ACMR_THRESHOLD, uint32_t cacheSize = VERTEX_CACHE_SIZE); // after optimizeVertexCache
+void optimizeVertexFetch(MeshData& mesh); // last, the other two don't touch the vertices; drops vertices no triangle uses
+void optimizeMesh(MeshData& mesh); // all three in order
+
+VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+VertexFetchStatistics analyzeVertexFetch(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t vertexStride);
+OverdrawStatistics analyzeOverdraw(const MeshData& mesh);
+MeshStatistics analyzeMesh(const MeshData& mesh); // the vertex fetch of PackedVertex, what the GPU actually reads
+
+MeshOptimizationReport measureMeshOptimization(const MeshData& mesh); // optimizes a copy
+void printMeshOptimizationReport(const char* name, const MeshOptimizationReport& report);
@@ -0,0 +1,113 @@
+#include "parallel_command_recorder.h"
+
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+
+#include "cpu_profiler.h"
+
+void ParallelCommandRecorder::create(VkDevice device, uint32_t queueFamilyIndex, uint32_t frameSlotCount, uint32_t threadCount) {
+	this->device = device;
+
+	VkCommandPoolCreateInfo command_pool_info = {};
+	command_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	command_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // buffers are re-recorded every time the frame slot comes around, the whole pool is reset at once
+	command_pool_info.queueFamilyIndex = queueFamilyIndex;
+
+	workerPools.resize(frameSlotCount);
+
+	for (auto& slotPools : workerPools) {
+		slotPools.resize(threadCount);
+
+		for (auto& workerPool : slotPools) {
+			if (vkCreateCommandPool(device, &command_pool_info, nullptr, &workerPool.commandPool) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create worker command pool.");
+			}
+		}
+	}
+
+	threadPool = std::make_unique<ThreadPool>(threadCount);
+}
+
+void ParallelCommandRecorder::destroy() { // expects the GPU to be done with all recorded command buffers
+	threadPool.reset();
+
+	for (auto& slotPools : workerPools) {
+		for (auto& workerPool : slotPools) {
+			vkDestroyCommandPool(device, workerPool.commandPool, nullptr); // frees its command buffers as well
+		}
+	}
+
+	workerPools.clear();
+	recordedCommandBuffers.clear();
+}
+
+const std::vector<VkCommandBuffer>& ParallelCommandRecorder::record(uint32_t frameSlot, const VkCommandBufferInheritanceInfo& inheritanceInfo, uint32_t drawCount, const RecordRange& recordRange) {
+	// the workers are idle between frames, so the main thread may reset their pools here
+
+	for (auto& workerPool : workerPools[frameSlot]) {
+		vkResetCommandPool(device, workerPool.commandPool, 0);
+		workerPool.usedCount = 0;
+	}
+
+	// one contiguous range of draws per worker
+
+	uint32_t rangeCount = (std::min)(threadCount(), drawCount);
+	std::vector<std::future<VkCommandBuffer>> ranges;
+
+	for (uint32_t i = 0; i < rangeCount; i++) {
+		uint32_t firstDraw = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * i / rangeCount);
+		uint32_t lastDraw = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * (i + 1) / rangeCount);
+
+		ranges.push_back(threadPool->submit([this, frameSlot, &inheritanceInfo, firstDraw, lastDraw, &recordRange]() {
+			return recordRangeOnWorker(frameSlot, inheritanceInfo, firstDraw, lastDraw - firstDraw, recordRange);
+		}));
+	}
+
+	recordedCommandBuffers.clear();
+
+	for (auto& range : ranges) {
+		recordedCommandBuffers.push_back(range.get()); // waits for the worker, rethrows its exception
+	}
+
+	return recordedCommandBuffers;
+}
+
+VkCommandBuffer ParallelCommandRecorder::recordRangeOnWorker(uint32_t frameSlot, const VkCommandBufferInheritanceInfo& inheritanceInfo, uint32_t firstDraw, uint32_t drawCount, const RecordRange& recordRange) {
+	CPU_PROFILE_SCOPE("record range");
+	WorkerCommandPool& workerPool = workerPools[frameSlot][ThreadPool::workerIndex()]; // only this worker touches this pool
+
+	if (workerPool.usedCount == workerPool.commandBuffers.size()) { // the same worker may get more than one range
+		VkCommandBufferAllocateInfo command_buffer_allocate_info = {};
+		command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		command_buffer_allocate_info.commandPool = workerPool.commandPool;
+		command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY; // executed from the primary command buffer
+		command_buffer_allocate_info.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(device, &command_buffer_allocate_info, &commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate secondary command buffer.");
+		}
+
+		workerPool.commandBuffers.push_back(commandBuffer);
+	}
+
+	VkCommandBuffer commandBuffer = workerPool.commandBuffers[workerPool.usedCount++];
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT; // recorded entirely inside the render pass of the primary
+	begin_info.pInheritanceInfo = &inheritanceInfo; // render pass, subpass and framebuffer the primary command buffer is in
+
+	if (vkBeginCommandBuffer(commandBuffer, &begin_info) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin recording secondary command buffer.");
+	}
+
+	recordRange(commandBuffer, firstDraw, drawCount);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record secondary command buffer.");
+	}
+
+	return commandBuffer;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "thread_pool.h"
+
+// parallel command recording: the draws of a frame are split into one range per worker thread, every worker records its range into a secondary command buffer
+// each worker owns one VkCommandPool per frame slot (command pools must not be used by two threads at once), so recording needs no locks
+// the primary command buffer then runs the secondary ones with vkCmdExecuteCommands
+
+class ParallelCommandRecorder {
+public:
+	using RecordRange = std::function<void(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount)>;
+
+	void create(VkDevice device, uint32_t queueFamilyIndex, uint32_t frameSlotCount, uint32_t threadCount);
+	void destroy();
+
+	uint32_t threadCount() const { return threadPool ? threadPool->threadCount() : 0; } // 0: not created, record inline
+
+	// records drawCount draws into secondary command buffers (returned in draw order), the GPU must be done with everything recorded earlier for frameSlot
+	const std::vector<VkCommandBuffer>& record(uint32_t frameSlot, const VkCommandBufferInheritanceInfo& inheritanceInfo, uint32_t drawCount, const RecordRange& recordRange);
+
+private:
+	struct WorkerCommandPool {
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> commandBuffers; // allocated once, reused after the pool is reset
+		uint32_t usedCount = 0;
+	};
+
+	VkCommandBuffer recordRangeOnWorker(uint32_t frameSlot, const VkCommandBufferInheritanceInfo& inheritanceInfo, uint32_t firstDraw, uint32_t drawCount, const RecordRange& recordRange);
+
+	VkDevice device = VK_NULL_HANDLE;
+	std::unique_ptr<ThreadPool> threadPool;
+	std::vector<std::vector<WorkerCommandPool>> workerPools; // [frame slot][worker]
+	std::vector<VkCommandBuffer> recordedCommandBuffers;
+};
@@ -0,0 +1,176 @@
+#include "pipeline_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "hash.h"
+
+const uint32_t PIPELINE_CACHE_MAGIC = 0x43504B56; // "VKPC"
+const uint32_t PIPELINE_CACHE_FILE_VERSION = 2;
+
+void PipelineCache::create(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path) {
+	this->device = device;
+	this->path = path;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	std::vector<uint8_t> initialData;
+	loaded = readFile(initialData);
+
+	VkPipelineCacheCreateInfo pipeline_cache_info = {};
+	pipeline_cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	pipeline_cache_info.initialDataSize = initialData.size(); // 0: start with an empty cache
+	pipeline_cache_info.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+	if (vkCreatePipelineCache(device, &pipeline_cache_info, nullptr, &pipelineCache) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline cache.");
+	}
+}
+
+bool PipelineCache::readFile(std::vector<uint8_t>& data) { // returns false (and leaves data empty) if there is no usable cache file
+	std::ifstream file(path, std::ios::binary);
+
+	if (!file.is_open()) {
+		return false;
+	}
+
+	PipelineCacheFileHeader header = {};
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+		std::cerr << "pipeline cache: " << path << " is truncated, ignoring it" << std::endl;
+		return false;
+	}
+
+	if (header.magic != PIPELINE_CACHE_MAGIC || header.fileVersion != PIPELINE_CACHE_FILE_VERSION) {
+		std::cerr << "pipeline cache: " << path << " has an unknown format, ignoring it" << std::endl;
+		return false;
+	}
+
+	if (header.vendorID != deviceProperties.vendorID || header.deviceID != deviceProperties.deviceID ||
+		header.driverVersion != deviceProperties.driverVersion ||
+		std::memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+		std::cerr << "pipeline cache: " << path << " was written by a different GPU or driver, ignoring it" << std::endl;
+		return false;
+	}
+
+	// sizes from the file are checked against what the file has left before anything is allocated for them
+
+	std::error_code error;
+	uint64_t fileSize = std::filesystem::file_size(path, error);
+	uint64_t remainingBytes = error ? 0 : fileSize - sizeof(header);
+
+	if (header.dataSize > remainingBytes) {
+		std::cerr << "pipeline cache: " << path << " is corrupted, ignoring it" << std::endl;
+		return false;
+	}
+
+	data.resize(static_cast<size_t>(header.dataSize));
+	if (!file.read(reinterpret_cast<char*>(data.data()), data.size()) || fnv1a(data.data(), data.size()) != header.dataHash) {
+		std::cerr << "pipeline cache: " << path << " is corrupted, ignoring it" << std::endl;
+		data.clear();
+		return false;
+	}
+
+	// the blob starts with the vulkan pipeline cache header, the driver checks it as well, but a mismatch there would silently give us an empty cache
+
+	VkPipelineCacheHeaderVersionOne vulkanHeader = {};
+	if (data.size() < sizeof(vulkanHeader)) {
+		data.clear();
+		return false;
+	}
+
+	std::memcpy(&vulkanHeader, data.data(), sizeof(vulkanHeader));
+
+	if (vulkanHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		vulkanHeader.vendorID != deviceProperties.vendorID || vulkanHeader.deviceID != deviceProperties.deviceID ||
+		std::memcmp(vulkanHeader.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+		std::cerr << "pipeline cache: " << path << " contains data for a different device, ignoring it" << std::endl;
+		data.clear();
+		return false;
+	}
+
+	// compile times are only statistics, a damaged list doesn't make the blob unusable
+
+	uint64_t maxCompileTimes = (remainingBytes - header.dataSize) / sizeof(PipelineCompileTime);
+	std::vector<PipelineCompileTime> compileTimes(static_cast<size_t>((std::min)(static_cast<uint64_t>(header.compileTimeCount), maxCompileTimes)));
+	if (file.read(reinterpret_cast<char*>(compileTimes.data()), compileTimes.size() * sizeof(PipelineCompileTime))) {
+		for (const auto& compileTime : compileTimes) {
+			coldCompileMs[compileTime.pipelineKey] = compileTime.coldCompileMs;
+		}
+	}
+
+	return true;
+}
+
+void PipelineCache::save() {
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr);
+
+	std::vector<uint8_t> data(dataSize);
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+		std::cerr << "pipeline cache: failed to read back cache data, not saving" << std::endl;
+		return;
+	}
+	data.resize(dataSize);
+
+	PipelineCacheFileHeader header = {};
+	header.magic = PIPELINE_CACHE_MAGIC;
+	header.fileVersion = PIPELINE_CACHE_FILE_VERSION;
+	header.vendorID = deviceProperties.vendorID;
+	header.deviceID = deviceProperties.deviceID;
+	header.driverVersion = deviceProperties.driverVersion;
+	header.dataSize = data.size();
+	header.dataHash = fnv1a(data.data(), data.size());
+	std::memcpy(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+
+	std::vector<PipelineCompileTime> compileTimes;
+	for (const auto& [pipelineKey, compileMs] : coldCompileMs) {
+		compileTimes.push_back({ pipelineKey, compileMs });
+	}
+	header.compileTimeCount = static_cast<uint32_t>(compileTimes.size());
+
+	// write everything to a temporary file first, a crash or a second process never sees a half written cache
+
+	std::string tempPath = path + ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		file.write(reinterpret_cast<const char*>(compileTimes.data()), compileTimes.size() * sizeof(PipelineCompileTime));
+
+		if (!file.good()) {
+			std::cerr << "pipeline cache: failed to write " << tempPath << std::endl;
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error); // replaces the old file in one step
+
+	if (error) {
+		std::cerr << "pipeline cache: failed to replace " << path << ": " << error.message() << std::endl;
+		std::filesystem::remove(tempPath, error);
+	}
+}
+
+void PipelineCache::destroy() {
+	if (pipelineCache != VK_NULL_HANDLE) {
+		vkDestroyPipelineCache(device, pipelineCache, nullptr);
+		pipelineCache = VK_NULL_HANDLE;
+	}
+}
+
+void PipelineCache::reportCompileTime(uint64_t pipelineKey, double compileMs) {
+	auto coldTime = coldCompileMs.find(pipelineKey);
+
+	if (coldTime == coldCompileMs.end()) {
+		coldCompileMs[pipelineKey] = compileMs; // saved with the cache, so the next run can compare against it
+		std::cout << "pipeline compile: " << compileMs << " ms (cold, variant not compiled before)" << std::endl;
+		return;
+	}
+
+	std::cout << "pipeline compile: " << compileMs << " ms (warm, saved " << coldTime->second - compileMs << " ms compared to the cold start)" << std::endl;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// persistent pipeline cache: the VkPipelineCache is filled from disk at startup and written back at shutdown, so pipelines compiled in an earlier run don't get compiled from SPIR-V again
+// the file starts with our own header (checksum, driver version), followed by the data returned by vkGetPipelineCacheData and the recorded cold compile times
+// a file from another GPU, driver or a damaged file is ignored and the cache starts empty
+
+struct PipelineCacheFileHeader {
+	uint32_t magic; // PIPELINE_CACHE_MAGIC
+	uint32_t fileVersion; // PIPELINE_CACHE_FILE_VERSION, bumped when this header changes
+	uint32_t vendorID; // also stored in the vulkan header of the blob, checked against both
+	uint32_t deviceID;
+	uint32_t driverVersion; // not part of the vulkan header, a driver update may invalidate the data
+	uint32_t compileTimeCount; // PipelineCompileTime records following the blob
+	uint64_t dataSize;
+	uint64_t dataHash; // FNV-1a over the blob, catches truncated or corrupted files
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+struct PipelineCompileTime {
+	uint64_t pipelineKey; // GraphicsPipelineDesc::key(), every variant (e.g. other specialization constants) has its own cold time
+	double coldCompileMs; // compile time of the first run that built this variant without cached data
+};
+
+class PipelineCache {
+public:
+	void create(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path);
+	void save(); // atomic: writes a temporary file next to the cache file and renames it over the old one
+	void destroy();
+
+	VkPipelineCache handle() const { return pipelineCache; }
+	bool loadedFromDisk() const { return loaded; }
+
+	void reportCompileTime(uint64_t pipelineKey, double compileMs); // prints the time saved compared to the cold start, remembers the cold time of variants seen for the first time
+
+private:
+	bool readFile(std::vector<uint8_t>& data);
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties deviceProperties = {};
+	std::string path;
+	bool loaded = false;
+	std::unordered_map<uint64_t, double> coldCompileMs; // by pipeline key
+};
@@ -0,0 +1,236 @@
+#include "pipeline_compiler.h"
+
+#include <chrono>
+
+#include "cpu_profiler.h"
+#include "hash.h"
+
+CompiledPipeline buildGraphicsPipeline(VkDevice device, VkPipelineCache pipelineCache, const GraphicsPipelineDesc& desc) {
+	CPU_PROFILE_SCOPE("buildGraphicsPipeline");
+
+	FixedFunctionState state = bakedState(desc.state, desc.dynamicState); // the dynamic fields only need a valid placeholder, the command buffer sets the real values
+	std::vector<VkDynamicState> dynamicStates = dynamicStateList(desc.dynamicState);
+
+	CompiledPipeline compiled;
+	compiled.key = desc.key();
+	compiled.layout = desc.layout;
+	auto compileStart = std::chrono::steady_clock::now();
+
+	// creating shader modules and the shader stages
+
+	std::vector<VkShaderModule> shaderModules;
+	std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+	std::vector<VkSpecializationInfo> specializationInfos;
+	specializationInfos.reserve(desc.stages.size()); // the stage infos point into it, it must not reallocate
+
+	for (const auto& stage : desc.stages) {
+		VkShaderModuleCreateInfo shader_module_info = {};
+		shader_module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		shader_module_info.codeSize = stage.codeSize();
+		shader_module_info.pCode = stage.codeData(); // straight from the bundle mapping if the stage comes from one
+
+		VkShaderModule shaderModule;
+		compiled.result = vkCreateShaderModule(device, &shader_module_info, nullptr, &shaderModule);
+		if (compiled.result != VK_SUCCESS) {
+			break;
+		}
+		shaderModules.push_back(shaderModule);
+
+		VkPipelineShaderStageCreateInfo shader_stage_info = {};
+		shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shader_stage_info.stage = stage.stage; // pipeline stage the shader is going to be used in (enum values for this are described in introduction chapter)
+		shader_stage_info.module = shaderModule; // shader module containing the code
+		shader_stage_info.pName = stage.entryPoint.c_str(); // function to invoke, known as the entrypoint (it's possible to combine multiple fragment shaders into a single shader module and use different entry points to differentiate between their behaviors)
+		shader_stage_info.pSpecializationInfo = nullptr; // specifies values for shader constants (if needed)
+		if (!stage.specialization.empty()) {
+			specializationInfos.push_back(stage.specialization.info());
+			shader_stage_info.pSpecializationInfo = &specializationInfos.back();
+		}
+		shaderStages.push_back(shader_stage_info);
+	}
+
+	if (shaderModules.size() == desc.stages.size()) {
+		// vertex input
+
+		VkPipelineVertexInputStateCreateInfo vertex_input_info = {}; // describes the format of the vertex data that will be passed to the vertex shader
+		vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertex_input_info.vertexBindingDescriptionCount = static_cast<uint32_t>(desc.vertexBindings.size());
+		vertex_input_info.pVertexBindingDescriptions = desc.vertexBindings.data(); // points to an array of structs that describe the aforementioned details for loading vertex data
+		vertex_input_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.vertexAttributes.size());
+		vertex_input_info.pVertexAttributeDescriptions = desc.vertexAttributes.data(); // points to an array of structs that describe the aforementioned details for loading vertex data
+
+		// input assembly
+
+		VkPipelineInputAssemblyStateCreateInfo input_assembly_info = {};
+		input_assembly_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		input_assembly_info.topology = state.topology; // triangle list for drawing a triangle (there's more, explained in graphics pipeline -> fixed functions -> input assembly
+		input_assembly_info.primitiveRestartEnable = state.primitiveRestartEnable; // if set to VK_TRUE: possible to break up lines and triangles in the _STRIP topology modes by using a special index of 0xFFFF or 0xFFFFFFFF
+
+		// viewports and scissors (dynamic state, set in the recordCommandBuffer method)
+
+		VkPipelineViewportStateCreateInfo viewport_info = {};
+		viewport_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewport_info.viewportCount = 1;
+		viewport_info.scissorCount = 1;
+
+		// rasterizer
+
+		VkPipelineRasterizationStateCreateInfo rasterizer_info = {};
+		rasterizer_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer_info.depthClampEnable = VK_FALSE; // if set to VK_TRUE: fragments that are beyond the near and far planes are clamped to them as opposed to discarding them
+		rasterizer_info.rasterizerDiscardEnable = VK_FALSE; // if set to VK_TRUE: geometry never passes through the rasterizer stage, disables any output to the framebuffer
+		rasterizer_info.polygonMode = state.polygonMode; // determines how fragments are generated for geometry (how vertices are drawn); 3 modes: fill, line, point
+		rasterizer_info.lineWidth = 1.0f; // for higher than 1.0 enable wideLines GPU feature
+		rasterizer_info.cullMode = state.cullMode; // determines the type of face culling to use
+		rasterizer_info.frontFace = state.frontFace; // specifies the vertex order for faces to be considered front-facing
+		rasterizer_info.depthBiasEnable = state.depthBiasEnable; // if set to true, this and the following values are used for shadow mapping
+		rasterizer_info.depthBiasConstantFactor = 0.0f;
+		rasterizer_info.depthBiasClamp = 0.0f;
+		rasterizer_info.depthBiasSlopeFactor = 0.0f;
+
+		// multisampling
+
+		VkPipelineMultisampleStateCreateInfo multisample_info = {}; // one of the ways to perform anti-aliasing
+		multisample_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisample_info.sampleShadingEnable = VK_FALSE; // multisample is disabled for now
+		multisample_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		multisample_info.minSampleShading = 1.0f;
+		multisample_info.pSampleMask = nullptr;
+		multisample_info.alphaToCoverageEnable = VK_FALSE;
+		multisample_info.alphaToOneEnable = VK_FALSE;
+
+		// depth testing (ignored as long as there is no depth attachment, but part of the material state)
+
+		VkPipelineDepthStencilStateCreateInfo depth_stencil_info = {};
+		depth_stencil_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depth_stencil_info.depthTestEnable = state.depthTestEnable;
+		depth_stencil_info.depthWriteEnable = state.depthWriteEnable;
+		depth_stencil_info.depthCompareOp = state.depthCompareOp;
+		depth_stencil_info.depthBoundsTestEnable = VK_FALSE;
+		depth_stencil_info.stencilTestEnable = VK_FALSE;
+		depth_stencil_info.minDepthBounds = 0.0f;
+		depth_stencil_info.maxDepthBounds = 1.0f;
+
+		// color blending
+
+		VkPipelineColorBlendAttachmentState color_blend_attachment_info = {}; // contains the configuration per attached framebuffer
+		color_blend_attachment_info.colorWriteMask = state.colorWriteMask;
+		color_blend_attachment_info.blendEnable = state.blendEnable;
+		color_blend_attachment_info.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA; // alpha blending, the same factors with and without blendEnable so it can be dynamic
+		color_blend_attachment_info.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		color_blend_attachment_info.colorBlendOp = VK_BLEND_OP_ADD;
+		color_blend_attachment_info.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		color_blend_attachment_info.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		color_blend_attachment_info.alphaBlendOp = VK_BLEND_OP_ADD;
+
+		VkPipelineColorBlendStateCreateInfo color_blend_state_info = {}; // contains the global color blending setting
+		color_blend_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		color_blend_state_info.logicOpEnable = VK_FALSE; // if set to VK_TRUE: using method of blending called bitwise combination
+		color_blend_state_info.logicOp = VK_LOGIC_OP_COPY;
+		color_blend_state_info.attachmentCount = 1;
+		color_blend_state_info.pAttachments = &color_blend_attachment_info;
+
+		// dynamic state: viewport and scissor, plus the material state the device can set while recording (see extended_dynamic_state.h)
+
+		VkPipelineDynamicStateCreateInfo dynamic_state_info = {}; // will cause the configuration of these values to be ignored and you will be able (and required) to specify the data at drawing time
+		dynamic_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamic_state_info.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+		dynamic_state_info.pDynamicStates = dynamicStates.data();
+
+		// dynamic rendering: instead of a render pass the pipeline is told the formats it renders to
+
+		VkPipelineRenderingCreateInfo rendering_info = {};
+		rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+		rendering_info.colorAttachmentCount = static_cast<uint32_t>(desc.colorAttachmentFormats.size());
+		rendering_info.pColorAttachmentFormats = desc.colorAttachmentFormats.data();
+
+		// conclusion: create graphics pipeline
+
+		VkGraphicsPipelineCreateInfo pipeline_info = {};
+		pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipeline_info.pNext = desc.renderPass == VK_NULL_HANDLE ? &rendering_info : nullptr;
+		pipeline_info.flags = desc.flags;
+		pipeline_info.stageCount = static_cast<uint32_t>(shaderStages.size());
+		pipeline_info.pStages = shaderStages.data();
+		pipeline_info.pVertexInputState = &vertex_input_info;
+		pipeline_info.pInputAssemblyState = &input_assembly_info;
+		pipeline_info.pViewportState = &viewport_info;
+		pipeline_info.pRasterizationState = &rasterizer_info;
+		pipeline_info.pMultisampleState = &multisample_info;
+		pipeline_info.pDepthStencilState = &depth_stencil_info;
+		pipeline_info.pColorBlendState = &color_blend_state_info;
+		pipeline_info.pDynamicState = &dynamic_state_info;
+		pipeline_info.layout = desc.layout;
+		pipeline_info.renderPass = desc.renderPass;
+		pipeline_info.subpass = desc.subpass; // index, there can be more than 1 subpass
+		pipeline_info.basePipelineHandle = VK_NULL_HANDLE; // Vulkan allows you to create a new graphics pipeline by deriving from an existing pipeline
+		pipeline_info.basePipelineIndex = -1;
+
+		compiled.result = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipeline_info, nullptr, &compiled.pipeline); // the cache skips compiling pipelines it has seen before
+	}
+
+	// the modules are only needed while the pipeline is created
+
+	for (auto shaderModule : shaderModules) {
+		vkDestroyShaderModule(device, shaderModule, nullptr);
+	}
+
+	compiled.compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compileStart).count();
+	return compiled;
+}
+
+std::vector<CompiledPipeline> buildGraphicsPipelines(VkDevice device, VkPipelineCache pipelineCache, const std::vector<GraphicsPipelineDesc>& descs) {
+	std::vector<CompiledPipeline> compiled;
+	compiled.reserve(descs.size());
+
+	for (const auto& desc : descs) {
+		compiled.push_back(buildGraphicsPipeline(device, pipelineCache, desc));
+	}
+
+	return compiled;
+}
+
+uint64_t GraphicsPipelineDesc::key() const {
+	uint64_t value = FNV_OFFSET_BASIS;
+
+	for (const auto& stage : stages) {
+		value = fnv1a(&stage.stage, sizeof(stage.stage), value);
+		value = fnv1a(stage.codeData(), stage.codeSize(), value);
+		value = fnv1a(stage.entryPoint.c_str(), stage.entryPoint.size() + 1, value);
+		value = fnv1a(stage.specialization.entries.data(), stage.specialization.entries.size() * sizeof(VkSpecializationMapEntry), value);
+		value = fnv1a(stage.specialization.data.data(), stage.specialization.data.size(), value);
+	}
+
+	value = fnv1a(&subpass, sizeof(subpass), value);
+	value = fnv1a(vertexBindings.data(), vertexBindings.size() * sizeof(VkVertexInputBindingDescription), value); // plain 32 bit members, no padding to hash
+	value = fnv1a(vertexAttributes.data(), vertexAttributes.size() * sizeof(VkVertexInputAttributeDescription), value);
+	value = fnv1a(colorAttachmentFormats.data(), colorAttachmentFormats.size() * sizeof(VkFormat), value);
+	FixedFunctionState baked = bakedState(state, dynamicState); // materials that only differ in dynamic fields get the same key, and with it the same pipeline
+	value = fnv1a(&baked, sizeof(baked), value);
+	value = fnv1a(&dynamicState, sizeof(dynamicState), value);
+	value = fnv1a(&flags, sizeof(flags), value);
+
+	return value;
+}
+
+void PipelineCompiler::create(VkDevice device, VkPipelineCache pipelineCache, uint32_t threadCount) {
+	this->device = device;
+	this->pipelineCache = pipelineCache;
+	threadPool = std::make_unique<ThreadPool>(threadCount);
+}
+
+void PipelineCompiler::destroy() {
+	threadPool.reset(); // runs the queued compilations to the end and joins the workers
+}
+
+std::future<std::vector<CompiledPipeline>> PipelineCompiler::submit(std::vector<GraphicsPipelineDesc> descs) {
+	return threadPool->submit([device = device, pipelineCache = pipelineCache, descs = std::move(descs)]() {
+		return buildGraphicsPipelines(device, pipelineCache, descs);
+	});
+}
+
+std::future<std::vector<CompiledPipeline>> PipelineCompiler::submit(std::function<std::vector<GraphicsPipelineDesc>()> describe) {
+	return threadPool->submit([device = device, pipelineCache = pipelineCache, describe = std::move(describe)]() {
+		return buildGraphicsPipelines(device, pipelineCache, describe());
+	});
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "extended_dynamic_state.h"
+#include "shader_reflection.h"
+#include "specialization_constants.h"
+#include "thread_pool.h"
+
+// pipeline compilation off the main thread: a GraphicsPipelineDesc owns everything needed to build the pipeline (SPIR-V included), so it can be handed to a worker
+// the caller gets a future back and keeps drawing with a fallback pipeline until the result is ready
+// vkCreateGraphicsPipelines may be called from several threads with the same VkPipelineCache, the cache is internally synchronized
+
+struct ShaderStageDesc {
+	VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+	std::vector<uint32_t> code; // SPIR-V words
+	std::string entryPoint = "main";
+	SpecializationData specialization; // empty: every constant keeps its default from the shader
+	ShaderReflection reflection; // what the module expects from the layout, merged over the stages to get GraphicsPipelineDesc::layout
+	const uint32_t* mappedCode = nullptr; // instead of code: SPIR-V inside a mapped ShaderBundle, which has to outlive the compilation
+	size_t mappedCodeSize = 0; // bytes
+
+	const uint32_t* codeData() const { return mappedCode != nullptr ? mappedCode : code.data(); }
+	size_t codeSize() const { return mappedCode != nullptr ? mappedCodeSize : code.size() * sizeof(uint32_t); } // bytes, what VkShaderModuleCreateInfo takes
+};
+
+struct GraphicsPipelineDesc {
+	std::vector<ShaderStageDesc> stages;
+	VkPipelineLayout layout = VK_NULL_HANDLE; // owned by the caller, has to outlive the compilation
+	VkRenderPass renderPass = VK_NULL_HANDLE; // same; VK_NULL_HANDLE for dynamic rendering
+	std::vector<VkFormat> colorAttachmentFormats; // dynamic rendering only, passed in VkPipelineRenderingCreateInfo
+	uint32_t subpass = 0;
+	std::vector<VkVertexInputBindingDescription> vertexBindings; // e.g. vertexBindingDescription<Vertex>(0), see vertex_layout.h
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+	FixedFunctionState state; // cull mode, topology, depth and blend state of the material
+	DynamicStateFlags dynamicState = 0; // fields of state that are set while recording instead (viewport and scissor are always dynamic), their values here are ignored
+	VkPipelineCreateFlags flags = 0; // e.g. VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT for a quick fallback pipeline
+
+	uint64_t key() const; // identifies the variant across runs: hashes the SPIR-V, specialization constants and the baked fixed function state, not the layout and render pass handles
+};
+
+struct CompiledPipeline {
+	VkResult result = VK_NOT_READY; // errors are returned instead of thrown, the main thread decides what to do with them
+	VkPipeline pipeline = VK_NULL_HANDLE; // owned by whoever takes the result
+	VkPipelineLayout layout = VK_NULL_HANDLE; // GraphicsPipelineDesc::layout, needed to bind descriptor sets and push constants for this pipeline
+	uint64_t key = 0; // GraphicsPipelineDesc::key() of the description it was built from
+	double compileMs = 0.0;
+};
+
+// builds the pipeline on the calling thread
+CompiledPipeline buildGraphicsPipeline(VkDevice device, VkPipelineCache pipelineCache, const GraphicsPipelineDesc& desc);
+std::vector<CompiledPipeline> buildGraphicsPipelines(VkDevice device, VkPipelineCache pipelineCache, const std::vector<GraphicsPipelineDesc>& descs); // one after the other, in the order of descs
+
+class PipelineCompiler {
+public:
+	void create(VkDevice device, VkPipelineCache pipelineCache, uint32_t threadCount);
+	void destroy(); // waits for the compilations still running, their pipelines still belong to the holders of the futures
+
+	bool enabled() const { return threadPool != nullptr; }
+
+	// a set of pipelines is built by one worker and handed over together (e.g. every variant of the scene's materials), so the caller never mixes pipelines of two builds
+	std::future<std::vector<CompiledPipeline>> submit(std::vector<GraphicsPipelineDesc> descs);
+	std::future<std::vector<CompiledPipeline>> submit(std::function<std::vector<GraphicsPipelineDesc>()> describe); // describe runs on the worker too (e.g. compiles the shaders first), an exception it throws ends up in the future
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	std::unique_ptr<ThreadPool> threadPool;
+};
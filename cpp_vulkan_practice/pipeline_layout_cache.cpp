@@ -0,0 +1,142 @@
+#include "pipeline_layout_cache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "hash.h"
+
+void PipelineLayoutCache::create(VkDevice device) {
+	this->device = device;
+}
+
+void PipelineLayoutCache::destroy() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (const auto& [key, layout] : pipelineLayouts) { // pipeline layouts first, they were created from the set layouts
+		vkDestroyPipelineLayout(device, layout, nullptr);
+	}
+	pipelineLayouts.clear();
+
+	for (const auto& [key, layout] : setLayouts) {
+		vkDestroyDescriptorSetLayout(device, layout, nullptr);
+	}
+	setLayouts.clear();
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::descriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+	std::lock_guard<std::mutex> lock(mutex);
+	return findOrCreateSetLayout(bindings);
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::findOrCreateSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+	std::vector<VkDescriptorSetLayoutBinding> sorted = bindings; // the order of the bindings doesn't change the layout
+	std::sort(sorted.begin(), sorted.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+		return a.binding < b.binding;
+	});
+
+	Key key;
+	for (const auto& binding : sorted) {
+		key.push_back(binding.binding);
+		key.push_back(binding.descriptorType);
+		key.push_back(binding.descriptorCount);
+		key.push_back(binding.stageFlags);
+	}
+
+	auto known = setLayouts.find(key);
+	if (known != setLayouts.end()) {
+		return known->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo descriptor_set_layout_info = {};
+	descriptor_set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptor_set_layout_info.bindingCount = static_cast<uint32_t>(sorted.size());
+	descriptor_set_layout_info.pBindings = sorted.data();
+
+	VkDescriptorSetLayout setLayout;
+	if (vkCreateDescriptorSetLayout(device, &descriptor_set_layout_info, nullptr, &setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create descriptor set layout.");
+	}
+
+	setLayouts.emplace(std::move(key), setLayout);
+	return setLayout;
+}
+
+VkPipelineLayout PipelineLayoutCache::pipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// the set layouts are already unique, so their handles identify them
+
+	Key key;
+	key.push_back(setLayouts.size());
+	for (auto setLayout : setLayouts) {
+		key.push_back(reinterpret_cast<uint64_t>(setLayout));
+	}
+	for (const auto& range : pushConstantRanges) {
+		key.push_back(range.stageFlags);
+		key.push_back(range.offset);
+		key.push_back(range.size);
+	}
+
+	auto known = pipelineLayouts.find(key);
+	if (known != pipelineLayouts.end()) {
+		return known->second;
+	}
+
+	VkPipelineLayoutCreateInfo pipeline_layout_info = {};
+	pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipeline_layout_info.pSetLayouts = setLayouts.data();
+	pipeline_layout_info.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+	pipeline_layout_info.pPushConstantRanges = pushConstantRanges.data();
+
+	VkPipelineLayout layout;
+	if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &layout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline layout.");
+	}
+
+	pipelineLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+VkPipelineLayout PipelineLayoutCache::pipelineLayout(const ShaderReflection& reflection) {
+	uint32_t setCount = 0;
+	for (const auto& binding : reflection.bindings) {
+		setCount = (std::max)(setCount, binding.set + 1);
+	}
+
+	std::vector<std::vector<VkDescriptorSetLayoutBinding>> setBindings(setCount);
+	for (const auto& binding : reflection.bindings) {
+		VkDescriptorSetLayoutBinding layout_binding = {};
+		layout_binding.binding = binding.binding;
+		layout_binding.descriptorType = binding.descriptorType;
+		layout_binding.descriptorCount = binding.descriptorCount;
+		layout_binding.stageFlags = binding.stageFlags;
+		layout_binding.pImmutableSamplers = nullptr;
+		setBindings[binding.set].push_back(layout_binding);
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (const auto& bindings : setBindings) {
+			setLayouts.push_back(findOrCreateSetLayout(bindings));
+		}
+	}
+
+	return pipelineLayout(setLayouts, reflection.pushConstantRanges);
+}
+
+size_t PipelineLayoutCache::descriptorSetLayoutCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return setLayouts.size();
+}
+
+size_t PipelineLayoutCache::pipelineLayoutCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return pipelineLayouts.size();
+}
+
+size_t PipelineLayoutCache::KeyHash::operator()(const Key& key) const {
+	return static_cast<size_t>(fnv1a(key.data(), key.size() * sizeof(uint64_t)));
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "shader_reflection.h"
+
+// hash-consed descriptor set layouts and pipeline layouts: asking twice for the same layout returns the same handle
+// pipelines made from the same interface share their layouts, which also makes them compatible for binding descriptor sets and push constants
+// the handles live until destroy(), a hot reload that changes the interface just adds new ones; safe to use from pipeline compiler workers
+
+class PipelineLayoutCache {
+public:
+	void create(VkDevice device);
+	void destroy();
+
+	VkDescriptorSetLayout descriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings); // no immutable samplers
+	VkPipelineLayout pipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+	VkPipelineLayout pipelineLayout(const ShaderReflection& reflection); // from the merged reflection of every stage, a set number the shaders skip gets an empty set layout
+
+	size_t descriptorSetLayoutCount();
+	size_t pipelineLayoutCount();
+
+private:
+	using Key = std::vector<uint64_t>; // every field that goes into the create info, the handles of the set layouts included
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
+	};
+
+	VkDescriptorSetLayout findOrCreateSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings); // callers hold the mutex
+
+	VkDevice device = VK_NULL_HANDLE;
+	std::mutex mutex;
+	std::unordered_map<Key, VkDescriptorSetLayout, KeyHash> setLayouts;
+	std::unordered_map<Key, VkPipelineLayout, KeyHash> pipelineLayouts;
+};
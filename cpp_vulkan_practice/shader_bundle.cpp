@@ -0,0 +1,176 @@
+#include "shader_bundle.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "cpu_profiler.h"
+
+const uint32_t SHADER_BUNDLE_CODE_ALIGNMENT = sizeof(uint32_t); // SPIR-V is read as 32 bit words
+
+ShaderBundle::~ShaderBundle() {
+	close();
+}
+
+bool ShaderBundle::open(const std::string& path) {
+	CPU_PROFILE_SCOPE("open shader bundle");
+
+	close();
+
+	if (!mapping.open(path)) {
+		return false;
+	}
+
+	data = mapping.data();
+	size = mapping.size();
+
+	if (!validate()) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void ShaderBundle::close() {
+	index.clear();
+
+	if (data == nullptr) {
+		return;
+	}
+
+	mapping.close();
+
+	data = nullptr;
+	size = 0;
+}
+
+bool ShaderBundle::validate() {
+	ShaderBundleHeader header;
+
+	if (size < sizeof(header)) {
+		return false;
+	}
+
+	std::memcpy(&header, data, sizeof(header));
+
+	if (header.magic != SHADER_BUNDLE_MAGIC || header.version != SHADER_BUNDLE_VERSION) {
+		return false;
+	}
+
+	if (header.entryCount > (size - sizeof(header)) / sizeof(ShaderBundleEntry)) {
+		return false;
+	}
+
+	auto inside = [this](uint64_t offset, uint64_t length) {
+		return offset + length <= size;
+	};
+
+	const ShaderBundleEntry* entries = reinterpret_cast<const ShaderBundleEntry*>(data + sizeof(header)); // the header is 16 bytes, the entries are aligned
+
+	for (uint32_t i = 0; i < header.entryCount; i++) {
+		const ShaderBundleEntry& entry = entries[i];
+
+		if (!inside(entry.nameOffset, entry.nameSize) || !inside(entry.codeOffset, entry.codeSize) || !inside(entry.reflectionOffset, entry.reflectionSize)) {
+			return false;
+		}
+
+		if (entry.codeOffset % SHADER_BUNDLE_CODE_ALIGNMENT != 0 || entry.codeSize % sizeof(uint32_t) != 0 || entry.codeSize == 0) {
+			return false;
+		}
+
+		index[std::string(reinterpret_cast<const char*>(data + entry.nameOffset), entry.nameSize)] = &entry;
+	}
+
+	return true;
+}
+
+const ShaderBundleEntry* ShaderBundle::find(const std::string& name) const {
+	auto entry = index.find(name);
+	return entry != index.end() ? entry->second : nullptr;
+}
+
+ShaderReflection ShaderBundle::reflection(const ShaderBundleEntry& entry) const {
+	ShaderReflection reflection;
+
+	if (!deserializeReflection(reinterpret_cast<const char*>(data + entry.reflectionOffset), entry.reflectionSize, reflection)) {
+		throw std::runtime_error("Invalid reflection data in shader bundle.");
+	}
+
+	return reflection;
+}
+
+void ShaderBundle::write(const std::string& path, const std::vector<ShaderBundleShader>& shaders) {
+	ShaderBundleHeader header;
+	header.entryCount = static_cast<uint32_t>(shaders.size());
+
+	std::vector<ShaderBundleEntry> entries(shaders.size());
+	std::vector<std::vector<char>> reflections;
+	std::vector<char> names;
+
+	// offsets first: header, entries and names, then the blobs
+
+	for (size_t i = 0; i < shaders.size(); i++) {
+		entries[i].nameOffset = static_cast<uint32_t>(names.size()); // relative to the names for now
+		entries[i].nameSize = static_cast<uint32_t>(shaders[i].name.size());
+		entries[i].stage = shaders[i].stage;
+		names.insert(names.end(), shaders[i].name.begin(), shaders[i].name.end());
+		reflections.push_back(serializeReflection(shaders[i].reflection));
+	}
+
+	size_t offset = sizeof(header) + entries.size() * sizeof(ShaderBundleEntry);
+	for (auto& entry : entries) {
+		entry.nameOffset += static_cast<uint32_t>(offset);
+	}
+	offset += names.size();
+
+	auto align = [](size_t value) {
+		return (value + SHADER_BUNDLE_CODE_ALIGNMENT - 1) / SHADER_BUNDLE_CODE_ALIGNMENT * SHADER_BUNDLE_CODE_ALIGNMENT;
+	};
+
+	for (size_t i = 0; i < shaders.size(); i++) {
+		offset = align(offset);
+		entries[i].codeOffset = static_cast<uint32_t>(offset);
+		entries[i].codeSize = static_cast<uint32_t>(shaders[i].code.size() * sizeof(uint32_t));
+		offset += entries[i].codeSize;
+
+		entries[i].reflectionOffset = static_cast<uint32_t>(offset);
+		entries[i].reflectionSize = static_cast<uint32_t>(reflections[i].size());
+		offset += reflections[i].size();
+	}
+
+	// written next to the old file and renamed over it, a half written bundle is never opened
+
+	std::string tempPath = path + ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			throw std::runtime_error("Failed to write shader bundle " + path + ".");
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ShaderBundleEntry));
+		file.write(names.data(), names.size());
+
+		for (size_t i = 0; i < shaders.size(); i++) {
+			static const char padding[SHADER_BUNDLE_CODE_ALIGNMENT] = {};
+			file.write(padding, entries[i].codeOffset - static_cast<uint32_t>(file.tellp()));
+			file.write(reinterpret_cast<const char*>(shaders[i].code.data()), entries[i].codeSize);
+			file.write(reflections[i].data(), reflections[i].size());
+		}
+
+		if (!file.good()) {
+			throw std::runtime_error("Failed to write shader bundle " + path + ".");
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+
+	if (error) {
+		std::filesystem::remove(tempPath, error);
+		throw std::runtime_error("Failed to write shader bundle " + path + ".");
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+#include "shader_reflection.h"
+
+// all shaders of the application packed into one file, memory mapped on startup
+// vkCreateShaderModule reads the SPIR-V straight from the mapping: one open and one map instead of an open, a read and an allocation per module
+//
+// layout: ShaderBundleHeader, entryCount ShaderBundleEntry, the names, then per shader its SPIR-V (4 byte aligned) and its serialized reflection
+// the offsets are from the start of the file, the mapping starts on a page boundary so an aligned offset is an aligned pointer
+
+const uint32_t SHADER_BUNDLE_MAGIC = 0x4e424853; // "SHBN"
+const uint32_t SHADER_BUNDLE_VERSION = 1;
+
+struct ShaderBundleHeader {
+	uint32_t magic = SHADER_BUNDLE_MAGIC;
+	uint32_t version = SHADER_BUNDLE_VERSION;
+	uint32_t entryCount = 0;
+	uint32_t reserved = 0;
+};
+
+struct ShaderBundleEntry {
+	uint32_t nameOffset = 0;
+	uint32_t nameSize = 0;
+	VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+	uint32_t codeOffset = 0; // multiple of 4
+	uint32_t codeSize = 0; // bytes
+	uint32_t reflectionOffset = 0;
+	uint32_t reflectionSize = 0;
+	uint32_t reserved = 0;
+};
+
+struct ShaderBundleShader { // input of ShaderBundle::write
+	std::string name; // what find() looks it up by, e.g. the source path
+	VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+	std::vector<uint32_t> code; // SPIR-V words
+	ShaderReflection reflection;
+};
+
+class ShaderBundle {
+public:
+	ShaderBundle() = default;
+	ShaderBundle(const ShaderBundle&) = delete; // owns the mapping
+	ShaderBundle& operator=(const ShaderBundle&) = delete;
+	~ShaderBundle();
+
+	bool open(const std::string& path); // false if the file is missing or not a valid bundle
+	void close(); // pointers from code() are invalid afterwards
+
+	bool isOpen() const { return data != nullptr; }
+	size_t shaderCount() const { return index.size(); }
+
+	const ShaderBundleEntry* find(const std::string& name) const; // nullptr if the bundle has no such shader
+	const uint32_t* code(const ShaderBundleEntry& entry) const { return reinterpret_cast<const uint32_t*>(data + entry.codeOffset); } // entry.codeSize bytes, inside the mapping
+	ShaderReflection reflection(const ShaderBundleEntry& entry) const;
+
+	static void write(const std::string& path, const std::vector<ShaderBundleShader>& shaders); // throws if the file can't be written
+
+private:
+	bool validate(); // checks every offset against the file size before anything is read through it
+
+	MappedFile mapping;
+	const uint8_t* data = nullptr; // mapping.data(), while open
+	size_t size = 0;
+	std::unordered_map<std::string, const ShaderBundleEntry*> index; // name -> entry inside the mapping
+};
@@ -0,0 +1,365 @@
+#include "shader_compiler.h"
+
+#include <shaderc/shaderc.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include "cpu_profiler.h"
+#include "hash.h"
+
+const uint32_t SPIRV_MAGIC = 0x07230203;
+const shaderc_env_version SHADER_TARGET_ENVIRONMENT = shaderc_env_version_vulkan_1_2; // the minimum device version (isDeviceSuitable), not the instance's 1.3: the SPIR-V has to run on 1.2 devices too
+
+static bool readTextFile(const std::string& path, std::string& text) {
+	std::ifstream file(path, std::ios::binary);
+
+	if (!file.is_open()) {
+		return false;
+	}
+
+	std::ostringstream content;
+	content << file.rdbuf();
+	text = content.str();
+	return true;
+}
+
+static std::string resolveInclude(const std::string& requestedSource, const std::string& requestingSource) { // relative to the including file, for "..." and <...> alike
+	return (std::filesystem::path(requestingSource).parent_path() / requestedSource).lexically_normal().generic_string();
+}
+
+static std::vector<std::string> includeDirectives(const std::string& source) { // the names of every #include line, whether it is inside an #if or not (a few extra files in the hash don't hurt)
+	std::vector<std::string> includes;
+	std::istringstream lines(source);
+	std::string line;
+
+	while (std::getline(lines, line)) {
+		size_t position = line.find_first_not_of(" \t");
+		if (position == std::string::npos || line[position] != '#') {
+			continue;
+		}
+
+		position = line.find_first_not_of(" \t", position + 1);
+		if (position == std::string::npos || line.compare(position, 7, "include") != 0) {
+			continue;
+		}
+
+		size_t begin = line.find_first_of("\"<", position + 7);
+		if (begin == std::string::npos) {
+			continue;
+		}
+
+		size_t end = line.find(line[begin] == '"' ? '"' : '>', begin + 1);
+		if (end != std::string::npos) {
+			includes.push_back(line.substr(begin + 1, end - begin - 1));
+		}
+	}
+
+	return includes;
+}
+
+static uint64_t hashSourceTree(const std::string& path, uint64_t value, std::set<std::string>& visited) { // the file and, depth first, everything it includes
+	if (!visited.insert(path).second) {
+		return value;
+	}
+
+	std::string source;
+	if (!readTextFile(path, source)) { // a missing include only fails the compile, the hash just has to differ from the one where it exists
+		return fnv1a("missing", 8, value);
+	}
+
+	value = fnv1a(source.data(), source.size(), value);
+
+	for (const auto& include : includeDirectives(source)) {
+		value = hashSourceTree(resolveInclude(include, path), value, visited);
+	}
+
+	return value;
+}
+
+static shaderc_shader_kind shaderKind(VkShaderStageFlagBits stage) {
+	switch (stage) {
+	case VK_SHADER_STAGE_VERTEX_BIT: return shaderc_vertex_shader;
+	case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT: return shaderc_tess_control_shader;
+	case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT: return shaderc_tess_evaluation_shader;
+	case VK_SHADER_STAGE_GEOMETRY_BIT: return shaderc_geometry_shader;
+	case VK_SHADER_STAGE_FRAGMENT_BIT: return shaderc_fragment_shader;
+	case VK_SHADER_STAGE_COMPUTE_BIT: return shaderc_compute_shader;
+	default: throw std::runtime_error("Unsupported shader stage.");
+	}
+}
+
+// resolves #include for shaderc, the included files are read the same way hashSourceTree reads them
+
+class FileIncluder : public shaderc::CompileOptions::IncluderInterface {
+public:
+	shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type, const char* requestingSource, size_t) override {
+		auto include = new Include;
+		include->name = resolveInclude(requestedSource, requestingSource);
+
+		if (!readTextFile(include->name, include->content)) { // an empty source name tells shaderc the include failed, the content is the error message
+			include->content = "Cannot open include file " + include->name;
+			include->name.clear();
+		}
+
+		include->result = { include->name.c_str(), include->name.size(), include->content.c_str(), include->content.size(), include };
+		return &include->result;
+	}
+
+	void ReleaseInclude(shaderc_include_result* data) override {
+		delete static_cast<Include*>(data->user_data);
+	}
+
+private:
+	struct Include {
+		std::string name;
+		std::string content;
+		shaderc_include_result result;
+	};
+};
+
+void ShaderCompiler::create(const std::string& cacheDirectory, uint32_t threadCount) {
+	this->cacheDirectory = cacheDirectory;
+
+	if (!cacheDirectory.empty()) {
+		std::error_code error;
+		std::filesystem::create_directories(cacheDirectory, error);
+
+		if (error) {
+			std::cerr << "shader cache: failed to create " << cacheDirectory << ": " << error.message() << ", compiling without a cache" << std::endl;
+			this->cacheDirectory.clear();
+		}
+	}
+
+	threadPool = std::make_unique<ThreadPool>((std::max)(threadCount, 1u));
+}
+
+void ShaderCompiler::destroy() {
+	threadPool.reset();
+}
+
+std::vector<ShaderCompileResult> ShaderCompiler::compile(const std::vector<ShaderCompileRequest>& requests) {
+	CPU_PROFILE_SCOPE("compile shaders");
+
+	std::vector<ShaderCompileResult> results(requests.size());
+	std::vector<std::future<ShaderCompileResult>> pending(requests.size());
+	std::unordered_map<uint64_t, size_t> compiledBy; // misses with the same hash are compiled once
+
+	// hashing and cache lookups are cheap, they stay on this thread; only the misses go to the workers
+
+	for (size_t i = 0; i < requests.size(); i++) {
+		results[i].hash = hashRequest(requests[i]);
+
+		if (readCache(results[i].hash, results[i].code)) {
+			if (!readReflectionCache(results[i].hash, results[i].reflection)) { // an entry written before reflection was cached, or a damaged one
+				results[i].reflection = reflectShader(results[i].code, requests[i].stage);
+				std::vector<char> reflection = serializeReflection(results[i].reflection);
+				writeCacheFile(cachePath(results[i].hash, ".refl"), reflection.data(), reflection.size());
+			}
+
+			results[i].cacheHit = true;
+			hits++;
+			continue;
+		}
+
+		if (compiledBy.count(results[i].hash) > 0) {
+			continue;
+		}
+
+		compiledBy[results[i].hash] = i;
+		misses++;
+
+		pending[i] = threadPool->submit([request = requests[i]]() {
+			return compileRequest(request);
+		});
+	}
+
+	for (size_t i = 0; i < requests.size(); i++) {
+		if (!pending[i].valid()) {
+			continue;
+		}
+
+		uint64_t hash = results[i].hash;
+		results[i] = pending[i].get(); // rethrows the compile error
+		results[i].hash = hash;
+
+		std::vector<char> reflection = serializeReflection(results[i].reflection);
+		writeCacheFile(cachePath(hash, ".spv"), results[i].code.data(), results[i].code.size() * sizeof(uint32_t));
+		writeCacheFile(cachePath(hash, ".refl"), reflection.data(), reflection.size()); // after the SPIR-V: a reader that finds the reflection also finds the module
+	}
+
+	for (size_t i = 0; i < requests.size(); i++) { // duplicates of a miss share its SPIR-V and reflection
+		if (!results[i].cacheHit && results[i].code.empty()) {
+			results[i].code = results[compiledBy[results[i].hash]].code;
+			results[i].reflection = results[compiledBy[results[i].hash]].reflection;
+		}
+
+		results[i].instructionCount = countSpirvInstructions(results[i].code);
+	}
+
+	return results;
+}
+
+uint64_t ShaderCompiler::hashRequest(const ShaderCompileRequest& request) const {
+	if (!std::filesystem::exists(request.path)) {
+		throw std::runtime_error("Failed to open shader source " + request.path + ".");
+	}
+
+	uint64_t value = fnv1a(&SHADER_CACHE_VERSION, sizeof(SHADER_CACHE_VERSION));
+	value = fnv1a(&SHADER_TARGET_ENVIRONMENT, sizeof(SHADER_TARGET_ENVIRONMENT), value);
+	value = fnv1a(&request.stage, sizeof(request.stage), value);
+
+	for (const auto& [name, definition] : request.defines) {
+		value = fnv1a(name.c_str(), name.size() + 1, value); // with the terminator, so ("AB", "") and ("A", "B") differ
+		value = fnv1a(definition.c_str(), definition.size() + 1, value);
+	}
+
+	value = fnv1a(&request.optimization, sizeof(request.optimization), value);
+	value = fnv1a(request.frozenConstants.entries.data(), request.frozenConstants.entries.size() * sizeof(VkSpecializationMapEntry), value);
+	value = fnv1a(request.frozenConstants.data.data(), request.frozenConstants.data.size(), value);
+
+	std::set<std::string> visited;
+	return hashSourceTree(std::filesystem::path(request.path).lexically_normal().generic_string(), value, visited);
+}
+
+std::vector<std::string> ShaderCompiler::sourceFiles(const ShaderCompileRequest& request) const {
+	std::set<std::string> visited;
+	hashSourceTree(std::filesystem::path(request.path).lexically_normal().generic_string(), FNV_OFFSET_BASIS, visited);
+
+	return std::vector<std::string>(visited.begin(), visited.end());
+}
+
+ShaderCompileResult ShaderCompiler::compileRequest(const ShaderCompileRequest& request) {
+	CPU_PROFILE_SCOPE("compile shader");
+
+	ShaderCompileResult result;
+	auto compileStart = std::chrono::steady_clock::now();
+
+	std::string source;
+	if (!readTextFile(request.path, source)) {
+		throw std::runtime_error("Failed to open shader source " + request.path + ".");
+	}
+
+	shaderc::CompileOptions options;
+	options.SetSourceLanguage(shaderc_source_language_glsl);
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, SHADER_TARGET_ENVIRONMENT);
+	options.SetOptimizationLevel(shaderc_optimization_level_zero); // same output as glslc without -O, the spirv-tools stage (optimizeShader) does the optimizing
+	options.SetIncluder(std::make_unique<FileIncluder>());
+
+	for (const auto& [name, definition] : request.defines) {
+		options.AddMacroDefinition(name, definition);
+	}
+
+	shaderc::Compiler compiler; // one per compile, a compiler is cheap and nothing is shared between the workers
+	shaderc::SpvCompilationResult module = compiler.CompileGlslToSpv(source, shaderKind(request.stage), request.path.c_str(), options);
+
+	if (module.GetCompilationStatus() != shaderc_compilation_status_success) {
+		throw std::runtime_error("Failed to compile shader " + request.path + ":\n" + module.GetErrorMessage());
+	}
+
+	result.code.assign(module.cbegin(), module.cend());
+	result.unoptimizedInstructionCount = countSpirvInstructions(result.code);
+	result.code = optimizeShader(result.code, request.optimization, request.frozenConstants);
+	result.reflection = reflectShader(result.code, request.stage); // after optimizing: a binding that only dead code used is gone from the layout too
+	result.compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compileStart).count();
+	return result;
+}
+
+bool ShaderCompiler::readCache(uint64_t hash, std::vector<uint32_t>& code) const {
+	std::vector<char> data;
+	if (!readCacheFile(cachePath(hash, ".spv"), data)) {
+		return false;
+	}
+
+	// a truncated or foreign file is treated as a miss and overwritten
+
+	if (data.size() < 5 * sizeof(uint32_t) || data.size() % sizeof(uint32_t) != 0) {
+		return false;
+	}
+
+	code.resize(data.size() / sizeof(uint32_t));
+	std::memcpy(code.data(), data.data(), data.size()); // the bytes of the file into words, the char buffer has no alignment for uint32_t reads
+
+	if (code[0] != SPIRV_MAGIC) {
+		code.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool ShaderCompiler::readReflectionCache(uint64_t hash, ShaderReflection& reflection) const {
+	std::vector<char> data;
+	return readCacheFile(cachePath(hash, ".refl"), data) && deserializeReflection(data.data(), data.size(), reflection);
+}
+
+bool ShaderCompiler::readCacheFile(const std::string& path, std::vector<char>& data) const {
+	if (cacheDirectory.empty()) {
+		return false;
+	}
+
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		return false;
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	data.resize(fileSize);
+
+	file.seekg(0);
+	file.read(data.data(), fileSize);
+
+	if (!file) {
+		data.clear();
+		return false;
+	}
+
+	return true;
+}
+
+void ShaderCompiler::writeCacheFile(const std::string& path, const void* data, size_t size) const {
+	if (cacheDirectory.empty()) {
+		return;
+	}
+
+	std::string tempPath = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())); // two hot reloads may write the same entry at once
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write(static_cast<const char*>(data), size);
+
+		if (!file.good()) {
+			std::cerr << "shader cache: failed to write " << tempPath << std::endl;
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error); // a concurrent reader sees the old file or the complete new one
+
+	if (error) {
+		std::cerr << "shader cache: failed to replace " << path << ": " << error.message() << std::endl;
+		std::filesystem::remove(tempPath, error);
+	}
+}
+
+std::string ShaderCompiler::cachePath(uint64_t hash, const char* extension) const {
+	std::ostringstream name;
+	name << std::hex;
+	name.width(16);
+	name.fill('0');
+	name << hash;
+
+	return (std::filesystem::path(cacheDirectory) / (name.str() + extension)).string();
+}
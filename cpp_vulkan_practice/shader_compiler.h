@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "shader_optimizer.h"
+#include "shader_reflection.h"
+#include "thread_pool.h"
+
+// in-process GLSL -> SPIR-V compilation with shaderc, replacing the offline shaders/compile.sh (compile.bat) step
+// the SPIR-V is cached on disk, content addressed: the file name is a hash over the source, every file it includes, the defines, the stage and the target environment
+// a repeated launch only reads and hashes the sources, a changed include or define gives a new hash and a compile; misses of one batch are compiled in parallel
+// the reflection of every module is cached next to it (<hash>.refl), a cache hit doesn't parse the SPIR-V either
+
+const uint32_t SHADER_CACHE_VERSION = 1; // part of every hash, bump it when the compile options change so old cache entries are not used anymore
+
+struct ShaderCompileRequest {
+	std::string path; // GLSL source file, #include "..." is resolved relative to the including file
+	VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+	std::vector<std::pair<std::string, std::string>> defines; // name, value
+	ShaderOptimization optimization = ShaderOptimization::None; // spirv-tools passes run on the shaderc output
+	SpecializationData frozenConstants; // baked into the module before it is optimized, see optimizeShader
+};
+
+struct ShaderCompileResult {
+	std::vector<uint32_t> code; // SPIR-V words
+	ShaderReflection reflection; // of the optimized module
+	uint64_t hash = 0; // cache key
+	uint32_t instructionCount = 0; // of code
+	uint32_t unoptimizedInstructionCount = 0; // what shaderc produced, 0 for cache hits (only the optimized module is cached)
+	bool cacheHit = false;
+	double compileMs = 0.0; // 0 for cache hits
+};
+
+class ShaderCompiler {
+public:
+	void create(const std::string& cacheDirectory, uint32_t threadCount); // empty cacheDirectory: compile every time
+	void destroy();
+
+	// blocks until every request is done; throws with the compiler output if a shader doesn't compile
+	std::vector<ShaderCompileResult> compile(const std::vector<ShaderCompileRequest>& requests);
+
+	std::vector<std::string> sourceFiles(const ShaderCompileRequest& request) const; // the source and every file it includes, e.g. to know which changes affect it
+
+	uint32_t cacheHits() const { return hits; }
+	uint32_t cacheMisses() const { return misses; }
+
+private:
+	uint64_t hashRequest(const ShaderCompileRequest& request) const; // reads the source and its includes, no compiling
+	static ShaderCompileResult compileRequest(const ShaderCompileRequest& request); // runs on a worker
+	bool readCache(uint64_t hash, std::vector<uint32_t>& code) const;
+	bool readReflectionCache(uint64_t hash, ShaderReflection& reflection) const;
+	bool readCacheFile(const std::string& path, std::vector<char>& data) const;
+	void writeCacheFile(const std::string& path, const void* data, size_t size) const;
+	std::string cachePath(uint64_t hash, const char* extension) const;
+
+	std::string cacheDirectory;
+	std::unique_ptr<ThreadPool> threadPool;
+	std::atomic<uint32_t> hits = 0; // compile() may be called from a pipeline compiler worker (hot reload)
+	std::atomic<uint32_t> misses = 0;
+};
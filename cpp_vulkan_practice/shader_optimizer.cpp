@@ -0,0 +1,99 @@
+#include "shader_optimizer.h"
+
+#include <spirv-tools/optimizer.hpp>
+
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "cpu_profiler.h"
+
+const uint32_t SPIRV_HEADER_WORDS = 5; // magic, version, generator, bound, schema
+const spv_target_env OPTIMIZER_TARGET_ENVIRONMENT = SPV_ENV_VULKAN_1_2; // same as the shader compiler's target
+
+const char* shaderOptimizationName(ShaderOptimization optimization) {
+	switch (optimization) {
+	case ShaderOptimization::Performance: return "performance";
+	case ShaderOptimization::Size: return "size";
+	default: return "none";
+	}
+}
+
+bool parseShaderOptimization(const std::string& name, ShaderOptimization& optimization) {
+	for (auto candidate : { ShaderOptimization::None, ShaderOptimization::Performance, ShaderOptimization::Size }) {
+		if (name == shaderOptimizationName(candidate)) {
+			optimization = candidate;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint32_t countSpirvInstructions(const std::vector<uint32_t>& code) {
+	size_t wordCount = code.size();
+	if (wordCount < SPIRV_HEADER_WORDS) {
+		return 0;
+	}
+
+	// every instruction starts with a word holding its length in words (high 16 bits) and its opcode (low 16 bits)
+
+	uint32_t count = 0;
+	for (size_t position = SPIRV_HEADER_WORDS; position < wordCount; count++) {
+		uint32_t instructionWords = code[position] >> 16;
+
+		if (instructionWords == 0) { // broken module, don't loop forever
+			return 0;
+		}
+
+		position += instructionWords;
+	}
+
+	return count;
+}
+
+std::vector<uint32_t> optimizeShader(const std::vector<uint32_t>& code, ShaderOptimization optimization, const SpecializationData& frozenConstants) {
+	CPU_PROFILE_SCOPE("optimize shader");
+
+	if (optimization == ShaderOptimization::None && frozenConstants.empty()) {
+		return code;
+	}
+
+	std::string messages;
+
+	spvtools::Optimizer optimizer(OPTIMIZER_TARGET_ENVIRONMENT);
+	optimizer.SetMessageConsumer([&messages](spv_message_level_t level, const char*, const spv_position_t&, const char* message) {
+		if (level <= SPV_MSG_ERROR) { // fatal, internal error and error
+			messages += std::string(message) + "\n";
+		}
+	});
+
+	// specialization first: the default values of the constants are replaced by the given ones and turned into plain constants, the passes below fold them
+
+	if (!frozenConstants.empty()) {
+		std::unordered_map<uint32_t, std::vector<uint32_t>> values; // constant id -> bit pattern, one word per 32 bits
+
+		for (const auto& entry : frozenConstants.entries) {
+			std::vector<uint32_t> bits((entry.size + sizeof(uint32_t) - 1) / sizeof(uint32_t), 0);
+			std::memcpy(bits.data(), frozenConstants.data.data() + entry.offset, entry.size);
+			values[entry.constantID] = bits;
+		}
+
+		optimizer.RegisterPass(spvtools::CreateSetSpecConstantDefaultValuePass(values));
+		optimizer.RegisterPass(spvtools::CreateFreezeSpecConstantValuePass());
+		optimizer.RegisterPass(spvtools::CreateFoldSpecConstantOpAndCompositePass());
+	}
+
+	switch (optimization) {
+	case ShaderOptimization::Performance: optimizer.RegisterPerformancePasses(); break;
+	case ShaderOptimization::Size: optimizer.RegisterSizePasses(); break;
+	default: optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass()); break; // freezing only: at least drop the branches that are dead now
+	}
+
+	std::vector<uint32_t> optimized;
+	if (!optimizer.Run(code.data(), code.size(), &optimized)) {
+		throw std::runtime_error("Failed to optimize shader:\n" + messages);
+	}
+
+	return optimized;
+}
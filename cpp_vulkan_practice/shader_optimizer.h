@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "specialization_constants.h"
+
+// SPIR-V optimization with spirv-tools, run by the shader compiler after GLSL -> SPIR-V (the result is cached with the module)
+// shaderc emits the code as written: every temporary goes through a variable, helper functions are calls, constants are not folded
+// the optimizer removes that before the driver sees it; a smaller module is parsed faster at pipeline creation and the driver compiler starts from tighter code
+
+enum class ShaderOptimization : uint32_t {
+	None,
+	Performance, // inlining, scalar replacement, constant propagation and folding, dead code elimination (spirv-opt -O)
+	Size // the same kind of passes, ordered and chosen for the smallest module (spirv-opt -Os)
+};
+
+const char* shaderOptimizationName(ShaderOptimization optimization);
+bool parseShaderOptimization(const std::string& name, ShaderOptimization& optimization); // "none", "performance", "size"
+
+uint32_t countSpirvInstructions(const std::vector<uint32_t>& code); // 0 for something that is not SPIR-V
+
+// frozenConstants: specialization constants baked into the module before optimizing, so whatever depends on them is folded like a literal
+// the frozen constants are regular constants afterwards, a VkSpecializationInfo for them has no effect anymore
+// throws with the optimizer's messages if the module is rejected
+std::vector<uint32_t> optimizeShader(const std::vector<uint32_t>& code, ShaderOptimization optimization, const SpecializationData& frozenConstants);
@@ -0,0 +1,231 @@
+#include "shader_reflection.h"
+
+#include <spirv_cross/spirv_cross.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+#include "cpu_profiler.h"
+
+const uint32_t REFLECTION_FILE_MAGIC = 0x4c464552; // "REFL"
+const uint32_t REFLECTION_FILE_VERSION = 1; // bump it when one of the reflected structs changes
+
+struct ReflectionFileHeader {
+	uint32_t magic = REFLECTION_FILE_MAGIC;
+	uint32_t version = REFLECTION_FILE_VERSION;
+	uint32_t bindingCount = 0;
+	uint32_t pushConstantRangeCount = 0;
+	uint32_t vertexInputCount = 0;
+};
+
+static uint32_t descriptorCount(const spirv_cross::Compiler& compiler, const spirv_cross::SPIRType& type) { // arrays of arrays are flattened into one binding
+	uint32_t count = 1;
+
+	for (size_t i = 0; i < type.array.size(); i++) {
+		uint32_t size = type.array[i];
+
+		if (!type.array_size_literal[i]) { // sized by a specialization constant, the layout uses its default value
+			size = compiler.get_constant(size).scalar();
+		}
+
+		if (size == 0) {
+			throw std::runtime_error("Runtime sized descriptor arrays are not supported.");
+		}
+
+		count *= size;
+	}
+
+	return count;
+}
+
+static VkFormat vertexInputFormat(const spirv_cross::SPIRType& type) {
+	static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+	static const VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+	static const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+	if (type.vecsize < 1 || type.vecsize > 4 || type.width != 32) {
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	switch (type.basetype) { // the format of the shader side, a vertex buffer may still store it smaller (e.g. R8G8B8A8_UNORM for a vec4)
+	case spirv_cross::SPIRType::Float: return floatFormats[type.vecsize - 1];
+	case spirv_cross::SPIRType::Int: return intFormats[type.vecsize - 1];
+	case spirv_cross::SPIRType::UInt: return uintFormats[type.vecsize - 1];
+	default: return VK_FORMAT_UNDEFINED;
+	}
+}
+
+ShaderReflection reflectShader(const std::vector<uint32_t>& code, VkShaderStageFlagBits stage) {
+	CPU_PROFILE_SCOPE("reflect shader");
+
+	spirv_cross::Compiler compiler(code.data(), code.size());
+	spirv_cross::ShaderResources resources = compiler.get_shader_resources(compiler.get_active_interface_variables()); // only what the entry point uses, a declared but unused binding doesn't need a descriptor
+
+	ShaderReflection reflection;
+
+	auto addBindings = [&](const spirv_cross::SmallVector<spirv_cross::Resource>& list, VkDescriptorType descriptorType, VkDescriptorType texelBufferType) {
+		for (const auto& resource : list) {
+			const spirv_cross::SPIRType& type = compiler.get_type(resource.type_id);
+
+			ReflectedBinding binding;
+			binding.set = compiler.get_decoration(resource.id, spv::DecorationDescriptorSet);
+			binding.binding = compiler.get_decoration(resource.id, spv::DecorationBinding);
+			binding.descriptorType = (type.basetype == spirv_cross::SPIRType::Image && type.image.dim == spv::DimBuffer) ? texelBufferType : descriptorType; // samplerBuffer / imageBuffer
+			binding.descriptorCount = descriptorCount(compiler, type);
+			binding.stageFlags = stage;
+			reflection.bindings.push_back(binding);
+		}
+	};
+
+	addBindings(resources.uniform_buffers, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+	addBindings(resources.storage_buffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	addBindings(resources.sampled_images, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	addBindings(resources.separate_images, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER);
+	addBindings(resources.separate_samplers, VK_DESCRIPTOR_TYPE_SAMPLER, VK_DESCRIPTOR_TYPE_SAMPLER);
+	addBindings(resources.storage_images, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER);
+	addBindings(resources.subpass_inputs, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT);
+	addBindings(resources.acceleration_structures, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR);
+
+	std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b) {
+		return std::tie(a.set, a.binding) < std::tie(b.set, b.binding);
+	});
+
+	// push constants: the range covers the members the shader reads, from the first to the end of the last
+
+	for (const auto& resource : resources.push_constant_buffers) {
+		auto ranges = compiler.get_active_buffer_ranges(resource.id);
+
+		if (ranges.empty()) {
+			continue;
+		}
+
+		size_t begin = ranges[0].offset;
+		size_t end = 0;
+
+		for (const auto& range : ranges) {
+			begin = (std::min)(begin, range.offset);
+			end = (std::max)(end, range.offset + range.range);
+		}
+
+		VkPushConstantRange push_constant_range = {};
+		push_constant_range.stageFlags = stage;
+		push_constant_range.offset = static_cast<uint32_t>(begin);
+		push_constant_range.size = static_cast<uint32_t>(end - begin);
+		reflection.pushConstantRanges.push_back(push_constant_range);
+	}
+
+	// vertex inputs (built-ins like gl_VertexIndex are listed separately and don't need a vertex attribute)
+
+	if (stage == VK_SHADER_STAGE_VERTEX_BIT) {
+		for (const auto& resource : resources.stage_inputs) {
+			const spirv_cross::SPIRType& type = compiler.get_type(resource.type_id);
+			uint32_t location = compiler.get_decoration(resource.id, spv::DecorationLocation);
+
+			for (uint32_t column = 0; column < type.columns; column++) {
+				reflection.vertexInputs.push_back({ location + column, vertexInputFormat(type) });
+			}
+		}
+
+		std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(), [](const ReflectedVertexInput& a, const ReflectedVertexInput& b) {
+			return a.location < b.location;
+		});
+	}
+
+	return reflection;
+}
+
+void ShaderReflection::merge(const ShaderReflection& other) {
+	for (const auto& binding : other.bindings) {
+		auto existing = std::find_if(bindings.begin(), bindings.end(), [&binding](const ReflectedBinding& candidate) {
+			return candidate.set == binding.set && candidate.binding == binding.binding;
+		});
+
+		if (existing == bindings.end()) {
+			bindings.push_back(binding);
+			continue;
+		}
+
+		if (existing->descriptorType != binding.descriptorType || existing->descriptorCount != binding.descriptorCount) {
+			throw std::runtime_error("Shader stages disagree on descriptor set " + std::to_string(binding.set) + " binding " + std::to_string(binding.binding) + ".");
+		}
+
+		existing->stageFlags |= binding.stageFlags;
+	}
+
+	std::sort(bindings.begin(), bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b) {
+		return std::tie(a.set, a.binding) < std::tie(b.set, b.binding);
+	});
+
+	// stages reading the same bytes share a range, everything else gets a range of its own (a stage may appear in one range only)
+
+	for (const auto& range : other.pushConstantRanges) {
+		auto existing = std::find_if(pushConstantRanges.begin(), pushConstantRanges.end(), [&range](const VkPushConstantRange& candidate) {
+			return candidate.offset == range.offset && candidate.size == range.size;
+		});
+
+		if (existing != pushConstantRanges.end()) {
+			existing->stageFlags |= range.stageFlags;
+		}
+		else {
+			pushConstantRanges.push_back(range);
+		}
+	}
+
+	vertexInputs.insert(vertexInputs.end(), other.vertexInputs.begin(), other.vertexInputs.end());
+}
+
+std::vector<char> serializeReflection(const ShaderReflection& reflection) {
+	ReflectionFileHeader header;
+	header.bindingCount = static_cast<uint32_t>(reflection.bindings.size());
+	header.pushConstantRangeCount = static_cast<uint32_t>(reflection.pushConstantRanges.size());
+	header.vertexInputCount = static_cast<uint32_t>(reflection.vertexInputs.size());
+
+	std::vector<char> data;
+	auto append = [&data](const void* source, size_t size) {
+		data.insert(data.end(), static_cast<const char*>(source), static_cast<const char*>(source) + size);
+	};
+
+	append(&header, sizeof(header));
+	append(reflection.bindings.data(), reflection.bindings.size() * sizeof(ReflectedBinding));
+	append(reflection.pushConstantRanges.data(), reflection.pushConstantRanges.size() * sizeof(VkPushConstantRange));
+	append(reflection.vertexInputs.data(), reflection.vertexInputs.size() * sizeof(ReflectedVertexInput));
+
+	return data;
+}
+
+bool deserializeReflection(const char* data, size_t size, ShaderReflection& reflection) {
+	ReflectionFileHeader header;
+
+	if (size < sizeof(header)) {
+		return false;
+	}
+
+	std::memcpy(&header, data, sizeof(header));
+
+	if (header.magic != REFLECTION_FILE_MAGIC || header.version != REFLECTION_FILE_VERSION) {
+		return false;
+	}
+
+	size_t expectedSize = sizeof(header) + header.bindingCount * sizeof(ReflectedBinding) + header.pushConstantRangeCount * sizeof(VkPushConstantRange) + header.vertexInputCount * sizeof(ReflectedVertexInput);
+	if (size != expectedSize) {
+		return false;
+	}
+
+	const char* position = data + sizeof(header);
+	auto read = [&position](auto& list, uint32_t count) {
+		list.resize(count);
+		if (count > 0) {
+			std::memcpy(list.data(), position, count * sizeof(list[0]));
+			position += count * sizeof(list[0]);
+		}
+	};
+
+	read(reflection.bindings, header.bindingCount);
+	read(reflection.pushConstantRanges, header.pushConstantRangeCount);
+	read(reflection.vertexInputs, header.vertexInputCount);
+
+	return true;
+}
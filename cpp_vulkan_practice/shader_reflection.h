@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// what a SPIR-V module expects from the pipeline layout and the vertex input state, read from the module itself with SPIRV-Cross
+// the stages of a pipeline are reflected one by one and merged, the merged result describes the pipeline layout (see PipelineLayoutCache)
+// the structs are plain data so the result can be cached on disk next to the SPIR-V (shader_compiler.cpp) instead of parsing the module on every start
+
+struct ReflectedBinding {
+	uint32_t set = 0;
+	uint32_t binding = 0;
+	VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uint32_t descriptorCount = 1; // array size, 1 for a single descriptor
+	VkShaderStageFlags stageFlags = 0;
+};
+
+struct ReflectedVertexInput { // one per location, a matrix input takes one location per column
+	uint32_t location = 0;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+};
+
+struct ShaderReflection {
+	std::vector<ReflectedBinding> bindings; // sorted by set, then binding
+	std::vector<VkPushConstantRange> pushConstantRanges; // the bytes the stages actually access, no two ranges share a stage
+	std::vector<ReflectedVertexInput> vertexInputs; // vertex stage only, sorted by location
+
+	// adds the resources of another stage; a binding both use must agree on type and count, otherwise it throws
+	void merge(const ShaderReflection& other);
+};
+
+// throws if the module is not valid SPIR-V or uses something a layout can't be made for (e.g. a runtime sized descriptor array)
+ShaderReflection reflectShader(const std::vector<uint32_t>& code, VkShaderStageFlagBits stage);
+
+// the on-disk form: a small header followed by the three arrays
+std::vector<char> serializeReflection(const ShaderReflection& reflection);
+bool deserializeReflection(const char* data, size_t size, ShaderReflection& reflection); // false for a truncated file or one from an older version
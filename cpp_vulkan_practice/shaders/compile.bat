@@ -1,3 +1,3 @@
-D:/VulkanSDK/1.3.224.1/Bin/glslc.exe shader.vert -o vert.spv
-D:/VulkanSDK/1.3.224.1/Bin/glslc.exe shader.frag -o frag.spv
+%VULKAN_SDK%/Bin/glslc.exe shader.vert -o vert.spv
+%VULKAN_SDK%/Bin/glslc.exe shader.frag -o frag.spv
 pause
\ No newline at end of file
@@ -0,0 +1,17 @@
+#!/bin/sh
+# rebuilds the prebuilt modules loaded by --prebuilt-shaders, the counterpart of compile.bat
+# glslc comes with the Vulkan SDK ($VULKAN_SDK/bin) or the distribution's shaderc (e.g. Debian/Ubuntu: glslc); GLSLC overrides it
+
+set -e
+cd "$(dirname "$0")"
+
+if [ -z "$GLSLC" ]; then
+	if [ -n "$VULKAN_SDK" ] && [ -x "$VULKAN_SDK/bin/glslc" ]; then
+		GLSLC="$VULKAN_SDK/bin/glslc"
+	else
+		GLSLC=glslc
+	fi
+fi
+
+"$GLSLC" shader.vert -o vert.spv
+"$GLSLC" shader.frag -o frag.spv
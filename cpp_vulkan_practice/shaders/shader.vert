@@ -1,20 +1,46 @@
 #version 450
 
+// PackedVertex (vertex_quantization.h): the fetch unpacks the normalized and packed float formats, the rest of the decode is done here
+layout(location = 0) in vec4 inPosition; // R16G16B16A16_UNORM inside the mesh bounds
+layout(location = 1) in vec4 inNormalTangent; // A2B10G10R10_SNORM: octahedral normal, tangent angle / pi, bitangent sign
+layout(location = 2) in vec2 inUv; // R16G16_UNORM inside the uv bounds
+layout(location = 3) in vec3 inColor; // B10G11R11_UFLOAT
+
+layout(push_constant) uniform MeshDecode { // MeshDecodeConstants
+    vec4 positionScale;
+    vec4 positionOffset;
+    vec4 uvScaleOffset;
+} meshDecode;
+
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec4 fragTangent;
+layout(location = 3) out vec2 fragUv;
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
 
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+vec3 octahedralDecode(vec2 e) {
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0) {
+        v.xy = (1.0 - abs(v.yx)) * signNotZero(v.xy);
+    }
+    return normalize(v);
+}
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
-}
\ No newline at end of file
+    vec3 position = inPosition.xyz * meshDecode.positionScale.xyz + meshDecode.positionOffset.xyz;
+
+    // the same tangent basis as tangentBasis in vertex_quantization.cpp
+    vec3 normal = octahedralDecode(inNormalTangent.xy);
+    vec3 reference = abs(normal.x) > abs(normal.z) ? normalize(vec3(-normal.y, normal.x, 0.0)) : normalize(vec3(0.0, -normal.z, normal.y));
+    vec3 bitangentReference = cross(normal, reference);
+    float angle = inNormalTangent.z * 3.14159265358979;
+
+    gl_Position = vec4(position, 1.0);
+    fragColor = inColor;
+    fragNormal = normal;
+    fragTangent = vec4(cos(angle) * reference + sin(angle) * bitangentReference, inNormalTangent.w < 0.0 ? -1.0 : 1.0);
+    fragUv = inUv * meshDecode.uvScaleOffset.xy + meshDecode.uvScaleOffset.zw;
+}
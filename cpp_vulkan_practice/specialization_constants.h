@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// specialization constants: values for the `layout(constant_id = N) const ...` declarations of a shader, fixed when the pipeline is created
+// the driver treats them like literals, so branches, light counts and loop bounds that depend on them are folded away and one GLSL source serves every variant
+//
+// a set is described at compile time:
+//     using LightCount = SpecializationConstant<0, uint32_t>;
+//     using UseFog = SpecializationConstant<1, bool>;
+//     SpecializationConstants<LightCount, UseFog> constants;
+//     constants.set<LightCount>(4); // a constant that is not part of the set or a value of the wrong type doesn't compile
+//     stage.specialization = constants.build();
+
+struct SpecializationData { // type erased form stored in a ShaderStageDesc, info() points into it
+	std::vector<VkSpecializationMapEntry> entries;
+	std::vector<uint8_t> data;
+
+	bool empty() const { return entries.empty(); }
+
+	VkSpecializationInfo info() const {
+		VkSpecializationInfo specialization_info = {};
+		specialization_info.mapEntryCount = static_cast<uint32_t>(entries.size());
+		specialization_info.pMapEntries = entries.data();
+		specialization_info.dataSize = data.size();
+		specialization_info.pData = data.data();
+		return specialization_info;
+	}
+};
+
+template <uint32_t ConstantId, typename T>
+struct SpecializationConstant {
+	static_assert(std::is_same_v<T, bool> || std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> || std::is_same_v<T, float> ||
+		std::is_same_v<T, int64_t> || std::is_same_v<T, uint64_t> || std::is_same_v<T, double>,
+		"Specialization constants have to be bool, 32/64 bit integers, float or double.");
+
+	static constexpr uint32_t id = ConstantId;
+	using Type = T;
+	using StorageType = std::conditional_t<std::is_same_v<T, bool>, VkBool32, T>; // SPIR-V booleans are 32 bit wide in the specialization data
+};
+
+template <typename... Constants>
+class SpecializationConstants {
+public:
+	static_assert(sizeof...(Constants) > 0, "A specialization constant set needs at least one constant.");
+
+	template <typename Constant>
+	void set(typename Constant::Type value) {
+		constexpr size_t index = indexOf<Constant>();
+		static_assert(index < sizeof...(Constants), "The constant is not part of this set.");
+
+		std::get<index>(values) = static_cast<typename Constant::StorageType>(value);
+		isSet[index] = true;
+	}
+
+	SpecializationData build() const { // only the constants that were set, the others keep the default value declared in the shader
+		SpecializationData result;
+		size_t index = 0;
+
+		std::apply([&](const auto&... value) {
+			(append(result, Constants::id, value, isSet[index++]), ...);
+		}, values);
+
+		return result;
+	}
+
+private:
+	template <typename Constant>
+	static constexpr size_t indexOf() {
+		constexpr bool matches[] = { std::is_same_v<Constant, Constants>... };
+
+		for (size_t i = 0; i < sizeof...(Constants); i++) {
+			if (matches[i]) {
+				return i;
+			}
+		}
+
+		return sizeof...(Constants);
+	}
+
+	static constexpr bool uniqueIds() {
+		constexpr uint32_t ids[] = { Constants::id... };
+
+		for (size_t i = 0; i < sizeof...(Constants); i++) {
+			for (size_t j = i + 1; j < sizeof...(Constants); j++) {
+				if (ids[i] == ids[j]) {
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	static_assert(uniqueIds(), "Specialization constant IDs have to be unique within a set.");
+
+	template <typename T>
+	static void append(SpecializationData& result, uint32_t constantId, const T& value, bool valueSet) {
+		if (!valueSet) {
+			return;
+		}
+
+		VkSpecializationMapEntry entry = {};
+		entry.constantID = constantId;
+		entry.offset = static_cast<uint32_t>(result.data.size());
+		entry.size = sizeof(T);
+		result.entries.push_back(entry);
+
+		result.data.resize(result.data.size() + sizeof(T));
+		std::memcpy(result.data.data() + entry.offset, &value, sizeof(T));
+	}
+
+	std::tuple<typename Constants::StorageType...> values{};
+	std::array<bool, sizeof...(Constants)> isSet{};
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// small helpers for timing statistics (profilers, benchmarks)
+
+inline double percentile(std::vector<double> samples, double fraction) { // fraction in [0, 1], nearest rank on a sorted copy
+	if (samples.empty()) {
+		return 0.0;
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	size_t rank = static_cast<size_t>(std::ceil(fraction * samples.size()));
+	return samples[(std::min)((std::max)(rank, size_t(1)), samples.size()) - 1];
+}
+
+inline double average(const std::vector<double>& samples) {
+	if (samples.empty()) {
+		return 0.0;
+	}
+
+	double sum = 0.0;
+	for (double sample : samples) {
+		sum += sample;
+	}
+
+	return sum / samples.size();
+}
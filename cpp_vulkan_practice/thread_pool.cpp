@@ -0,0 +1,48 @@
+#include "thread_pool.h"
+
+static thread_local uint32_t currentWorkerIndex = ThreadPool::NOT_A_WORKER;
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+	for (uint32_t i = 0; i < threadCount; i++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() { // finishes the tasks that are already queued, then joins the workers
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	taskAvailable.notify_all();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+uint32_t ThreadPool::workerIndex() {
+	return currentWorkerIndex;
+}
+
+void ThreadPool::workerLoop(uint32_t index) {
+	currentWorkerIndex = index;
+
+	while (true) {
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+			if (tasks.empty()) { // only reached when stopping
+				return;
+			}
+
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+
+		task(); // exceptions end up in the task's future
+	}
+}
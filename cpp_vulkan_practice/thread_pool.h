@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// fixed size pool of worker threads; tasks run in submission order on whichever worker is free
+// workerIndex() tells a task which worker runs it, so workers can own per-thread objects (command pools etc.) without locking
+
+class ThreadPool {
+public:
+	explicit ThreadPool(uint32_t threadCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	uint32_t threadCount() const { return static_cast<uint32_t>(workers.size()); }
+	static uint32_t workerIndex(); // index of the calling worker, NOT_A_WORKER on any other thread
+
+	static const uint32_t NOT_A_WORKER = UINT32_MAX;
+
+	template <typename F>
+	auto submit(F&& task) -> std::future<decltype(task())> {
+		using Result = decltype(task());
+
+		auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task)); // shared, std::function needs a copyable target
+		std::future<Result> result = packagedTask->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.push([packagedTask]() { (*packagedTask)(); });
+		}
+
+		taskAvailable.notify_one();
+		return result;
+	}
+
+private:
+	void workerLoop(uint32_t index);
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable taskAvailable;
+	bool stopping = false;
+};
@@ -0,0 +1,301 @@
+#include "tlsf_allocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <map>
+#include <random>
+
+TlsfAllocator::TlsfAllocator(uint64_t size) : totalSize(size) {
+	for (auto& heads : freeHeads) {
+		std::fill(std::begin(heads), std::end(heads), INVALID_NODE);
+	}
+
+	if (size > 0) {
+		insertFree(createNode(0, size));
+	}
+}
+
+void TlsfAllocator::sizeClass(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) {
+	if (size < TLSF_SECOND_LEVEL_COUNT) { // small sizes: one list per size
+		firstLevel = 0;
+		secondLevel = static_cast<uint32_t>(size);
+		return;
+	}
+
+	uint32_t highestBit = static_cast<uint32_t>(std::bit_width(size)) - 1; // >= TLSF_SECOND_LEVEL_LOG2
+	firstLevel = highestBit - TLSF_SECOND_LEVEL_LOG2 + 1;
+	secondLevel = static_cast<uint32_t>(size >> (highestBit - TLSF_SECOND_LEVEL_LOG2)) - TLSF_SECOND_LEVEL_COUNT; // the bits below the highest one
+}
+
+uint32_t TlsfAllocator::findFreeNode(uint64_t size) const {
+	// round the size up to the next class boundary: every range in that class (and above) is then large enough, the first node of a list can be taken without looking at its size
+
+	if (size >= TLSF_SECOND_LEVEL_COUNT) {
+		uint64_t step = uint64_t(1) << (std::bit_width(size) - 1 - TLSF_SECOND_LEVEL_LOG2);
+		if (size > UINT64_MAX - (step - 1)) {
+			return INVALID_NODE;
+		}
+		size += step - 1;
+	}
+
+	uint32_t firstLevel, secondLevel;
+	sizeClass(size, firstLevel, secondLevel);
+
+	uint32_t secondLevelMap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+
+	if (secondLevelMap == 0) { // nothing in this power of two, take the smallest non-empty larger one
+		uint64_t firstLevelMap = firstLevel + 1 < 64 ? firstLevelBitmap & (~uint64_t(0) << (firstLevel + 1)) : 0;
+		if (firstLevelMap == 0) {
+			return INVALID_NODE;
+		}
+
+		firstLevel = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+		secondLevelMap = secondLevelBitmaps[firstLevel];
+	}
+
+	secondLevel = static_cast<uint32_t>(std::countr_zero(secondLevelMap));
+	return freeHeads[firstLevel][secondLevel];
+}
+
+bool TlsfAllocator::allocate(uint64_t size, uint64_t alignment, Allocation& allocation) {
+	size = (std::max)(size, uint64_t(1));
+	alignment = (std::max)(alignment, uint64_t(1));
+
+	// asking for alignment - 1 bytes more guarantees an aligned offset fits, the bytes in front of it go back to the free lists
+
+	if (size > UINT64_MAX - (alignment - 1)) {
+		return false;
+	}
+
+	uint32_t node = findFreeNode(size + alignment - 1);
+	if (node == INVALID_NODE) {
+		return false;
+	}
+
+	removeFree(node);
+
+	uint64_t alignedOffset = (nodes[node].offset + alignment - 1) & ~(alignment - 1);
+	uint64_t padding = alignedOffset - nodes[node].offset;
+
+	if (padding > 0) { // split off the front, its physical predecessor is in use (free ranges are always merged), so it stays a separate free range
+		uint32_t front = createNode(nodes[node].offset, padding);
+		nodes[front].previousPhysical = nodes[node].previousPhysical;
+		nodes[front].nextPhysical = node;
+		if (nodes[node].previousPhysical != INVALID_NODE) {
+			nodes[nodes[node].previousPhysical].nextPhysical = front;
+		}
+
+		nodes[node].previousPhysical = front;
+		nodes[node].offset = alignedOffset;
+		nodes[node].size -= padding;
+		insertFree(front);
+	}
+
+	if (nodes[node].size > size) { // split off the rest
+		uint32_t back = createNode(nodes[node].offset + size, nodes[node].size - size);
+		nodes[back].previousPhysical = node;
+		nodes[back].nextPhysical = nodes[node].nextPhysical;
+		if (nodes[node].nextPhysical != INVALID_NODE) {
+			nodes[nodes[node].nextPhysical].previousPhysical = back;
+		}
+
+		nodes[node].nextPhysical = back;
+		nodes[node].size = size;
+		insertFree(back);
+	}
+
+	usedSize += size;
+	liveAllocations++;
+
+	allocation.offset = nodes[node].offset;
+	allocation.node = node;
+	return true;
+}
+
+void TlsfAllocator::free(uint32_t node) {
+	usedSize -= nodes[node].size;
+	liveAllocations--;
+
+	uint32_t next = nodes[node].nextPhysical;
+	if (next != INVALID_NODE && nodes[next].free) {
+		removeFree(next);
+		mergeWithNext(node);
+	}
+
+	uint32_t previous = nodes[node].previousPhysical;
+	if (previous != INVALID_NODE && nodes[previous].free) {
+		removeFree(previous);
+		mergeWithNext(previous);
+		node = previous;
+	}
+
+	insertFree(node);
+}
+
+uint64_t TlsfAllocator::largestFreeRange() const {
+	if (firstLevelBitmap == 0) {
+		return 0;
+	}
+
+	// the largest range is in the highest non-empty class, but not necessarily at the head of its list
+
+	uint32_t firstLevel = 63 - static_cast<uint32_t>(std::countl_zero(firstLevelBitmap));
+	uint32_t secondLevel = 31 - static_cast<uint32_t>(std::countl_zero(secondLevelBitmaps[firstLevel]));
+
+	uint64_t largest = 0;
+	for (uint32_t node = freeHeads[firstLevel][secondLevel]; node != INVALID_NODE; node = nodes[node].nextFree) {
+		largest = (std::max)(largest, nodes[node].size);
+	}
+
+	return largest;
+}
+
+uint32_t TlsfAllocator::createNode(uint64_t offset, uint64_t size) {
+	uint32_t node;
+
+	if (!unusedNodes.empty()) {
+		node = unusedNodes.back();
+		unusedNodes.pop_back();
+		nodes[node] = Node();
+	}
+	else {
+		node = static_cast<uint32_t>(nodes.size());
+		nodes.emplace_back();
+	}
+
+	nodes[node].offset = offset;
+	nodes[node].size = size;
+	return node;
+}
+
+void TlsfAllocator::releaseNode(uint32_t node) {
+	unusedNodes.push_back(node);
+}
+
+void TlsfAllocator::insertFree(uint32_t node) {
+	uint32_t firstLevel, secondLevel;
+	sizeClass(nodes[node].size, firstLevel, secondLevel);
+
+	uint32_t head = freeHeads[firstLevel][secondLevel];
+	nodes[node].free = true;
+	nodes[node].previousFree = INVALID_NODE;
+	nodes[node].nextFree = head;
+	if (head != INVALID_NODE) {
+		nodes[head].previousFree = node;
+	}
+
+	freeHeads[firstLevel][secondLevel] = node;
+	firstLevelBitmap |= uint64_t(1) << firstLevel;
+	secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	freeRanges++;
+}
+
+void TlsfAllocator::removeFree(uint32_t node) {
+	uint32_t firstLevel, secondLevel;
+	sizeClass(nodes[node].size, firstLevel, secondLevel);
+
+	uint32_t previous = nodes[node].previousFree;
+	uint32_t next = nodes[node].nextFree;
+
+	if (previous != INVALID_NODE) {
+		nodes[previous].nextFree = next;
+	}
+	else {
+		freeHeads[firstLevel][secondLevel] = next;
+	}
+
+	if (next != INVALID_NODE) {
+		nodes[next].previousFree = previous;
+	}
+
+	if (freeHeads[firstLevel][secondLevel] == INVALID_NODE) {
+		secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+		if (secondLevelBitmaps[firstLevel] == 0) {
+			firstLevelBitmap &= ~(uint64_t(1) << firstLevel);
+		}
+	}
+
+	nodes[node].free = false;
+	nodes[node].previousFree = INVALID_NODE;
+	nodes[node].nextFree = INVALID_NODE;
+	freeRanges--;
+}
+
+void TlsfAllocator::mergeWithNext(uint32_t node) {
+	uint32_t next = nodes[node].nextPhysical;
+
+	nodes[node].size += nodes[next].size;
+	nodes[node].nextPhysical = nodes[next].nextPhysical;
+	if (nodes[next].nextPhysical != INVALID_NODE) {
+		nodes[nodes[next].nextPhysical].previousPhysical = node;
+	}
+
+	releaseNode(next);
+}
+
+std::string tlsfSelfTest(uint32_t operationCount, uint32_t seed) {
+	const uint64_t blockSize = 64ull << 20;
+
+	struct LiveRange {
+		uint64_t size;
+		uint32_t node;
+	};
+
+	TlsfAllocator allocator(blockSize);
+	std::map<uint64_t, LiveRange> live; // by offset
+	std::mt19937 random(seed);
+	uint64_t usedBytes = 0;
+
+	for (uint32_t operation = 0; operation < operationCount; operation++) {
+		bool allocating = live.empty() || random() % 100 < 55; // a little more allocating than freeing, so the block fills up and allocations start to fail
+
+		if (allocating) {
+			uint64_t size = random() % 4 == 0 ? 1 + random() % (1u << 20) : 1 + random() % 4096; // mostly small, some large
+			uint64_t alignment = 1ull << (random() % 13); // up to 4 KiB
+
+			TlsfAllocator::Allocation allocation;
+			if (!allocator.allocate(size, alignment, allocation)) {
+				continue; // allowed when full or fragmented
+			}
+
+			if (allocation.offset % alignment != 0) {
+				return "offset " + std::to_string(allocation.offset) + " is not aligned to " + std::to_string(alignment);
+			}
+			if (allocation.offset + size > blockSize) {
+				return "range at " + std::to_string(allocation.offset) + " ends past the block";
+			}
+
+			auto next = live.lower_bound(allocation.offset);
+			if (next != live.end() && next->first < allocation.offset + size) {
+				return "range at " + std::to_string(allocation.offset) + " overlaps the one at " + std::to_string(next->first);
+			}
+			if (next != live.begin() && std::prev(next)->first + std::prev(next)->second.size > allocation.offset) {
+				return "range at " + std::to_string(allocation.offset) + " overlaps the one at " + std::to_string(std::prev(next)->first);
+			}
+
+			live[allocation.offset] = { size, allocation.node };
+			usedBytes += size;
+		}
+		else {
+			auto range = std::next(live.begin(), random() % live.size());
+			allocator.free(range->second.node);
+			usedBytes -= range->second.size;
+			live.erase(range);
+		}
+
+		if (allocator.usedBytes() != usedBytes || allocator.allocationCount() != live.size()) {
+			return "byte or allocation count doesn't match after operation " + std::to_string(operation);
+		}
+	}
+
+	for (const auto& [offset, range] : live) {
+		allocator.free(range.node);
+	}
+
+	if (!allocator.empty() || allocator.usedBytes() != 0 || allocator.freeRangeCount() != 1 || allocator.largestFreeRange() != blockSize) {
+		return "the free ranges didn't merge back into one after freeing everything";
+	}
+
+	return {};
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// two level segregated fit (TLSF): hands out ranges of [0, size) in O(1), used by GpuAllocator to place resources inside a VkDeviceMemory block
+// free ranges are kept in lists by size class: the first level is the power of two of the size, the second level splits that power of two into TLSF_SECOND_LEVEL_COUNT linear steps
+// two bitmaps say which lists are non-empty, so finding a range that fits is a couple of bit scans instead of a walk over the free ranges
+// neighbouring free ranges are merged right away, there are never two free ranges next to each other
+//
+// only offsets are managed here, nothing is read or written at them; not thread safe (GpuAllocator locks)
+
+const uint32_t TLSF_SECOND_LEVEL_LOG2 = 5;
+const uint32_t TLSF_SECOND_LEVEL_COUNT = 1 << TLSF_SECOND_LEVEL_LOG2;
+const uint32_t TLSF_FIRST_LEVEL_COUNT = 64 - TLSF_SECOND_LEVEL_LOG2 + 1; // sizes below TLSF_SECOND_LEVEL_COUNT all share the first class
+
+class TlsfAllocator {
+public:
+	static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+	struct Allocation {
+		uint64_t offset = 0;
+		uint32_t node = INVALID_NODE; // what free() takes back
+	};
+
+	explicit TlsfAllocator(uint64_t size);
+
+	bool allocate(uint64_t size, uint64_t alignment, Allocation& allocation); // alignment is a power of two; false if no free range fits
+	void free(uint32_t node);
+
+	uint64_t size() const { return totalSize; }
+	uint64_t usedBytes() const { return usedSize; } // allocated sizes, without the padding alignment left in between
+	uint32_t allocationCount() const { return liveAllocations; }
+	uint32_t freeRangeCount() const { return freeRanges; } // fragmentation: 1 when everything free is in one piece
+	uint64_t largestFreeRange() const;
+	bool empty() const { return liveAllocations == 0; }
+
+private:
+	struct Node {
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		uint32_t previousPhysical = INVALID_NODE; // neighbours in address order
+		uint32_t nextPhysical = INVALID_NODE;
+		uint32_t previousFree = INVALID_NODE; // neighbours in the free list of its size class, only while free
+		uint32_t nextFree = INVALID_NODE;
+		bool free = false;
+	};
+
+	static void sizeClass(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel); // the class a range of this size is stored in
+	uint32_t findFreeNode(uint64_t size) const; // a free node at least this large, INVALID_NODE if there is none
+
+	uint32_t createNode(uint64_t offset, uint64_t size);
+	void releaseNode(uint32_t node);
+	void insertFree(uint32_t node);
+	void removeFree(uint32_t node);
+	void mergeWithNext(uint32_t node); // absorbs the physical successor, which has to be free and out of its free list
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> unusedNodes; // indices into nodes that can be reused
+	uint64_t firstLevelBitmap = 0;
+	uint32_t secondLevelBitmaps[TLSF_FIRST_LEVEL_COUNT] = {};
+	uint32_t freeHeads[TLSF_FIRST_LEVEL_COUNT][TLSF_SECOND_LEVEL_COUNT];
+
+	uint64_t totalSize = 0;
+	uint64_t usedSize = 0;
+	uint32_t liveAllocations = 0;
+	uint32_t freeRanges = 0;
+};
+
+// randomized allocations and frees checked against a map of the live ranges: alignment, bounds, overlap, byte counts, and one free range once everything is freed
+// empty on success, otherwise what went wrong (--self-test)
+std::string tlsfSelfTest(uint32_t operationCount, uint32_t seed);
@@ -0,0 +1,393 @@
+#include "upload_queue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+void UploadQueue::create(GpuAllocator& allocator, VkDevice device, VkQueue queue, uint32_t transferFamily, uint32_t graphicsFamily, VkDeviceSize ringSize) {
+	this->allocator = &allocator;
+	this->device = device;
+	this->queue = queue;
+	this->transferFamily = transferFamily;
+	this->graphicsFamily = graphicsFamily;
+	capacity = (ringSize + STAGING_RING_ALIGNMENT - 1) / STAGING_RING_ALIGNMENT * STAGING_RING_ALIGNMENT; // every ring offset handed out stays aligned
+	head = 0;
+	tail = 0;
+
+	VkBufferCreateInfo buffer_info = {};
+	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_info.size = capacity;
+	buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // only ever read by the transfer queue
+
+	if (vkCreateBuffer(device, &buffer_info, nullptr, &stagingBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create staging buffer.");
+	}
+
+	// written once by the CPU and read once by the copy: plain host visible memory, device local would only take space from the small BAR heap
+
+	stagingMemory = allocator.allocateBuffer(stagingBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	mapped = static_cast<uint8_t*>(stagingMemory.mapped);
+
+	scheduler.create(device);
+
+	VkCommandPoolCreateInfo command_pool_info = {};
+	command_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	command_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // short lived, every batch re-records a finished one
+	command_pool_info.queueFamilyIndex = transferFamily;
+
+	if (vkCreateCommandPool(device, &command_pool_info, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create upload command pool.");
+	}
+}
+
+void UploadQueue::destroy() {
+	if (stagingBuffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	scheduler.waitIdle();
+
+	vkDestroyCommandPool(device, commandPool, nullptr); // frees the command buffers with it
+	scheduler.destroy();
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	allocator->free(stagingMemory);
+
+	stagingBuffer = VK_NULL_HANDLE;
+	commandPool = VK_NULL_HANDLE;
+	mapped = nullptr;
+	freeCommandBuffers.clear();
+	batches.clear();
+	bufferCopies.clear();
+	imageCopies.clear();
+	heldBuffers.clear();
+	heldStages = 0;
+	stagedBytes = 0;
+}
+
+bool UploadQueue::allocateRing(VkDeviceSize size, VkDeviceSize& offset) {
+	if (size > capacity) { // could never fit, no matter how long we wait
+		throw std::runtime_error("Upload is larger than the staging ring.");
+	}
+
+	reclaim();
+
+	VkDeviceSize start = (head + STAGING_RING_ALIGNMENT - 1) / STAGING_RING_ALIGNMENT * STAGING_RING_ALIGNMENT;
+	if (start % capacity + size > capacity) { // doesn't fit in front of the end of the ring, skip the rest and start over at 0
+		start = (start / capacity + 1) * capacity;
+	}
+
+	if (start + size - tail > capacity) { // would overwrite data a batch in flight still copies from
+		stats.deferredCount++;
+		return false;
+	}
+
+	head = start + size;
+	offset = start % capacity;
+	return true;
+}
+
+void UploadQueue::reclaim() {
+	if (batches.empty()) {
+		return;
+	}
+
+	uint64_t completed = scheduler.completedValue();
+
+	while (!batches.empty() && batches.front().timelineValue <= completed) { // in submission order, so the tail only moves forward
+		tail = batches.front().ringEnd;
+		freeCommandBuffers.push_back(batches.front().commandBuffer);
+		batches.pop_front();
+	}
+}
+
+VkCommandBuffer UploadQueue::nextCommandBuffer() {
+	if (!freeCommandBuffers.empty()) {
+		VkCommandBuffer commandBuffer = freeCommandBuffers.back();
+		freeCommandBuffers.pop_back();
+		vkResetCommandBuffer(commandBuffer, 0);
+		return commandBuffer;
+	}
+
+	VkCommandBufferAllocateInfo command_buffer_allocate_info = {}; // one more batch in flight than ever before
+	command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	command_buffer_allocate_info.commandPool = commandPool;
+	command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	command_buffer_allocate_info.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(device, &command_buffer_allocate_info, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate upload command buffer.");
+	}
+
+	return commandBuffer;
+}
+
+void* UploadQueue::stageBuffer(VkBuffer buffer, VkDeviceSize dstOffset, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+	VkDeviceSize offset;
+	if (size == 0 || !allocateRing(size, offset)) {
+		return nullptr;
+	}
+
+	BufferCopy copy = {};
+	copy.buffer = buffer;
+	copy.region.srcOffset = offset;
+	copy.region.dstOffset = dstOffset;
+	copy.region.size = size;
+	copy.dstStage = dstStage;
+	copy.dstAccess = dstAccess;
+	bufferCopies.push_back(copy);
+
+	stagedBytes += size;
+	return mapped + offset;
+}
+
+bool UploadQueue::uploadBuffer(VkBuffer buffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+	void* staging = stageBuffer(buffer, dstOffset, size, dstStage, dstAccess);
+	if (staging == nullptr) {
+		return size == 0;
+	}
+
+	std::memcpy(staging, data, static_cast<size_t>(size)); // coherent memory, no flush needed
+	return true;
+}
+
+void UploadQueue::uploadBufferBlocking(VkBuffer buffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, UploadSubmission& submitted) {
+	const uint8_t* source = static_cast<const uint8_t*>(data);
+	VkDeviceSize pieceSize = (std::max)(capacity / 4, STAGING_RING_ALIGNMENT); // leaves room for the other uploads of the frame
+
+	while (size > 0) {
+		VkDeviceSize piece = (std::min)(size, pieceSize);
+
+		if (!uploadBuffer(buffer, dstOffset, source, piece, dstStage, dstAccess)) { // the only place the upload queue waits, everything in flight is done afterwards
+			submitted.merge(submitBatch(false)); // the buffer is released with its last piece
+			scheduler.waitIdle();
+			continue;
+		}
+
+		source += piece;
+		dstOffset += piece;
+		size -= piece;
+	}
+}
+
+bool UploadQueue::uploadImage(VkImage image, const VkImageSubresourceLayers& subresource, VkExtent3D extent, const void* data, VkDeviceSize size,
+	VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+	VkDeviceSize offset;
+	if (!allocateRing(size, offset)) {
+		return false;
+	}
+
+	std::memcpy(mapped + offset, data, static_cast<size_t>(size));
+
+	ImageCopy copy = {};
+	copy.image = image;
+	copy.region.bufferOffset = offset;
+	copy.region.bufferRowLength = 0; // tightly packed
+	copy.region.bufferImageHeight = 0;
+	copy.region.imageSubresource = subresource;
+	copy.region.imageOffset = { 0, 0, 0 };
+	copy.region.imageExtent = extent;
+	copy.finalLayout = finalLayout;
+	copy.dstStage = dstStage;
+	copy.dstAccess = dstAccess;
+	imageCopies.push_back(copy);
+
+	stagedBytes += size;
+	return true;
+}
+
+UploadSubmission UploadQueue::submit() {
+	return submitBatch(true);
+}
+
+UploadSubmission UploadQueue::submitBatch(bool release) {
+	UploadSubmission submission;
+
+	if (!pending()) {
+		return submission;
+	}
+
+	uint32_t srcFamily = separateFamily() ? transferFamily : VK_QUEUE_FAMILY_IGNORED;
+	uint32_t dstFamily = separateFamily() ? graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+
+	// one vkCmdCopyBuffer per destination buffer with all of its regions: group the copies by buffer, keeping their order within a buffer
+
+	std::stable_sort(bufferCopies.begin(), bufferCopies.end(), [](const BufferCopy& a, const BufferCopy& b) {
+		return std::less<VkBuffer>()(a.buffer, b.buffer);
+	});
+
+	VkCommandBuffer commandBuffer = nextCommandBuffer();
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(commandBuffer, &begin_info) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin recording upload command buffer.");
+	}
+
+	// images: UNDEFINED -> TRANSFER_DST_OPTIMAL, their old contents are dropped
+
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	imageBarriers.reserve(imageCopies.size());
+
+	for (const auto& copy : imageCopies) {
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = copy.image;
+		barrier.subresourceRange = { copy.region.imageSubresource.aspectMask, copy.region.imageSubresource.mipLevel, 1, copy.region.imageSubresource.baseArrayLayer, copy.region.imageSubresource.layerCount };
+		imageBarriers.push_back(barrier);
+	}
+
+	if (!imageBarriers.empty()) {
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+
+	// the copies; every destination gets a release barrier (or, on a single family, just its layout transition) covering all of its regions
+
+	std::vector<VkBufferCopy> regions;
+	std::vector<VkBufferMemoryBarrier> bufferReleases;
+
+	for (size_t first = 0; first < bufferCopies.size();) {
+		VkBuffer buffer = bufferCopies[first].buffer;
+		VkAccessFlags dstAccess = 0;
+		size_t last = first;
+
+		regions.clear();
+		for (; last < bufferCopies.size() && bufferCopies[last].buffer == buffer; last++) {
+			regions.push_back(bufferCopies[last].region);
+			dstAccess |= bufferCopies[last].dstAccess;
+			submission.waitStages |= bufferCopies[last].dstStage;
+			stats.copyCount++;
+		}
+
+		vkCmdCopyBuffer(commandBuffer, stagingBuffer, buffer, static_cast<uint32_t>(regions.size()), regions.data());
+
+		if (separateFamily()) { // on a single family the semaphore wait alone makes the copies visible
+			auto held = std::find_if(heldBuffers.begin(), heldBuffers.end(), [buffer](const VkBufferMemoryBarrier& barrier) { return barrier.buffer == buffer; });
+
+			if (held == heldBuffers.end()) {
+				VkBufferMemoryBarrier acquire = {};
+				acquire.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+				acquire.srcAccessMask = 0; // ignored for an acquire
+				acquire.srcQueueFamilyIndex = srcFamily;
+				acquire.dstQueueFamilyIndex = dstFamily;
+				acquire.buffer = buffer;
+				acquire.offset = 0;
+				acquire.size = VK_WHOLE_SIZE; // release and acquire have to name the same range
+				heldBuffers.push_back(acquire);
+				held = heldBuffers.end() - 1;
+			}
+
+			held->dstAccessMask |= dstAccess;
+		}
+
+		first = last;
+	}
+
+	// a buffer is released once all of its pieces are written: after the release the transfer family no longer owns it and must not write it again
+
+	if (release) {
+		for (const auto& acquire : heldBuffers) {
+			VkBufferMemoryBarrier bufferRelease = acquire;
+			bufferRelease.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			bufferRelease.dstAccessMask = 0; // ignored for a release
+			bufferReleases.push_back(bufferRelease);
+		}
+
+		submission.bufferAcquires = std::move(heldBuffers);
+		submission.waitStages |= heldStages;
+		heldBuffers.clear();
+		heldStages = 0;
+	}
+	else {
+		heldStages |= submission.waitStages;
+	}
+
+	imageBarriers.clear();
+
+	for (const auto& copy : imageCopies) {
+		vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, copy.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+
+		VkImageMemoryBarrier release = {}; // with ownership transfer, the layout transition happens between the release and the acquire
+		release.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		release.dstAccessMask = 0;
+		release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		release.newLayout = copy.finalLayout;
+		release.srcQueueFamilyIndex = srcFamily;
+		release.dstQueueFamilyIndex = dstFamily;
+		release.image = copy.image;
+		release.subresourceRange = { copy.region.imageSubresource.aspectMask, copy.region.imageSubresource.mipLevel, 1, copy.region.imageSubresource.baseArrayLayer, copy.region.imageSubresource.layerCount };
+		imageBarriers.push_back(release);
+
+		if (separateFamily()) {
+			VkImageMemoryBarrier acquire = release;
+			acquire.srcAccessMask = 0;
+			acquire.dstAccessMask = copy.dstAccess;
+			submission.imageAcquires.push_back(acquire);
+		}
+
+		submission.waitStages |= copy.dstStage;
+		stats.copyCount++;
+	}
+
+	if (!bufferReleases.empty() || !imageBarriers.empty()) { // nothing on this queue comes after the release, the semaphore signal waits for it
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+			static_cast<uint32_t>(bufferReleases.size()), bufferReleases.data(), static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record upload command buffer.");
+	}
+
+	submission.timelineValue = scheduler.nextSubmitValue();
+
+	VkSemaphore signalSemaphore = scheduler.semaphore();
+
+	VkTimelineSemaphoreSubmitInfo timeline_submit_info = {};
+	timeline_submit_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timeline_submit_info.signalSemaphoreValueCount = 1;
+	timeline_submit_info.pSignalSemaphoreValues = &submission.timelineValue;
+
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext = &timeline_submit_info;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &commandBuffer;
+	submit_info.signalSemaphoreCount = 1;
+	submit_info.pSignalSemaphores = &signalSemaphore;
+
+	if (vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit upload command buffer.");
+	}
+
+	batches.push_back({ submission.timelineValue, head, commandBuffer });
+
+	stats.bytes += stagedBytes;
+	stats.batchCount++;
+	stagedBytes = 0;
+	bufferCopies.clear();
+	imageCopies.clear();
+
+	return submission;
+}
+
+void UploadQueue::recordAcquire(VkCommandBuffer commandBuffer, const UploadSubmission& submission) {
+	if (!submission.needsAcquire()) {
+		return;
+	}
+
+	// the submit waits on the upload semaphore in waitStages, starting the barrier there chains it behind that wait
+
+	vkCmdPipelineBarrier(commandBuffer, submission.waitStages, submission.waitStages, 0, 0, nullptr,
+		static_cast<uint32_t>(submission.bufferAcquires.size()), submission.bufferAcquires.data(), static_cast<uint32_t>(submission.imageAcquires.size()), submission.imageAcquires.data());
+}
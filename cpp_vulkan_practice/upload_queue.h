@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "frame_scheduler.h"
+#include "gpu_allocator.h"
+
+// upload queue: CPU data is written into a persistently mapped staging ring, the copies into device local buffers and images are collected
+// and go to the GPU as one command buffer per frame, on a transfer-only queue family (the copy engine) when the device has one
+//
+// - the ring has its own timeline semaphore: every submitted batch remembers where it ended in the ring, once its value is reached the tail moves past it
+//   a full ring makes the upload return false (stage it again next frame), the CPU never waits for the GPU here
+// - with a separate transfer family the destinations are EXCLUSIVE to one family at a time: the batch ends with release barriers,
+//   the graphics queue records the matching acquire barriers (UploadSubmission, recordAcquire) before the frame that first uses the data
+// - the frame's submit waits on semaphore() at the batch's value, in the stages the uploads are consumed in
+// - destinations are overwritten: the transfer queue never acquires them back, their old contents are discarded and must no longer be read by frames in flight
+// - images are copied a whole subresource at a time, which is always allowed whatever the minImageTransferGranularity of the transfer family
+
+const VkDeviceSize DEFAULT_STAGING_RING_SIZE = 16ull * 1024 * 1024;
+const VkDeviceSize STAGING_RING_ALIGNMENT = 16; // buffer offsets of buffer to image copies have to be multiples of the texel size and of 4
+
+struct UploadSubmission {
+	uint64_t timelineValue = 0; // 0: nothing was submitted
+	VkPipelineStageFlags waitStages = 0; // where the uploaded data is first used, the wait on UploadQueue::semaphore() goes there
+	std::vector<VkBufferMemoryBarrier> bufferAcquires; // only with a separate transfer family
+	std::vector<VkImageMemoryBarrier> imageAcquires;
+
+	bool needsAcquire() const { return !bufferAcquires.empty() || !imageAcquires.empty(); }
+
+	void merge(const UploadSubmission& other) { // waiting for the later value covers both, the timeline only grows; every resource is released once, so the acquires don't overlap
+		timelineValue = timelineValue > other.timelineValue ? timelineValue : other.timelineValue;
+		waitStages |= other.waitStages;
+		bufferAcquires.insert(bufferAcquires.end(), other.bufferAcquires.begin(), other.bufferAcquires.end());
+		imageAcquires.insert(imageAcquires.end(), other.imageAcquires.begin(), other.imageAcquires.end());
+	}
+};
+
+struct UploadStats {
+	uint64_t bytes = 0; // staged and submitted
+	uint64_t copyCount = 0; // copy regions
+	uint64_t batchCount = 0; // submissions to the transfer queue
+	uint64_t deferredCount = 0; // uploads refused because the ring was full
+};
+
+class UploadQueue {
+public:
+	// queue belongs to transferFamily; transferFamily == graphicsFamily: no ownership transfers, the uploads are submitted to the graphics queue
+	void create(GpuAllocator& allocator, VkDevice device, VkQueue queue, uint32_t transferFamily, uint32_t graphicsFamily, VkDeviceSize ringSize = DEFAULT_STAGING_RING_SIZE);
+	void destroy(); // waits for the submitted batches
+
+	// staging memory for size bytes that end up at dstOffset in buffer, write them before the next submit(); nullptr if the ring is full right now
+	// the regions staged for one buffer until the next submit() must not overlap, they become a single vkCmdCopyBuffer
+	void* stageBuffer(VkBuffer buffer, VkDeviceSize dstOffset, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+	bool uploadBuffer(VkBuffer buffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+	// loading: stages all of it, in pieces if it is large; whenever the ring is full the staged copies are submitted (added to submitted) and the transfer queue is waited for
+	void uploadBufferBlocking(VkBuffer buffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, UploadSubmission& submitted);
+
+	// one tightly packed subresource (a mip level of some layers), the image goes from UNDEFINED to finalLayout
+	bool uploadImage(VkImage image, const VkImageSubresourceLayers& subresource, VkExtent3D extent, const void* data, VkDeviceSize size,
+		VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+	UploadSubmission submit(); // records and submits everything staged since the last call, once per frame
+	static void recordAcquire(VkCommandBuffer commandBuffer, const UploadSubmission& submission); // the graphics queue side of the ownership transfers
+
+	VkSemaphore semaphore() const { return scheduler.semaphore(); }
+	bool separateFamily() const { return transferFamily != graphicsFamily; }
+	bool pending() const { return !bufferCopies.empty() || !imageCopies.empty() || !heldBuffers.empty(); }
+	void waitIdle() { scheduler.waitIdle(); }
+
+	VkDeviceSize ringSize() const { return capacity; }
+	VkDeviceSize ringUsage() const { return head - tail; } // staged or still in flight
+	const UploadStats& statistics() const { return stats; }
+	void resetStatistics() { stats = {}; }
+
+private:
+	struct BufferCopy {
+		VkBuffer buffer;
+		VkBufferCopy region;
+		VkPipelineStageFlags dstStage;
+		VkAccessFlags dstAccess;
+	};
+
+	struct ImageCopy {
+		VkImage image;
+		VkBufferImageCopy region;
+		VkImageLayout finalLayout;
+		VkPipelineStageFlags dstStage;
+		VkAccessFlags dstAccess;
+	};
+
+	struct Batch {
+		uint64_t timelineValue;
+		VkDeviceSize ringEnd; // head after the batch's last allocation
+		VkCommandBuffer commandBuffer;
+	};
+
+	UploadSubmission submitBatch(bool release); // release false: buffers stay owned by the transfer family, more pieces of them follow
+	bool allocateRing(VkDeviceSize size, VkDeviceSize& offset); // offset into the staging buffer
+	void reclaim(); // releases the ring space and command buffers of finished batches
+	VkCommandBuffer nextCommandBuffer();
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueue queue = VK_NULL_HANDLE;
+	uint32_t transferFamily = 0;
+	uint32_t graphicsFamily = 0;
+	GpuAllocator* allocator = nullptr;
+
+	VkBuffer stagingBuffer = VK_NULL_HANDLE;
+	GpuAllocation stagingMemory;
+	uint8_t* mapped = nullptr;
+	VkDeviceSize capacity = 0;
+	VkDeviceSize head = 0; // head and tail only grow, the ring offset is the value modulo capacity
+	VkDeviceSize tail = 0;
+
+	FrameScheduler scheduler; // timeline of the submitted batches
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> freeCommandBuffers;
+	std::deque<Batch> batches; // in flight, in submission order
+
+	std::vector<BufferCopy> bufferCopies; // staged for the next submit
+	std::vector<ImageCopy> imageCopies;
+	std::vector<VkBufferMemoryBarrier> heldBuffers; // written by submitted batches but not released yet, their acquire barriers
+	VkPipelineStageFlags heldStages = 0;
+	VkDeviceSize stagedBytes = 0;
+	UploadStats stats;
+};
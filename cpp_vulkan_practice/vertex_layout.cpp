@@ -0,0 +1,48 @@
+#include "vertex_layout.h"
+
+enum class VertexNumericType {
+	Float, // also the normalized and scaled integer formats, the shader reads them as float
+	Int,
+	Uint
+};
+
+static VertexNumericType numericType(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_R8_SINT: case VK_FORMAT_R8G8_SINT: case VK_FORMAT_R8G8B8_SINT: case VK_FORMAT_R8G8B8A8_SINT:
+	case VK_FORMAT_R16_SINT: case VK_FORMAT_R16G16_SINT: case VK_FORMAT_R16G16B16_SINT: case VK_FORMAT_R16G16B16A16_SINT:
+	case VK_FORMAT_R32_SINT: case VK_FORMAT_R32G32_SINT: case VK_FORMAT_R32G32B32_SINT: case VK_FORMAT_R32G32B32A32_SINT:
+	case VK_FORMAT_A2B10G10R10_SINT_PACK32:
+		return VertexNumericType::Int;
+	case VK_FORMAT_R8_UINT: case VK_FORMAT_R8G8_UINT: case VK_FORMAT_R8G8B8_UINT: case VK_FORMAT_R8G8B8A8_UINT:
+	case VK_FORMAT_R16_UINT: case VK_FORMAT_R16G16_UINT: case VK_FORMAT_R16G16B16_UINT: case VK_FORMAT_R16G16B16A16_UINT:
+	case VK_FORMAT_R32_UINT: case VK_FORMAT_R32G32_UINT: case VK_FORMAT_R32G32B32_UINT: case VK_FORMAT_R32G32B32A32_UINT:
+	case VK_FORMAT_A2B10G10R10_UINT_PACK32:
+		return VertexNumericType::Uint;
+	default:
+		return VertexNumericType::Float;
+	}
+}
+
+std::string checkVertexInputs(const std::vector<ReflectedVertexInput>& inputs, const VkVertexInputAttributeDescription* attributes, uint32_t attributeCount) {
+	// attributes the shader doesn't read are allowed, a read without an attribute is undefined
+
+	for (const auto& input : inputs) {
+		const VkVertexInputAttributeDescription* attribute = nullptr;
+		for (uint32_t i = 0; i < attributeCount; i++) {
+			if (attributes[i].location == input.location) {
+				attribute = &attributes[i];
+				break;
+			}
+		}
+
+		if (attribute == nullptr) {
+			return "no vertex attribute for input location " + std::to_string(input.location);
+		}
+
+		if (input.format != VK_FORMAT_UNDEFINED && numericType(input.format) != numericType(attribute->format)) { // float vs integer, the component count may differ
+			return "vertex attribute at location " + std::to_string(input.location) + " has a different numeric type than the shader input";
+		}
+	}
+
+	return {};
+}
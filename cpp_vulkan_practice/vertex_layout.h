@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "shader_reflection.h"
+
+// vertex input state generated from a C++ vertex struct: the binding stride is sizeof the struct, the attributes come from its members
+// every member type maps to a VkFormat at compile time, a member without a format doesn't compile
+//
+//     struct Vertex { glm::vec2 position; glm::vec3 color; };
+//     template <> struct VertexLayout<Vertex> {
+//         static constexpr std::array<VertexAttribute, 2> attributes = { VERTEX_ATTRIBUTE(Vertex, position), VERTEX_ATTRIBUTE(Vertex, color) };
+//     };
+//     vertexBindingDescription<Vertex>(0); vertexAttributeDescriptions<Vertex>(0); // locations 0, 1, ... in the order of attributes
+//
+// the layout has to be specialized outside the struct, offsetof needs a complete type
+// packed members (normalized integers, 10/11 bit formats) name their format: VERTEX_ATTRIBUTE_PACKED(Vertex, normal, VK_FORMAT_A2B10G10R10_SNORM_PACK32),
+// the member has to be exactly as large as one element of the format
+
+template <typename T>
+struct VertexFormat; // no format for this type: use one of the types below or add a specialization
+
+template <> struct VertexFormat<float> { static constexpr VkFormat format = VK_FORMAT_R32_SFLOAT; };
+template <> struct VertexFormat<glm::vec2> { static constexpr VkFormat format = VK_FORMAT_R32G32_SFLOAT; };
+template <> struct VertexFormat<glm::vec3> { static constexpr VkFormat format = VK_FORMAT_R32G32B32_SFLOAT; };
+template <> struct VertexFormat<glm::vec4> { static constexpr VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT; };
+template <> struct VertexFormat<int32_t> { static constexpr VkFormat format = VK_FORMAT_R32_SINT; };
+template <> struct VertexFormat<glm::ivec2> { static constexpr VkFormat format = VK_FORMAT_R32G32_SINT; };
+template <> struct VertexFormat<glm::ivec3> { static constexpr VkFormat format = VK_FORMAT_R32G32B32_SINT; };
+template <> struct VertexFormat<glm::ivec4> { static constexpr VkFormat format = VK_FORMAT_R32G32B32A32_SINT; };
+template <> struct VertexFormat<uint32_t> { static constexpr VkFormat format = VK_FORMAT_R32_UINT; };
+template <> struct VertexFormat<glm::uvec2> { static constexpr VkFormat format = VK_FORMAT_R32G32_UINT; };
+template <> struct VertexFormat<glm::uvec3> { static constexpr VkFormat format = VK_FORMAT_R32G32B32_UINT; };
+template <> struct VertexFormat<glm::uvec4> { static constexpr VkFormat format = VK_FORMAT_R32G32B32A32_UINT; };
+
+struct VertexAttribute {
+	uint32_t offset;
+	VkFormat format;
+};
+
+#define VERTEX_ATTRIBUTE(VertexType, member) VertexAttribute{ static_cast<uint32_t>(offsetof(VertexType, member)), VertexFormat<decltype(VertexType::member)>::format }
+
+constexpr uint32_t packedVertexFormatSize(VkFormat format) { // bytes per vertex, 0 for formats not meant for packed attributes
+	switch (format) {
+	case VK_FORMAT_R8G8B8A8_UNORM: case VK_FORMAT_R8G8B8A8_SNORM:
+	case VK_FORMAT_R16G16_UNORM: case VK_FORMAT_R16G16_SNORM: case VK_FORMAT_R16G16_SFLOAT:
+	case VK_FORMAT_A2B10G10R10_UNORM_PACK32: case VK_FORMAT_A2B10G10R10_SNORM_PACK32: case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+		return 4;
+	case VK_FORMAT_R16G16B16A16_UNORM: case VK_FORMAT_R16G16B16A16_SNORM: case VK_FORMAT_R16G16B16A16_SFLOAT:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+template <size_t MemberSize, VkFormat Format>
+constexpr VertexAttribute packedVertexAttribute(uint32_t offset) {
+	static_assert(packedVertexFormatSize(Format) == MemberSize, "The member doesn't have the size of the packed format.");
+	return VertexAttribute{ offset, Format };
+}
+
+#define VERTEX_ATTRIBUTE_PACKED(VertexType, member, format) packedVertexAttribute<sizeof(VertexType::member), format>(static_cast<uint32_t>(offsetof(VertexType, member)))
+
+template <typename VertexType>
+struct VertexLayout; // specialized per vertex struct, see above
+
+template <typename VertexType>
+constexpr VkVertexInputBindingDescription vertexBindingDescription(uint32_t binding, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX) {
+	static_assert(std::is_standard_layout_v<VertexType>, "offsetof is only defined for standard layout types.");
+
+	VkVertexInputBindingDescription binding_description = {}; // at which rate to load data from memory throughout the vertices
+	binding_description.binding = binding; // index of the binding in the array of bindings
+	binding_description.stride = sizeof(VertexType); // number of bytes from one entry to the next
+	binding_description.inputRate = inputRate; // VERTEX: move to the next data entry after each vertex; INSTANCE: after each instance
+	return binding_description;
+}
+
+template <typename VertexType>
+constexpr auto vertexAttributeDescriptions(uint32_t binding, uint32_t firstLocation = 0) {
+	constexpr auto& attributes = VertexLayout<VertexType>::attributes;
+
+	std::array<VkVertexInputAttributeDescription, attributes.size()> attribute_descriptions = {}; // how to extract a vertex attribute from a chunk of vertex data originating from a binding description
+	for (size_t i = 0; i < attributes.size(); i++) {
+		attribute_descriptions[i].binding = binding;
+		attribute_descriptions[i].location = firstLocation + static_cast<uint32_t>(i); // the location directive of the input in the vertex shader
+		attribute_descriptions[i].format = attributes[i].format;
+		attribute_descriptions[i].offset = attributes[i].offset; // bytes since the start of the per-vertex data
+	}
+
+	return attribute_descriptions;
+}
+
+// empty if every input the vertex shader reads has an attribute of the same numeric type (float, signed or unsigned integer), otherwise what is missing or wrong
+std::string checkVertexInputs(const std::vector<ReflectedVertexInput>& inputs, const VkVertexInputAttributeDescription* attributes, uint32_t attributeCount);
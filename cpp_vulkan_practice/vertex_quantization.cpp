@@ -0,0 +1,247 @@
+#include "vertex_quantization.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+const float PI = 3.14159265358979f;
+const float SNORM10_MAX = 511.0f;
+const float MAX_PACKED_COLOR = 64512.0f; // largest value of the 10 bit float of blue, the 11 bit ones go a little higher
+
+static glm::vec2 signNotZero(glm::vec2 v) {
+	return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+// octahedral map: the unit sphere projected onto the octahedron |x| + |y| + |z| = 1, the lower half folded over the upper one into the square [-1, 1]^2
+
+static glm::vec2 octahedralEncode(glm::vec3 n) {
+	n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	glm::vec2 p(n.x, n.y);
+
+	if (n.z < 0.0f) {
+		p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+	}
+
+	return p;
+}
+
+static glm::vec3 octahedralDecode(glm::vec2 e) {
+	glm::vec3 v(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+
+	if (v.z < 0.0f) {
+		glm::vec2 folded = (1.0f - glm::abs(glm::vec2(v.y, v.x))) * signNotZero(glm::vec2(v.x, v.y));
+		v.x = folded.x;
+		v.y = folded.y;
+	}
+
+	return glm::normalize(v);
+}
+
+static glm::vec2 octahedralEncodeSnorm10(glm::vec3 n) { // rounding each component on its own isn't the closest representable normal, try the four grid points around it
+	glm::vec2 base = glm::floor(octahedralEncode(n) * SNORM10_MAX);
+	glm::vec2 best(0.0f);
+	float bestDot = -2.0f;
+
+	for (int dy = 0; dy <= 1; dy++) {
+		for (int dx = 0; dx <= 1; dx++) {
+			glm::vec2 candidate = glm::clamp((base + glm::vec2(dx, dy)) / SNORM10_MAX, -1.0f, 1.0f);
+			float candidateDot = glm::dot(octahedralDecode(candidate), n);
+
+			if (candidateDot > bestDot) {
+				bestDot = candidateDot;
+				best = candidate;
+			}
+		}
+	}
+
+	return best;
+}
+
+// reference directions for the tangent angle, perpendicular to the normal: the cross product with z, or with x where that one gets short
+// there is no continuous choice over the whole sphere, the switch at |x| == |z| keeps it away from the axis aligned normals of flat geometry
+// the shader builds the same basis
+
+static void tangentBasis(glm::vec3 n, glm::vec3& reference, glm::vec3& bitangentReference) {
+	reference = std::abs(n.x) > std::abs(n.z) ? glm::normalize(glm::vec3(-n.y, n.x, 0.0f)) : glm::normalize(glm::vec3(0.0f, -n.z, n.y));
+	bitangentReference = glm::cross(n, reference);
+}
+
+static float angleDegrees(glm::vec3 a, glm::vec3 b) {
+	return std::acos(glm::clamp(glm::dot(glm::normalize(a), glm::normalize(b)), -1.0f, 1.0f)) * 180.0f / PI;
+}
+
+static glm::vec3 normalizedInside(glm::vec3 value, glm::vec3 min, glm::vec3 extent) { // 0 on a flat axis
+	glm::vec3 result(0.0f);
+	for (int i = 0; i < 3; i++) {
+		result[i] = extent[i] > 0.0f ? (value[i] - min[i]) / extent[i] : 0.0f;
+	}
+	return glm::clamp(result, 0.0f, 1.0f);
+}
+
+QuantizationBounds computeQuantizationBounds(const std::vector<MeshVertex>& vertices) {
+	QuantizationBounds bounds;
+	if (vertices.empty()) {
+		return bounds;
+	}
+
+	glm::vec3 positionMax = vertices.front().position;
+	glm::vec2 uvMax = vertices.front().uv;
+	bounds.positionMin = positionMax;
+	bounds.uvMin = uvMax;
+
+	for (const auto& vertex : vertices) {
+		bounds.positionMin = glm::min(bounds.positionMin, vertex.position);
+		positionMax = glm::max(positionMax, vertex.position);
+		bounds.uvMin = glm::min(bounds.uvMin, vertex.uv);
+		uvMax = glm::max(uvMax, vertex.uv);
+	}
+
+	bounds.positionExtent = positionMax - bounds.positionMin;
+	bounds.uvExtent = uvMax - bounds.uvMin;
+	return bounds;
+}
+
+PackedVertex quantizeVertex(const MeshVertex& vertex, const QuantizationBounds& bounds) {
+	PackedVertex packed;
+
+	glm::vec3 position = normalizedInside(vertex.position, bounds.positionMin, bounds.positionExtent);
+	packed.position = glm::u16vec4(glm::round(glm::vec4(position, 1.0f) * 65535.0f));
+
+	// the tangent angle is measured in the basis of the normal as the GPU decodes it, not of the original one, so the two agree
+
+	glm::vec2 octahedral = octahedralEncodeSnorm10(vertex.normal);
+	glm::vec3 decodedNormal = octahedralDecode(glm::vec2(glm::unpackSnorm3x10_1x2(glm::packSnorm3x10_1x2(glm::vec4(octahedral, 0.0f, 0.0f))))); // the same arithmetic as dequantizeVertex
+
+	glm::vec3 b1, b2;
+	tangentBasis(decodedNormal, b1, b2);
+
+	glm::vec3 tangent = glm::vec3(vertex.tangent) - decodedNormal * glm::dot(decodedNormal, glm::vec3(vertex.tangent)); // in the plane of the decoded normal
+	float angle = glm::dot(tangent, tangent) > 0.0f ? std::atan2(glm::dot(tangent, b2), glm::dot(tangent, b1)) : 0.0f;
+
+	packed.normalTangent = glm::packSnorm3x10_1x2(glm::vec4(octahedral, angle / PI, vertex.tangent.w < 0.0f ? -1.0f : 1.0f));
+
+	glm::vec3 uv = normalizedInside(glm::vec3(vertex.uv, 0.0f), glm::vec3(bounds.uvMin, 0.0f), glm::vec3(bounds.uvExtent, 0.0f));
+	packed.uv = glm::packUnorm2x16(glm::vec2(uv));
+
+	packed.color = glm::packF2x11_1x10(glm::clamp(vertex.color, 0.0f, MAX_PACKED_COLOR));
+	return packed;
+}
+
+MeshVertex dequantizeVertex(const PackedVertex& vertex, const QuantizationBounds& bounds) {
+	MeshVertex result;
+
+	result.position = glm::vec3(vertex.position) / 65535.0f * bounds.positionExtent + bounds.positionMin;
+
+	glm::vec4 normalTangent = glm::unpackSnorm3x10_1x2(vertex.normalTangent);
+	result.normal = octahedralDecode(glm::vec2(normalTangent));
+
+	glm::vec3 b1, b2;
+	tangentBasis(result.normal, b1, b2);
+
+	float angle = normalTangent.z * PI;
+	result.tangent = glm::vec4(std::cos(angle) * b1 + std::sin(angle) * b2, normalTangent.w < 0.0f ? -1.0f : 1.0f);
+
+	result.uv = glm::unpackUnorm2x16(vertex.uv) * bounds.uvExtent + bounds.uvMin;
+	result.color = glm::unpackF2x11_1x10(vertex.color);
+	return result;
+}
+
+QuantizedMesh quantizeMesh(const MeshData& mesh) {
+	QuantizedMesh quantized;
+	quantized.bounds = computeQuantizationBounds(mesh.vertices);
+	quantized.indices = mesh.indices;
+
+	quantized.vertices.reserve(mesh.vertices.size());
+	for (const auto& vertex : mesh.vertices) {
+		quantized.vertices.push_back(quantizeVertex(vertex, quantized.bounds));
+	}
+
+	return quantized;
+}
+
+MeshDecodeConstants meshDecodeConstants(const QuantizationBounds& bounds) {
+	MeshDecodeConstants constants;
+	constants.positionScale = glm::vec4(bounds.positionExtent, 0.0f); // the UNORM fetch already divided by 65535
+	constants.positionOffset = glm::vec4(bounds.positionMin, 1.0f);
+	constants.uvScaleOffset = glm::vec4(bounds.uvExtent, bounds.uvMin);
+	return constants;
+}
+
+QuantizationError measureQuantizationError(const MeshData& mesh, const QuantizedMesh& quantized) {
+	QuantizationError error;
+	error.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	error.floatBytes = mesh.vertices.size() * sizeof(MeshVertex);
+	error.packedBytes = quantized.vertices.size() * sizeof(PackedVertex);
+
+	if (mesh.vertices.empty()) {
+		return error;
+	}
+
+	double positionSum = 0.0;
+	double normalSum = 0.0;
+	double tangentSum = 0.0;
+
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		const MeshVertex& original = mesh.vertices[i];
+		MeshVertex decoded = dequantizeVertex(quantized.vertices[i], quantized.bounds);
+
+		float positionError = glm::length(decoded.position - original.position);
+		float normalError = angleDegrees(decoded.normal, original.normal);
+		float tangentError = angleDegrees(glm::vec3(decoded.tangent), glm::vec3(original.tangent));
+
+		error.maxPositionError = (std::max)(error.maxPositionError, positionError);
+		error.maxNormalErrorDegrees = (std::max)(error.maxNormalErrorDegrees, normalError);
+		error.maxTangentErrorDegrees = (std::max)(error.maxTangentErrorDegrees, tangentError);
+		positionSum += positionError;
+		normalSum += normalError;
+		tangentSum += tangentError;
+
+		if ((decoded.tangent.w < 0.0f) != (original.tangent.w < 0.0f)) {
+			error.bitangentSignFlips++;
+		}
+
+		glm::vec2 uvError = glm::abs(decoded.uv - original.uv);
+		error.maxUvError = (std::max)({ error.maxUvError, uvError.x, uvError.y });
+
+		glm::vec3 colorError = glm::abs(decoded.color - original.color) / glm::max(original.color, glm::vec3(1.0f));
+		error.maxColorErrorRelative = (std::max)({ error.maxColorErrorRelative, colorError.x, colorError.y, colorError.z });
+	}
+
+	float diagonal = glm::length(quantized.bounds.positionExtent);
+	error.maxPositionErrorRelative = diagonal > 0.0f ? error.maxPositionError / diagonal : 0.0f;
+	error.meanPositionError = static_cast<float>(positionSum / mesh.vertices.size());
+	error.meanNormalErrorDegrees = static_cast<float>(normalSum / mesh.vertices.size());
+	error.meanTangentErrorDegrees = static_cast<float>(tangentSum / mesh.vertices.size());
+	error.maxUvErrorTexels = error.maxUvError * UV_ERROR_REFERENCE_TEXTURE_SIZE;
+	return error;
+}
+
+void printQuantizationReport(const char* name, const QuantizationError& error) {
+	std::cout << name << ": " << error.vertexCount << " vertices, " << error.floatBytes << " bytes as float, " << error.packedBytes << " bytes packed ("
+		<< std::fixed << std::setprecision(2) << (error.packedBytes > 0 ? static_cast<double>(error.floatBytes) / error.packedBytes : 0.0) << "x smaller)" << std::endl;
+	std::cout << std::scientific << std::setprecision(3);
+	std::cout << "  position: max " << error.maxPositionError << " (" << error.maxPositionErrorRelative << " of the diagonal), mean " << error.meanPositionError << std::endl;
+	std::cout << std::fixed << std::setprecision(4);
+	std::cout << "  normal: max " << error.maxNormalErrorDegrees << " deg, mean " << error.meanNormalErrorDegrees << " deg" << std::endl;
+	std::cout << "  tangent: max " << error.maxTangentErrorDegrees << " deg, mean " << error.meanTangentErrorDegrees << " deg, " << error.bitangentSignFlips << " bitangent sign flips" << std::endl;
+	std::cout << "  uv: max " << std::scientific << std::setprecision(3) << error.maxUvError << std::fixed << std::setprecision(4)
+		<< " (" << error.maxUvErrorTexels << " texels at " << UV_ERROR_REFERENCE_TEXTURE_SIZE << "^2)" << std::endl;
+	std::cout << "  color: max " << error.maxColorErrorRelative * 100.0f << "% relative" << std::endl;
+	std::cout << std::defaultfloat;
+}
+
+bool packedVertexFormatsSupported(VkPhysicalDevice physicalDevice) {
+	for (const auto& attribute : VertexLayout<PackedVertex>::attributes) {
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, attribute.format, &formatProperties);
+
+		if ((formatProperties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT) == 0) { // the 10/11 bit formats are optional for vertex buffers
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "mesh.h"
+#include "vertex_layout.h"
+
+// vertex quantization: MeshVertex (60 bytes of floats) packed into PackedVertex (20 bytes), a third of the vertex fetch bandwidth and memory
+// the packing is glm/gtc/packing.hpp, the GPU unpacks for free in the vertex fetch through the normalized and packed float formats
+//
+// - position: 16 bit UNORM per component inside the mesh's bounding box, the shader scales and offsets it back (MeshDecodeConstants, a push constant)
+// - normal and tangent: one A2B10G10R10_SNORM: the normal as an octahedral map in xy, the tangent as an angle around the normal in z
+//   (a tangent is perpendicular to its normal, one angle is all it takes), the bitangent sign in the 2 bit w
+// - uv: 16 bit UNORM inside the mesh's uv bounds, so tiled uvs outside [0, 1] work too
+// - color: B10G11R11_UFLOAT, linear and >= 0, the same small floats as an HDR render target
+//
+// the shader decode has to match dequantizeVertex, which is the reference for the error report (measureQuantizationError)
+
+struct PackedVertex {
+	glm::u16vec4 position; // w unused, keeps the attribute at a format every device can fetch
+	uint32_t normalTangent; // packSnorm3x10_1x2(octahedral normal, tangent angle / pi, bitangent sign)
+	uint32_t uv; // packUnorm2x16
+	uint32_t color; // packF2x11_1x10
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex is meant to be 20 bytes.");
+
+template <> struct VertexLayout<PackedVertex> {
+	static constexpr std::array<VertexAttribute, 4> attributes = {
+		VERTEX_ATTRIBUTE_PACKED(PackedVertex, position, VK_FORMAT_R16G16B16A16_UNORM),
+		VERTEX_ATTRIBUTE_PACKED(PackedVertex, normalTangent, VK_FORMAT_A2B10G10R10_SNORM_PACK32),
+		VERTEX_ATTRIBUTE_PACKED(PackedVertex, uv, VK_FORMAT_R16G16_UNORM),
+		VERTEX_ATTRIBUTE_PACKED(PackedVertex, color, VK_FORMAT_B10G11R11_UFLOAT_PACK32)
+	};
+};
+
+struct QuantizationBounds { // per mesh
+	glm::vec3 positionMin = glm::vec3(0.0f);
+	glm::vec3 positionExtent = glm::vec3(0.0f); // max - min, 0 for a flat axis
+	glm::vec2 uvMin = glm::vec2(0.0f);
+	glm::vec2 uvExtent = glm::vec2(0.0f);
+};
+
+struct MeshDecodeConstants { // the vertex shader's push constant block, std430 layout
+	glm::vec4 positionScale; // xyz
+	glm::vec4 positionOffset; // xyz
+	glm::vec4 uvScaleOffset; // xy scale, zw offset
+};
+
+struct QuantizedMesh {
+	std::vector<PackedVertex> vertices;
+	std::vector<uint32_t> indices;
+	QuantizationBounds bounds;
+};
+
+QuantizationBounds computeQuantizationBounds(const std::vector<MeshVertex>& vertices);
+PackedVertex quantizeVertex(const MeshVertex& vertex, const QuantizationBounds& bounds);
+MeshVertex dequantizeVertex(const PackedVertex& vertex, const QuantizationBounds& bounds); // what the vertex shader sees
+QuantizedMesh quantizeMesh(const MeshData& mesh);
+MeshDecodeConstants meshDecodeConstants(const QuantizationBounds& bounds);
+
+struct QuantizationError { // packed against float, over all vertices
+	uint32_t vertexCount = 0;
+	float maxPositionError = 0.0f; // distance, in mesh units
+	float meanPositionError = 0.0f;
+	float maxPositionErrorRelative = 0.0f; // max distance / bounding box diagonal
+	float maxNormalErrorDegrees = 0.0f;
+	float meanNormalErrorDegrees = 0.0f;
+	float maxTangentErrorDegrees = 0.0f;
+	float meanTangentErrorDegrees = 0.0f;
+	uint32_t bitangentSignFlips = 0; // should be 0
+	float maxUvError = 0.0f; // per component
+	float maxUvErrorTexels = 0.0f; // at UV_ERROR_REFERENCE_TEXTURE_SIZE
+	float maxColorErrorRelative = 0.0f; // per component, relative to the original value (absolute below 1)
+	size_t floatBytes = 0; // vertex data only, the indices don't change
+	size_t packedBytes = 0;
+};
+
+const uint32_t UV_ERROR_REFERENCE_TEXTURE_SIZE = 4096;
+
+QuantizationError measureQuantizationError(const MeshData& mesh, const QuantizedMesh& quantized);
+void printQuantizationReport(const char* name, const QuantizationError& error);
+
+bool packedVertexFormatsSupported(VkPhysicalDevice physicalDevice); // every attribute format of PackedVertex can be fetched from a vertex buffer